@@ -0,0 +1,30 @@
+/* backup.h - Состояние транзакций в backup SRAM (питание от VBAT) */
+
+#ifndef BACKUP_H
+#define BACKUP_H
+
+#include "stm32f4xx_hal.h"
+#include <stdbool.h>
+
+// Снимок транзакции рукава. generation растёт с каждой записью рукава и сравнивается
+// с поколением снимка в журнале EEPROM: при запуске берётся более свежий
+typedef struct {
+    uint32_t generation;
+    uint32_t liters;
+    uint32_t priceTotal;
+    uint8_t state;
+    uint8_t mode;
+    uint8_t modeSelected;
+} BackupTransaction;
+
+// Включение backup SRAM и её регулятора (до запуска задач)
+void initBackupSRAM(void);
+
+// Последний целый снимок рукава; false - снимков нет (батарея была снята) или оба повреждены
+bool backupRead(uint8_t slot, BackupTransaction* t);
+
+// Запись снимка на место более старой из двух копий рукава: прерванная запись
+// не портит последний целый снимок. Можно вызывать из прерывания PVD
+void backupWrite(uint8_t slot, const BackupTransaction* t);
+
+#endif /* BACKUP_H */
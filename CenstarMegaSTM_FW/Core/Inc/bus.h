@@ -0,0 +1,45 @@
+/* bus.h - Заголовочный файл планировщика опроса постов на шине RS-422 */
+
+#ifndef BUS_H
+#define BUS_H
+
+#include "stm32f4xx_hal.h"
+#include "config.h"
+
+// Класс поста определяет его долю слотов опроса
+typedef enum {
+    BUS_POST_IDLE,
+    BUS_POST_ACTIVE,
+    BUS_POST_OFFLINE,
+    BUS_POST_CLASS_COUNT
+} BusPostClass;
+
+typedef struct {
+    uint8_t address;            // Адрес поста на шине
+    BusPostClass postClass;
+    int32_t credit;             // Текущий кредит взвешенного round-robin
+    uint32_t polls;             // Число переданных посту запросов
+    uint32_t lastPollTime;      // Время последнего запроса (мс)
+    uint32_t maxStaleness;      // Наибольший интервал между запросами (мс)
+} BusPost;
+
+// Инициализация: count записей опроса с адресами addresses[0..count-1].
+// Рукава одного поста - отдельные записи с общим адресом
+void busInit(const uint8_t* addresses, uint8_t count);
+
+// Выбор поста для следующего слота опроса (индекс в таблице постов)
+uint8_t busNextPost(void);
+
+// Учёт опроса: посту index передан запрос. Слот, в котором посту нечего передать,
+// опросом не считается
+void busRecordPoll(uint8_t index);
+
+// Обновление класса поста по его состоянию
+void busSetPostClass(uint8_t index, BusPostClass postClass);
+
+// Статистика опроса
+uint8_t busGetPostCount(void);
+const BusPost* busGetPost(uint8_t index);
+uint32_t busGetTotalPolls(void);
+
+#endif /* BUS_H */
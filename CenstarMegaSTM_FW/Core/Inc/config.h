@@ -5,10 +5,17 @@
 
 #include "stm32f4xx_hal.h"
 
+// Параметры с пометкой [настройка] - значения по умолчанию: на посту они задаются записью
+// настроек в EEPROM (settings.h), и код читает их из settings
+
 // Параметры OLED-дисплея
 #define SCREEN_WIDTH 128        // Ширина экрана в пикселях
 #define SCREEN_HEIGHT 64        // Высота экрана в пикселях
 #define OLED_I2C_ADDR (0x3C << 1) // I2C-адрес дисплея (0x3C на шине, сдвинутый для HAL)
+#define OLED_POWER_UP_MS 100    // Наибольшее ожидание ответа дисплея после включения (мс)
+#define OLED_TX_TIMEOUT_MS 100  // Повтор отложенного кадра, если не пришло OLED_EVENT_FLUSHED (мс)
+#define OLED_ALERT_MS 1500      // Длительность показа предупреждения (мс)
+#define OLED_ALERT_QUEUE_LENGTH 3 // Предупреждений в очереди, лишние отбрасываются
 
 // Параметры клавиатуры
 #define KEYPAD_ROW_COUNT 5      // Количество строк клавиатуры
@@ -33,22 +40,38 @@
 #define COL3_PIN  GPIO_PIN_11
 #define COL4_PORT GPIOB
 #define COL4_PIN  GPIO_PIN_12
-#define KEY_DEBOUNCE_MS 15      // Антидребезг клавиш (мс)
+#define KEY_DEBOUNCE_MS 15      // Антидребезг клавиш (мс) [настройка]
+#define KEY_SCAN_PERIOD_MS 20   // Период опроса клавиатуры и повтора удерживаемой клавиши (мс) [настройка]
 
 // Параметры интерфейса RS-422
-#define RS422_BAUD_RATE 9600    // Скорость передачи данных (бод)
+#define RS422_BAUD_RATE 9600    // Скорость передачи данных (бод) [настройка]
 
 // Параметры EEPROM (24C256)
 #define EEPROM_I2C_ADDR (0x50 << 1) // I2C-адрес (0x50 на шине, сдвинутый для HAL)
 #define EEPROM_PAGE_SIZE 64     // Размер страницы в байтах
 #define EEPROM_SIZE 32768       // 32 КБ
+#define EEPROM_JOURNAL_SIZE 16384 // Байт под журнал снимков рукавов (с адреса 0), остальное - история продаж
+#define EEPROM_WRITE_CYCLE_MS 5 // Цикл записи страницы (мс): первый опрос готовности не раньше
+#define EEPROM_WRITE_TIMEOUT_MS 25 // Наибольшее ожидание конца цикла записи (мс)
+#define EEPROM_JOURNAL_WINDOW 64 // Записей журнала, читаемых при запуске (последние снимки всех рукавов)
+#define EEPROM_SETTLE_MS 100    // Затишье запросов записи, после которого изменённые снимки пишутся в журнал
+#define EEPROM_SETTLE_MAX_MS 1000 // Наибольшая задержка записи изменённого снимка при непрерывных запросах
+
+// Backup SRAM (питание от VBAT): текущее состояние транзакций
+#define BACKUP_SRAM_SIZE 4096   // Размер backup SRAM STM32F407 в байтах
+#define PVD_LEVEL PWR_PVDLEVEL_7 // Порог PVD (2,9 В): от него до сброса по BOR снимок успевает в backup SRAM
+
+// Параметры шины I2C1 (задача шины)
+#define I2C_BUS_HIGH_QUEUE_LENGTH 4 // Транзакций EEPROM в очереди
+#define I2C_BUS_LOW_QUEUE_LENGTH 16 // Участков кадров дисплея: команда и данные на каждое из 8 окон
+#define I2C_BUS_TRANSFER_TIMEOUT_MS 50 // Наибольшая длительность одной передачи (мс), затем сброс I2C1
 
 // Таймауты и задержки
-#define RESPONSE_TIMEOUT 3000   // Максимальное время ожидания ответа ТРК (мс)
+#define RESPONSE_TIMEOUT 3000   // Максимальное время ожидания ответа ТРК (мс) [настройка]
 #define INTERBYTE_TIMEOUT 3     // Таймаут между байтами в ответе (мс)
-#define DELAY_AFTER_RESPONSE 3  // Задержка после получения ответа (мс)
+#define DELAY_AFTER_RESPONSE 3  // Задержка после получения ответа (мс) [настройка]
 #define DISPLAY_WELCOME_DURATION 500 // Длительность отображения приветствия (мс)
-#define EDIT_TIMEOUT 10000      // Таймаут редактирования цены (мс)
+#define EDIT_TIMEOUT 10000      // Таймаут редактирования цены (мс) [настройка]
 #define VIEW_TIMEOUT 2000       // Таймаут просмотра цены (мс)
 #define TRANSITION_TIMEOUT 2000 // Таймаут переходных состояний (мс)
 
@@ -61,19 +84,44 @@
 #define STATUS_RESPONSE_LENGTH 7            // Длина ответа на команду статуса
 #define MONITOR_RESPONSE_LENGTH 15          // Длина ответа на команды L и R
 #define TRANSACTION_END_RESPONSE_LENGTH 27  // Длина ответа на команду T
+#define TRANSACTION_END_MIN_LENGTH 18       // Минимальная принимаемая длина ответа на команду T
 #define TOTAL_COUNTER_RESPONSE_LENGTH 16    // Длина ответа на команду C
 
 // Прочие параметры
-#define MAX_ERROR_COUNT 5       // Максимальное число ошибок перед TRK Error
-#define NOZZLE_COUNT 6          // Максимальное число рукавов
-#define POST_ADDRESS 1          // Адрес поста (1-32)
+#define MAX_ERROR_COUNT 5       // Максимальное число ошибок перед TRK Error [настройка]
+#define NOZZLE_COUNT 6          // Максимальное число рукавов на посту
+#define NOZZLES_PER_POST 1      // Число обслуживаемых рукавов каждого поста (1..NOZZLE_COUNT)
+#define POST_ADDRESS 1          // Адрес поста (1-32) [настройка]
+
+// Параметры опроса шины RS-422 (несколько постов на одном UART2)
+#define BUS_POST_COUNT 1        // Число постов на шине, адреса с POST_ADDRESS подряд
+#define BUS_MAX_POSTS 32        // Максимальное число постов на шине
+#define FSM_CONTEXT_COUNT (BUS_POST_COUNT * NOZZLES_PER_POST) // Контекстов FSM: по одному на рукав
+#define FSM_STATS_PERIOD 10000  // Период вывода статистики FSM в лог (мс)
+#define FSM_EVENT_DRIVEN 1      // 1: задача FSM спит до события или срока, 0: прежний опрос каждые 10 мс
+#define FSM_IDLE_POLL_PERIOD 50 // Период опроса статуса поста в ожидании (мс)
+#define BUS_WEIGHT_ACTIVE 16    // Доля слотов постов, ведущих отпуск топлива (делится между ними поровну)
+#define BUS_WEIGHT_IDLE 2       // Доля слотов постов в ожидании
+#define BUS_WEIGHT_OFFLINE 1    // Доля слотов недоступных постов (редкий опрос для проверки связи)
 
 // Параметры логирования
 #define LOG_LEVEL_DEBUG 0       // Уровень отладочных сообщений
 #define LOG_LEVEL_ERROR 1       // Уровень сообщений об ошибках
 #define LOG_LEVEL LOG_LEVEL_DEBUG // Текущий уровень логирования
+#define LOG_RING_SIZE 2048      // Кольцевой буфер лога UART3 (байт, степень двойки), ~2 с вывода на 9600 бод
+#define LOG_BINARY 0            // 1 - бинарные записи по каталогу logmsg.h (расшифровка: Sim, logdecode), 0 - текст
 
 // Параметры кадров протокола
 #define MAX_FRAME_PAYLOAD 16    // Максимальная длина полезной нагрузки кадра
+#define MAX_FRAME_LENGTH 32     // Максимальная длина принимаемого кадра (STX..CRC)
+#define RS422_RX_RING_SIZE 64   // Размер кольцевого DMA-буфера приёма UART2
+#define RS422_TX_POOL_SIZE 4    // Число статических кадров передачи UART2
+
+// Адаптивный таймаут ответа ТРК: srtt + 4 * rttvar по измеренному времени оборота поста,
+// не больше settings->responseTimeout (он же - таймаут до первого ответа)
+#define RS422_TIMEOUT_MIN 50    // Нижняя граница таймаута сверх времени передачи кадров (мс)
+#define RS422_OFFLINE_FAILURES 3 // Неответов подряд, после которых пост считается недоступным
+#define RS422_BACKOFF_MIN 500   // Начальный интервал между пробными запросами к недоступному посту (мс)
+#define RS422_BACKOFF_MAX 30000 // Наибольший интервал между пробными запросами (мс)
 
 #endif /* CONFIG_H */
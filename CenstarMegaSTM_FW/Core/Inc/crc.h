@@ -8,4 +8,7 @@
 // Функция расчёта CRC
 uint8_t calculateCRC(const uint8_t* data, int length);
 
+// CRC-16/CCITT-FALSE (полином 0x1021, начальное значение 0xFFFF) для записей EEPROM
+uint16_t calculateCRC16(const uint8_t* data, int length);
+
 #endif /* CRC_H */
@@ -9,10 +9,46 @@
 #include "FreeRTOS.h"
 #include "queue.h"
 
-// Структура запроса к EEPROM
+// Бит уведомления задачи, ожидающей выполнения своего запроса (readPriceFromEEPROM,
+// restoreTransactionState); не должен совпадать с собственными событиями задачи
+#define EEPROM_EVENT_DONE (1UL << 31)
+
+// Данные рукава в запросе
+#define EEPROM_ITEM_PRICE 0
+#define EEPROM_ITEM_TRANSACTION 1
+#define EEPROM_ITEM_FLUSH 2     // Барьер: изменённые снимки всех рукавов пишутся в журнал сразу
+#define EEPROM_ITEM_HISTORY 3   // Запись продажи в историю или чтение по номеру
+#define EEPROM_ITEM_HISTORY_RECENT 4 // Чтение продажи, отстоящей от последней на historySeq
+#define EEPROM_ITEM_SETTINGS 5  // Запись копии slot записи настроек (settings.c)
+
+// Записи настроек в странице раскладки EEPROM: две копии, формат - в settings.c
+#define EEPROM_SETTINGS_RECORD_SIZE 28
+#define EEPROM_SETTINGS_COPIES 2
+
+// Завершённая продажа в истории
 typedef struct {
+    uint32_t seq;               // Номер в истории (присваивает задача EEPROM)
+    uint32_t timeMs;            // Время записи от запуска контроллера (часов реального времени нет)
+    uint32_t preset;            // Доза: объём или сумма по режиму, 999999 - полный бак, 0 - неизвестна
+    uint32_t liters;            // Итог, дл
+    uint32_t amount;            // Итог, сумма
+    uint16_t price;
+    uint8_t slot;
+    uint8_t mode;               // FuelMode
+    bool restored;              // Транзакция восстановлена после отключения питания
+} HistoryRecord;
+
+typedef struct EEPROMRequest EEPROMRequest;
+
+// Вызывается задачей EEPROM после выполнения запроса; req - копия из очереди.
+// Для записи HAL_OK означает, что снимок рукава в памяти обновлён: в журнал он попадёт позже
+typedef void (*EEPROMDoneCallback)(const EEPROMRequest* req, HAL_StatusTypeDef status);
+
+// Структура запроса к EEPROM
+struct EEPROMRequest {
     bool isWrite; // true: запись, false: чтение
-    uint16_t memAddr;
+    uint8_t slot; // Номер рукава (индекс контекста FSM)
+    uint8_t item; // EEPROM_ITEM_*
     union {
         struct { // Для записи
             uint32_t liters;
@@ -20,8 +56,12 @@ typedef struct {
             FSMState state;
             FuelMode mode;
             bool modeSelected;
+            uint32_t generation; // Поколение снимка в backup SRAM
         } transaction;
         uint16_t price; // Для записи цены
+        HistoryRecord history; // Для записи продажи
+        uint32_t historySeq; // Для чтения продажи: номер или отступ от последней
+        uint8_t settings[EEPROM_SETTINGS_RECORD_SIZE]; // Для записи копии настроек
     } data;
     // Для чтения транзакции
     uint32_t* litersOut;
@@ -29,17 +69,64 @@ typedef struct {
     FSMState* stateOut;
     FuelMode* modeOut;
     bool* modeSelectedOut;
+    uint32_t* generationOut; // NULL - не нужно
     // Для чтения цены
     uint16_t* priceOutSimple;
-} EEPROMRequest;
+    // Для чтения продажи
+    HistoryRecord* historyOut;
+    // Завершение: NULL - не нужно
+    EEPROMDoneCallback done;
+    void* context;
+};
+
+// Статистика отложенной записи
+typedef struct {
+    uint32_t writes;            // Запросы записи
+    uint32_t unchanged;         // Из них не изменившие снимок рукава
+    uint32_t flushes;           // Барьеры flushEEPROM
+    uint32_t records;           // Записи журнала, включая перенос отставших
+    uint32_t pageWrites;        // Циклы записи страниц
+} EEPROMStats;
 
-// Инициализация и обработка запросов (для задачи FreeRTOS)
+// Инициализация и обработка запросов (для задачи FreeRTOS).
+// initEEPROM находит в журнале последние снимки рукавов, до неё запросы не обрабатываются.
+// Задача ждёт запросы не дольше eepromCacheTimeout, после каждого ожидания -
+// processEEPROMCache: запись снимков, изменённых и затихших на EEPROM_SETTLE_MS
+void initEEPROM(void);
 void handleEEPROMRequest(EEPROMRequest* req);
+TickType_t eepromCacheTimeout(void);
+void processEEPROMCache(void);
+const EEPROMStats* eepromGetStats(void);
+
+// Постановка запроса в очередь задачи EEPROM без ожидания выполнения: о нём сообщит req->done
+bool eepromSubmit(const EEPROMRequest* req);
+
+// Функции для вызова из других модулей (slot - номер рукава, у каждого своя цена и транзакция).
+// Чтения ждут выполнения запроса задачей EEPROM, записи только ставят его в очередь.
+// flushEEPROM - барьер для важных переходов: всё сохранённое до него пишется в журнал,
+// не дожидаясь затишья (тоже без ожидания)
+void writePriceToEEPROM(uint8_t slot, uint16_t price);
+uint16_t readPriceFromEEPROM(uint8_t slot);
+void flushEEPROM(void);
+
+// История продаж (кольцо в своём разделе EEPROM): запись без ожидания, чтение по номеру
+// или последних продаж (back = 0 - последняя) с ожиданием, одним чтением EEPROM
+void appendHistory(const HistoryRecord* sale);
+bool readHistory(uint32_t seq, HistoryRecord* sale);
+bool readRecentHistory(uint16_t back, HistoryRecord* sale);
+
+// Копии записи настроек. readSettingsRecords - до запуска планировщика (задачи шины ещё нет,
+// чтение I2C1 напрямую): false - EEPROM не отвечает или ещё не размечена прежней прошивкой.
+// writeSettingsRecord - запись копии задачей EEPROM с ожиданием
+bool readSettingsRecords(uint8_t records[EEPROM_SETTINGS_COPIES][EEPROM_SETTINGS_RECORD_SIZE]);
+bool writeSettingsRecord(uint8_t copy, const uint8_t* record);
 
-// Функции для вызова из других модулей
-void writePriceToEEPROM(uint16_t price);
-uint16_t readPriceFromEEPROM(void);
-void saveTransactionState(uint32_t liters, uint32_t price, FSMState state, FuelMode mode, bool modeSelected);
-bool restoreTransactionState(uint32_t* liters, uint32_t* price, FSMState* state, FuelMode* mode, bool* modeSelected);
+// Состояние транзакции: updateTransactionState - только в backup SRAM (каждое обновление
+// объёма и суммы; можно вызывать из прерывания), saveTransactionState - также в журнал
+// EEPROM (смена состояния).
+// restoreTransactionState возвращает более свежий из двух снимков (только для задачи FSM)
+void updateTransactionState(uint8_t slot, uint32_t liters, uint32_t price, FSMState state, FuelMode mode, bool modeSelected);
+void saveTransactionState(uint8_t slot, uint32_t liters, uint32_t price, FSMState state, FuelMode mode, bool modeSelected);
+bool restoreTransactionState(uint8_t slot, uint32_t* liters, uint32_t* price, FSMState* state, FuelMode* mode, bool* modeSelected);
 
 #endif /* EEPROM_H */
@@ -4,8 +4,32 @@
 #define FRAME_H
 
 #include "stm32f4xx_hal.h"
+#include "config.h"
+#include <stdbool.h>
+
+#define FRAME_STX 0x02          // Начало кадра
+#define FRAME_MIN_LENGTH 5      // STX + 2 байта адреса + команда + CRC
+
+// Потоковая сборка кадров из байтов, принятых по UART
+typedef struct {
+    uint8_t buffer[MAX_FRAME_LENGTH];
+    uint8_t frame[MAX_FRAME_LENGTH]; // Последний собранный кадр
+    uint8_t length;             // Сколько байт кадра уже накоплено
+    uint8_t expectedLength;     // Ожидаемая длина кадра (0 - кадр закрывается паузой на линии)
+    uint32_t droppedBytes;      // Счётчик отброшенных байт (мусор до STX, битые кадры)
+    uint32_t crcErrors;         // Счётчик кадров с неверной CRC
+} FrameAssembler;
 
 // Формирование кадра
 void assembleFrame(const uint8_t* slaveAddress, char command, const uint8_t* payload, int payloadLength, uint8_t* frameBuffer, int* frameLength);
 
+// Длина ответа по коду команды (0 - переменная длина)
+uint8_t frameExpectedLength(char command);
+
+// Сборка кадров: функции возвращают длину собранного кадра (кадр копируется в fa->frame)
+// или 0, если кадр ещё не готов
+void frameAssemblerReset(FrameAssembler* fa);
+int frameAssemblerPush(FrameAssembler* fa, uint8_t byte);
+int frameAssemblerIdle(FrameAssembler* fa);
+
 #endif /* FRAME_H */
@@ -5,12 +5,19 @@
 
 #include "stm32f4xx_hal.h"
 #include "config.h"
+#include "bus.h"
 #include <stdbool.h>
 #include "FreeRTOS.h"
 #include "semphr.h"
 
 #define portMAX_DELAY ( TickType_t ) 0xffffffffUL
 
+// Биты уведомлений задачи FSM: будят её вместо периодического опроса
+#define FSM_EVENT_KEY   (1UL << 0)  // В keypadQueue появилась клавиша
+#define FSM_EVENT_REPLY (1UL << 1)  // В rs422EventQueue появилось завершение запроса
+
+#define FSM_NO_DEADLINE 0xFFFFFFFFUL // Контексту не нужен шаг до нажатия клавиши
+
 // Типы данных
 typedef enum {
     FUEL_BY_VOLUME,
@@ -34,44 +41,73 @@ typedef enum {
     FSM_STATE_CONFIRM_TRANSACTION
 } FSMState;
 
+// Контекст одного рукава. Поля упорядочены по размеру, флаги упакованы в битовые поля,
+// состояние и режим хранятся в uint8_t: массив контекстов растёт с числом рукавов
 typedef struct {
-    FSMState state;
-    FuelMode fuelMode;
-    uint16_t price;
-    bool priceValid;
     uint32_t transactionVolume;
     uint32_t transactionAmount;
-    bool transactionStarted;
-    bool waitingForResponse;
-    int errorCount;
-    int c0RetryCount;
-    bool statusPollingActive;
-    int monitorState;
-    bool monitorActive;
     uint32_t currentLiters_dL;
     uint32_t finalLiters_dL;
     uint32_t currentPriceTotal;
     uint32_t finalPriceTotal;
-    bool nozzleUpWarning;
-    unsigned long stateEntryTime;
-    unsigned long lastKeyTime;
-    unsigned long lastC0SendTime;
-    bool skipFirstStatusCheck;
+    uint32_t stateEntryTime;
+    uint32_t lastKeyTime;
+    uint32_t lastC0SendTime;
+    uint32_t lastResponseTime;
+    uint32_t nozzleUpStartTime;
+    uint16_t price;
+    uint16_t pendingSeq;        // Номер запроса к ТРК, ответ на который ждёт контекст
+    uint8_t address;            // Адрес поста на шине RS-422
+    uint8_t nozzle;             // Номер рукава на посту (1..NOZZLE_COUNT)
+    uint8_t slot;               // Индекс контекста, номер записи в EEPROM
+    uint8_t state;              // FSMState
+    uint8_t fuelMode;           // FuelMode
+    uint8_t monitorState;
+    uint8_t errorCount;
+    uint8_t c0RetryCount;
+    uint8_t transactionRetryCount;
+    char keyCommand;            // Команда ТРК по клавише, ждущая слота опроса поста (0 - нет)
     char priceInput[PRICE_FORMAT_LENGTH + 1];
-    bool modeSelected;
+    bool hasFocus : 1;          // Рукав выбран на клавиатуре и дисплее
+    bool priceValid : 1;
+    bool transactionStarted : 1;
+    bool waitingForResponse : 1;
+    bool statusPollingActive : 1;
+    bool monitorActive : 1;
+    bool nozzleUpWarning : 1;
+    bool transactionDataReceived : 1;
+    bool skipFirstStatusCheck : 1;
+    bool modeSelected : 1;
+    bool restoredTransaction : 1; // Транзакция восстановлена после отключения питания, ждёт сверки с ответом T
 } FSMContext;
 
 // Прототипы функций
 void initFSM(FSMContext* ctx);
 void updateFSM(FSMContext* ctx);
+
+// Обработка завершения запроса к ТРК: шаг FSM с ответом reply
+struct RS422Reply;
+void completeFSM(FSMContext* ctx, const struct RS422Reply* reply);
 void processKeyFSM(FSMContext* ctx, char key);
+
+// Отказ питания (из прерывания PVD): снимок идущей транзакции в backup SRAM
+void powerFailFSM(const FSMContext* ctx);
 FSMState getCurrentState(const FSMContext* ctx);
 FuelMode getCurrentFuelMode(const FSMContext* ctx);
 
+// Время (мс) до следующего шага updateFSM для контекста: 0 - шаг нужен сейчас
+uint32_t getFSMTimeToDeadline(const FSMContext* ctx, uint32_t now);
+
+// Класс поста для планировщика опроса шины
+BusPostClass getBusPostClass(const FSMContext* ctx);
+
+// Перерисовка экрана рукава (при переключении фокуса)
+void redrawFSM(FSMContext* ctx);
+
 // Функция для получения текущего времени (замена millis())
 uint32_t getCurrentMillis(void);
 
-// Функция логирования через UART3
-void logMessage(int level, const char* msg);
+// Счётчик тактов процессора для измерения стоимости шага FSM
+uint32_t getCycleCount(void);
 
 #endif /* FSM_H */
@@ -0,0 +1,73 @@
+/* i2cbus.h - Диспетчер шины I2C1 (дисплей и EEPROM) */
+
+#ifndef I2CBUS_H
+#define I2CBUS_H
+
+#include "stm32f4xx_hal.h"
+#include <stdbool.h>
+
+// Очереди транзакций: из I2C_BUS_HIGH транзакции берутся раньше (запись в EEPROM),
+// из I2C_BUS_LOW - когда высокоприоритетных нет или их устройство занято (кадры дисплея)
+typedef enum {
+    I2C_BUS_HIGH,
+    I2C_BUS_LOW
+} I2CBusPriority;
+
+// Клиенты шины (для статистики)
+typedef enum {
+    I2C_CLIENT_EEPROM,
+    I2C_CLIENT_OLED,
+    I2C_CLIENT_COUNT
+} I2CBusClient;
+
+#define I2C_FLAG_READ        (1 << 0)   // Чтение (иначе запись)
+#define I2C_FLAG_WRITE_CYCLE (1 << 1)   // После записи устройство не отвечает до конца цикла записи (EEPROM):
+                                        // завершение - когда устройство снова ответит на свой адрес
+#define I2C_FLAG_WAIT_READY  (1 << 2)   // Перед передачей дождаться ответа устройства (включение питания)
+
+typedef struct I2CTransaction I2CTransaction;
+
+// Вызывается задачей шины после завершения транзакции; t - копия из очереди
+typedef void (*I2CDoneCallback)(const I2CTransaction* t, HAL_StatusTypeDef status);
+
+struct I2CTransaction {
+    uint16_t devAddress;
+    uint16_t memAddress;        // Адрес ячейки (EEPROM) или управляющий байт (SSD1306)
+    uint16_t memAddSize;        // I2C_MEMADD_SIZE_8BIT или I2C_MEMADD_SIZE_16BIT
+    uint16_t length;
+    uint8_t flags;              // I2C_FLAG_*
+    uint8_t client;             // I2CBusClient
+    uint16_t readyDelayMs;      // I2C_FLAG_WRITE_CYCLE: первый опрос готовности не раньше (мс)
+    uint16_t readyTimeoutMs;    // Наибольшее ожидание готовности устройства (мс)
+    uint8_t* data;              // Должен оставаться неизменным до завершения (передаётся через DMA)
+    I2CDoneCallback done;       // NULL - завершение не нужно
+    void* context;
+};
+
+// Статистика шины
+typedef struct {
+    uint32_t transactions[I2C_CLIENT_COUNT];
+    uint32_t busyUs[I2C_CLIENT_COUNT];      // От запуска передач до их завершения
+    uint32_t errors;                        // NACK и ошибки шины
+    uint32_t timeouts;                      // Передача не завершилась или устройство не ответило в срок
+    uint32_t ackPolls;                      // Опросы готовности устройства (раз в тик, не в цикле)
+    uint32_t readyWaitMs;                   // Ожидание готовности устройств, шина в это время свободна
+    uint32_t overlapped;                    // Транзакции, выполненные во время ожидания готовности другого устройства
+} I2CBusStats;
+
+// Инициализация и один шаг задачи шины: выполнение транзакции или ожидание
+void initI2CBus(void);
+void processI2CBus(void);
+
+// Постановка транзакции в очередь без ожидания; false - очередь заполнена
+bool i2cBusSubmit(const I2CTransaction* t, I2CBusPriority priority);
+
+// Транзакция с ожиданием завершения (из задачи; используется уведомление вызывающей задачи)
+HAL_StatusTypeDef i2cBusTransfer(const I2CTransaction* t, I2CBusPriority priority);
+
+const I2CBusStats* i2cBusGetStats(void);
+
+// Завершение передачи I2C1 (из callback-функций HAL в main.c)
+void i2cBusTransferComplete(HAL_StatusTypeDef status);
+
+#endif /* I2CBUS_H */
@@ -5,6 +5,12 @@
 
 #include "stm32f4xx_hal.h"
 
+// Событие клавиатуры для keypadQueue
+typedef struct {
+    char key;
+    uint32_t time;              // Момент нажатия, такты getCycleCount() (для замера задержки)
+} KeypadEvent;
+
 // Функция сканирования клавиатуры, возвращает символ или 0
 char getKeypadKey(void);
 
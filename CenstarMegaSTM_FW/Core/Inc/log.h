@@ -0,0 +1,42 @@
+/* log.h - Заголовочный файл асинхронного лога через UART3 с DMA */
+
+#ifndef LOG_H
+#define LOG_H
+
+#include "stm32f4xx_hal.h"
+#include "config.h"
+#include "logmsg.h"
+#include <stdbool.h>
+
+// Статистика лога
+typedef struct {
+    uint32_t sentBytes;         // Байт передано через DMA
+    uint32_t droppedMessages;   // Сообщений отброшено из-за заполненного кольца
+    uint32_t droppedBytes;
+    uint16_t peak;              // Наибольшее заполнение кольца (байт)
+} LogStats;
+
+// Запись сообщения в кольцо. Не блокирует и безопасна из любой задачи и прерывания:
+// при нехватке места сообщение отбрасывается целиком (возвращает false)
+bool logWrite(const char* data, uint16_t length);
+
+const LogStats* logGetStats(void);
+
+// Сообщение каталога с целыми аргументами. При LOG_BINARY в кольцо попадает запись из
+// идентификатора, времени и аргументов, без форматирования; иначе - строка текста
+void logEvent(int level, LogMessageId id, const uint32_t* args, uint8_t count);
+
+// Запись в лог: LOG_EVENT(LOG_LEVEL_DEBUG, LOG_MSG_KEY_PRESSED, key)
+#define LOG_EVENT(level, id, ...) \
+    logEvent((level), (id), (const uint32_t[LOG_MAX_ARGS]){__VA_ARGS__}, LOG_ARG_COUNT(__VA_ARGS__))
+#define LOG_ARG_COUNT(...) LOG_ARG_COUNT_(0, ##__VA_ARGS__, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define LOG_ARG_COUNT_(_0, _1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, n, ...) n
+
+// Первая запись после сброса: контрольное число каталога для проверки декодером
+void logStart(void);
+
+// Завершение и ошибка передачи DMA по UART3 (из callback-функций HAL)
+void logTxComplete(void);
+void logTxError(void);
+
+#endif /* LOG_H */
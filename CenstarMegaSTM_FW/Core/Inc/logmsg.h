@@ -0,0 +1,95 @@
+/* logmsg.h - Каталог сообщений лога: общий для прошивки и хостового декодера */
+
+#ifndef LOGMSG_H
+#define LOGMSG_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define LOG_MAX_ARGS 12         // Наибольшее число аргументов сообщения
+
+// Сообщения лога: идентификатор и формат. Аргументы - целые числа; поддерживаются
+// преобразования %d %i %u %x %X %c (модификатор l допускается) с флагами и шириной.
+// Новые сообщения добавляются в конец: номер сообщения - его идентификатор в бинарном логе
+#define LOG_MESSAGES(X) \
+    X(LOG_MSG_CATALOG,              "Log catalog %08lx, %u messages") \
+    X(LOG_MSG_FSM_INIT,             "FSM Initialized") \
+    X(LOG_MSG_KEY_PRESSED,          "Key pressed: %c") \
+    X(LOG_MSG_MODE_SELECTED,        "Mode selected: %d") \
+    X(LOG_MSG_CURRENT_MODE,         "Current mode: %d") \
+    X(LOG_MSG_INPUT,                "Input so far: %lu, point at %d") \
+    X(LOG_MSG_INVALID_VOLUME,       "Invalid volume: Out of range") \
+    X(LOG_MSG_INVALID_AMOUNT,       "Invalid amount: Zero") \
+    X(LOG_MSG_PARSED_AMOUNT,        "Parsed amount: %lu") \
+    X(LOG_MSG_CONFIRMED_VALUE,      "Confirmed value: %lu") \
+    X(LOG_MSG_INVALID_RESPONSE,     "Invalid response format or command") \
+    X(LOG_MSG_NOZZLE_WARNING_RESET, "Forced reset of nozzleUpWarning") \
+    X(LOG_MSG_TRANSACTION_STARTED,  "Transaction started") \
+    X(LOG_MSG_TRANSACTION_REQUEST,  "Requesting transaction update, attempt: %d") \
+    X(LOG_MSG_TRANSACTION_INVALID,  "Invalid transaction data, using last valid values") \
+    X(LOG_MSG_TRANSACTION_END,      "Transaction end: Liters=%lu, Price=%lu") \
+    X(LOG_MSG_TRANSACTION_FAILED,   "Transaction data error after retries") \
+    X(LOG_MSG_CONFIRMED,            "Transaction confirmed") \
+    X(LOG_MSG_CONFIRM_CANCELLED,    "Confirm cancelled, returning to idle") \
+    X(LOG_MSG_CANCELLED,            "Transaction cancelled, returning to idle") \
+    X(LOG_MSG_PAUSED,               "Transaction paused") \
+    X(LOG_MSG_RESUMED,              "Transaction resumed") \
+    X(LOG_MSG_ENDED_FROM_PAUSED,    "Transaction ended from paused") \
+    X(LOG_MSG_ENDED,                "Transaction end, returning to idle") \
+    X(LOG_MSG_TOTAL_CANCELLED,      "Total counter cancelled, returning to idle") \
+    X(LOG_MSG_FSM_STATS,            "FSM: %u ctx x %u B = %u B, step avg %lu max %lu cyc") \
+    X(LOG_MSG_FSM_LATENCY,          "FSM latency us: key avg %lu max %lu (%lu), reply avg %lu max %lu (%lu)") \
+    X(LOG_MSG_POST_STATS,           "Post %u: rtt %lu+-%lu max %u ms, rto %u, ok %lu/%lu, to %lu, err %lu, skip %lu, backoff %u, stale %lu") \
+    X(LOG_MSG_LOG_STATS,            "Log: sent %lu B, dropped %lu msg (%lu B), peak %u/%u B") \
+    X(LOG_MSG_RS422_TOO_LONG,       "RS422 frame too long") \
+    X(LOG_MSG_RS422_FAILED,         "RS422 %c to post %u failed: %u") \
+    X(LOG_MSG_INVALID_PRICE,        "Invalid price") \
+    X(LOG_MSG_SEND_AMOUNT,          "Sending transaction amount") \
+    X(LOG_MSG_SEND_TOTAL,           "Sending C command") \
+    X(LOG_MSG_SEND_PAUSE,           "Sending pause command") \
+    X(LOG_MSG_SEND_RESUME,          "Sending resume command") \
+    X(LOG_MSG_EEPROM_TIMEOUT,       "EEPROM Timeout") \
+    X(LOG_MSG_EEPROM_NOT_FOUND,     "EEPROM Not Found") \
+    X(LOG_MSG_EEPROM_CHUNK,         "Writing chunk...") \
+    X(LOG_MSG_EEPROM_WRITE_ERROR,   "EEPROM Write Error") \
+    X(LOG_MSG_EEPROM_WAIT_ERROR,    "EEPROM Wait Error") \
+    X(LOG_MSG_EEPROM_WRITE_OK,      "EEPROM Write OK") \
+    X(LOG_MSG_EEPROM_READ_ERROR,    "EEPROM Read Error") \
+    X(LOG_MSG_EEPROM_READ_OK,       "EEPROM Read OK") \
+    X(LOG_MSG_OLED_STATS,           "OLED: %lu frames, peak %u fps, %lu B, deferred %lu, err %lu; superseded %lu, alerts dropped %lu") \
+    X(LOG_MSG_I2C_STATS,            "I2C: EEPROM %lu tx %lu ms, OLED %lu tx %lu ms; err %lu, to %lu, polls %lu, ready wait %lu ms, overlapped %lu") \
+    X(LOG_MSG_EEPROM_JOURNAL,       "EEPROM journal: head %u seq %lu, %u slots restored") \
+    X(LOG_MSG_EEPROM_LEGACY,        "EEPROM: %u slots imported from fixed layout") \
+    X(LOG_MSG_BACKUP_RESTORE,       "Slot %u restore: backup SRAM gen %lu, EEPROM gen %lu") \
+    X(LOG_MSG_RESTORED_RECONCILED,  "Restored transaction %lu / %lu, pump T %lu / %lu") \
+    X(LOG_MSG_EEPROM_STATS,         "EEPROM: %lu saves, %lu unchanged, %lu flushes; %lu records in %lu page writes") \
+    X(LOG_MSG_EEPROM_PARTITION,     "EEPROM journal moved from %u to %u records, %u snapshots carried") \
+    X(LOG_MSG_HISTORY,              "History: %lu sales, last #%lu: %lu dL, amount %lu") \
+    X(LOG_MSG_HISTORY_APPEND,       "History #%lu: slot %u, mode %u, preset %lu, %lu dL, amount %lu, price %u") \
+    X(LOG_MSG_SETTINGS,             "Settings gen %u v%u (%u defaults): post %u, %lu baud, timeout %u, delay %u, edit %u, errors %u, debounce %u, scan %u")
+
+#define LOG_MSG_ENUM(id, format) id,
+typedef enum {
+    LOG_MESSAGES(LOG_MSG_ENUM)
+    LOG_MSG_COUNT
+} LogMessageId;
+#undef LOG_MSG_ENUM
+
+// Бинарная запись: LOG_RECORD_SYNC, идентификатор, число аргументов, время (мс) и аргументы
+// в varint (7 бит на байт, младшие вперёд), затем XOR байтов от идентификатора до последнего
+// аргумента. Байт синхронизации вне текста ASCII: декодер пропускает текст без изменений
+#define LOG_RECORD_SYNC 0xA5
+#define LOG_RECORD_MAX (4 + 5 * (1 + LOG_MAX_ARGS))
+
+extern const char* const logFormats[LOG_MSG_COUNT];
+
+// Число аргументов, которое ожидает формат
+uint8_t logFormatArgs(const char* format);
+
+// Текст сообщения по формату и аргументам (как snprintf, возвращает длину без обрезки)
+int logFormat(char* dst, size_t size, const char* format, const uint32_t* args);
+
+// Контрольное число каталога: прошивка выдаёт его при запуске, декодер сверяет со своим
+uint32_t logCatalogHash(void);
+
+#endif /* LOGMSG_H */
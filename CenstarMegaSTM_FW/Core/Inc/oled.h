@@ -4,6 +4,7 @@
 #define OLED_H
 
 #include "stm32f4xx_hal.h"
+#include "config.h"
 #include <stdbool.h>
 #include "FreeRTOS.h"
 #include "queue.h"
@@ -11,22 +12,89 @@
 #define SSD1306_WIDTH  128
 #define SSD1306_HEIGHT 64
 
+// Уведомления задачи OLED (xTaskNotify, eSetBits)
+#define OLED_EVENT_STATE (1UL << 0)  // В почтовом ящике новый экран состояния
+#define OLED_EVENT_ALERT (1UL << 1)  // В очереди предупреждений новое сообщение
+#define OLED_EVENT_FLUSHED (1UL << 2) // Задача шины передала кадр: можно передавать следующий
+
 typedef enum {
     SSD1306_COLOR_BLACK = 0x00,
     SSD1306_COLOR_WHITE = 0x01
 } SSD1306_COLOR;
 
+// Экраны дисплея. FSM передаёт значения, текст строк формирует задача OLED (renderState)
+typedef enum {
+    DISPLAY_SCREEN_TEXT,        // Строковая константа text
+    DISPLAY_SCREEN_TRANSACTION, // Статус status, объём liters_dL, сумма amount (×10 при цене > 9999)
+    DISPLAY_SCREEN_FUEL_MODE,   // Режим mode
+    DISPLAY_SCREEN_INPUT,       // Подпись text и введённые символы input
+    DISPLAY_SCREEN_PRICE,       // Цена price
+    DISPLAY_SCREEN_TOTAL,       // Суммарный счётчик liters_dL
+    DISPLAY_SCREEN_NOZZLE       // Пост post и рукав nozzle
+} DisplayScreen;
+
+// Статус на экране транзакции
+typedef enum {
+    DISPLAY_STATUS_DISPENSING,
+    DISPLAY_STATUS_PAUSED,
+    DISPLAY_STATUS_RESTORING,
+    DISPLAY_STATUS_STOPPED,
+    DISPLAY_STATUS_END
+} DisplayStatus;
+
+// Состояние дисплея: передаётся через почтовый ящик и очередь предупреждений вместо текста
+typedef struct {
+    uint8_t screen;             // DisplayScreen
+    uint8_t status;             // DisplayStatus
+    uint8_t mode;               // FuelMode
+    uint8_t post;
+    uint8_t nozzle;
+    char input[PRICE_FORMAT_LENGTH + 1];
+    const char* text;           // Только строковая константа: передаётся указатель, не копия
+    uint32_t liters_dL;
+    uint32_t amount;
+    uint32_t price;
+} DisplayState;
+
+// Статистика вывода на дисплей
+typedef struct {
+    uint32_t frames;            // Переданные кадры
+    uint32_t bytes;             // Байт команд и данных, поставленных в очередь шины
+    uint32_t errors;
+    uint32_t deferred;          // Кадры, отложенные до окончания передачи предыдущего
+    uint16_t peakFps;           // Наибольшее число кадров за секунду
+    uint32_t superseded;        // Экраны состояния, заменённые более новыми до отрисовки
+    uint32_t alertsDropped;     // Предупреждения, не поместившиеся в очередь
+} OLEDStats;
+
 // Инициализация дисплея
 void initOLED(void);
 
-// Отображение сообщения
-bool displayMessage(const char* msg);
+// Экран состояния: заменяет ещё не отрисованный предыдущий, вызывающий не ждёт
+void displayState(const DisplayState* state);
+
+// Экран состояния из строковой константы
+void displayMessage(const char* text);
+
+// Кратковременное предупреждение: показывается OLED_ALERT_MS поверх экрана состояния,
+// затем дисплей возвращается к последнему экрану состояния. При полной очереди отбрасывается
+bool displayAlert(const DisplayState* state);
 
-// Низкоуровневые функции (взяты из вашего тестового кода)
-void ssd1306_UpdateScreen(void);
+// Отрисовка состояния в буфер (задача OLED): строки, значения которых не изменились
+// с прошлой отрисовки, не формируются заново. На экран буфер выводит ssd1306_UpdateScreen
+void renderState(const DisplayState* state);
+
+// Низкоуровневые функции (взяты из вашего тестового кода).
+// ssd1306_UpdateScreen ставит в очередь шины I2C1 изменившиеся с прошлого вызова участки
+// буфера и сразу возвращается; false - предыдущий кадр ещё передаётся, этот отложен
+bool ssd1306_UpdateScreen(void);
+bool ssd1306_UpdatePending(void);
 void ssd1306_Fill(SSD1306_COLOR color);
 void ssd1306_SetCursor(uint8_t x, uint8_t y);
 void ssd1306_WriteChar(char ch, SSD1306_COLOR color);
 void ssd1306_WriteString(const char* str, SSD1306_COLOR color);
+void ssd1306_WriteBigChar(char ch, SSD1306_COLOR color);
+
+const OLEDStats* oledGetStats(void);
 
 #endif /* OLED_H */
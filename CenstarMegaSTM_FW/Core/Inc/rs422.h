@@ -5,38 +5,95 @@
 
 #include "stm32f4xx_hal.h"
 #include "fsm.h"
+#include "config.h"
 #include <stdbool.h>
 #include "FreeRTOS.h"
 #include "queue.h"
 
-// Структура команды RS-422
+// Запрос к ТРК: команда и ожидаемый ответ. Выполняется задачей RS-422,
+// результат возвращается FSM через rs422EventQueue
 typedef struct {
+    uint8_t address;            // Адрес поста на шине (1-32)
     char command;
     uint8_t payload[16];
     int payloadLength;
-} RS422Command;
+    char expectedReply;         // Код команды в ответе
+    uint8_t expectedLength;     // Минимальная длина ответа
+    uint16_t timeout;           // Наибольшее время ожидания ответа (мс), фактическое - по статистике поста
+    uint16_t seq;               // Номер запроса, по нему FSM сопоставляет ответ
+} RS422Request;
+
+// Итог запроса
+typedef enum {
+    RS422_OK,
+    RS422_TIMEOUT,
+    RS422_CRC_ERROR,            // Пришёл кадр с неверной CRC
+    RS422_FORMAT_ERROR,         // Ответ с другим кодом команды или слишком короткий
+    RS422_TX_ERROR              // Кадр запроса не передан: DMA не запустился или ошибка передачи
+} RS422Status;
+
+// Завершение запроса для FSM (тег структуры нужен для объявления в fsm.h)
+typedef struct RS422Reply {
+    uint16_t seq;
+    uint8_t address;
+    uint8_t status;             // RS422Status
+    uint8_t length;
+    uint8_t data[MAX_FRAME_LENGTH];
+    uint32_t time;              // Момент приёма ответа, такты getCycleCount()
+} RS422Reply;
+
+// Принятый кадр ответа ТРК (STX..CRC), передаётся через rs422RxQueue.
+// Кадр нулевой длины сообщает об ошибке CRC (status RS422_CRC_ERROR) или о том,
+// что не передан кадр запроса seq (status RS422_TX_ERROR)
+typedef struct {
+    uint8_t length;
+    uint8_t status;             // RS422Status
+    uint16_t seq;               // Для RS422_TX_ERROR - номер запроса
+    uint8_t data[MAX_FRAME_LENGTH];
+    uint32_t time;              // Момент сборки кадра, такты getCycleCount()
+} RS422Frame;
+
+// Статистика обмена с постом. Время оборота - от начала передачи запроса до приёма ответа
+// за вычетом времени передачи обоих кадров, то есть время реакции ТРК
+typedef struct {
+    uint32_t srtt8;             // Сглаженное время оборота, 1/8 мс
+    uint32_t rttvar4;           // Сглаженное отклонение времени оборота, 1/4 мс
+    uint16_t lastRtt;           // Последнее измерение (мс)
+    uint16_t maxRtt;            // Наибольшее измерение (мс)
+    uint16_t timeout;           // Текущий таймаут без времени передачи кадров (мс)
+    uint16_t backoff;           // Интервал между пробными запросами к недоступному посту (мс), 0 - пост на связи
+    uint32_t backoffUntil;      // До этого момента запросы к посту завершаются без передачи (мс)
+    uint32_t requests;
+    uint32_t replies;
+    uint32_t timeouts;
+    uint32_t errors;            // Ошибки CRC, формата и передачи
+    uint32_t skipped;           // Запросы, не переданные из-за backoff
+    uint8_t failures;           // Неудачных запросов подряд
+} RS422PumpStats;
 
 // Инициализация RS-422
 void initRS422(void);
 
-// Функции отправки команд
-void rs422SendStatus(void);
-void rs422SendTransaction(FuelMode mode, uint32_t volume, uint32_t amount, uint16_t price);
-void rs422SendTransactionUpdate(void);
-void rs422SendNozzleOff(void);
-void rs422SendLitersMonitor(void);
-void rs422SendRevenueStatus(void);
-void rs422SendTotalCounter(void);
-void rs422SendPause(void);
-void rs422SendResume(void);
-
-// Функция ожидания ответа
-int rs422WaitForResponse(uint8_t* buffer, int expectedLength, char expectedCommand);
-
-// Отправка команды (внутренняя функция)
-void sendRS422Command(RS422Command* cmd);
-
-// Логирование (определено в fsm.c)
-void logMessage(int level, const char* msg);
+// Статистика обмена с постом address (1..BUS_MAX_POSTS)
+const RS422PumpStats* rs422GetPumpStats(uint8_t address);
+
+// Функции отправки команд (address - адрес поста на шине, nozzle - номер рукава 1..NOZZLE_COUNT).
+// Не блокируют: возвращают номер запроса, ответ придёт в rs422EventQueue
+uint16_t rs422SendStatus(uint8_t address);
+uint16_t rs422SendTransaction(uint8_t address, uint8_t nozzle, FuelMode mode, uint32_t volume, uint32_t amount, uint16_t price);
+uint16_t rs422SendTransactionUpdate(uint8_t address);
+uint16_t rs422SendNozzleOff(uint8_t address);
+uint16_t rs422SendLitersMonitor(uint8_t address);
+uint16_t rs422SendRevenueStatus(uint8_t address);
+uint16_t rs422SendTotalCounter(uint8_t address, uint8_t nozzle);
+uint16_t rs422SendPause(uint8_t address);
+uint16_t rs422SendResume(uint8_t address);
+
+// Выполнение запроса задачей RS-422: передача кадра, ожидание ответа, отправка завершения
+void processRS422Request(RS422Request* req);
+
+// Завершение передачи и ошибка UART2 (из callback-функций HAL в main.c)
+void rs422TxCpltCallback(void);
+void rs422ErrorCallback(void);
 
 #endif /* RS422_H */
@@ -0,0 +1,35 @@
+/* settings.h - Настройки поста в EEPROM (значения по умолчанию - в config.h) */
+
+#ifndef SETTINGS_H
+#define SETTINGS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Параметры, которые на посту подстраиваются без перепрошивки
+typedef struct {
+    uint32_t baudRate;          // Скорость RS-422 (бод)
+    uint16_t responseTimeout;   // Максимальное время ожидания ответа ТРК (мс)
+    uint16_t editTimeout;       // Таймаут редактирования цены (мс)
+    uint8_t postAddress;        // Адрес первого поста на шине
+    uint8_t maxErrorCount;      // Ошибок подряд перед TRK Error
+    uint8_t delayAfterResponse; // Задержка после получения ответа (мс)
+    uint8_t keyDebounceMs;      // Антидребезг клавиш (мс)
+    uint8_t keyScanMs;          // Период опроса клавиатуры и повтора удерживаемой клавиши (мс)
+} Settings;
+
+// Загрузка настроек до запуска планировщика и инициализации UART2 (в main). Поля, которых
+// нет в записи старой версии или значения которых вне допустимых пределов, берутся по
+// умолчанию, как и все поля, если записи нет
+void initSettings(void);
+
+// Сохранение с ожиданием (из задачи); новые настройки действуют после перезапуска.
+// false - значение вне допустимых пределов или ошибка записи
+bool saveSettings(const Settings* s);
+
+// После initSettings настройки не меняются: код читает поля напрямую (settings->responseTimeout),
+// указатель - константа времени компиляции, и обращение стоит одной загрузки из памяти
+extern Settings settingsStorage;    // Заполняет только initSettings
+static const Settings* const settings = &settingsStorage;
+
+#endif /* SETTINGS_H */
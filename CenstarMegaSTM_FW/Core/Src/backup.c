@@ -0,0 +1,94 @@
+/* backup.c - Состояние транзакций в backup SRAM (питание от VBAT) */
+
+#include "backup.h"
+#include "config.h"
+#include "crc.h"
+#include <stddef.h>
+#include <string.h>
+
+// Копия снимка в backup SRAM. После снятия батареи содержимое случайно: запись
+// принимается только с верными меткой, номером рукава и CRC
+typedef struct {
+    uint16_t magic;
+    uint8_t slot;
+    uint8_t state;
+    uint32_t generation;
+    uint32_t liters;
+    uint32_t priceTotal;
+    uint8_t mode;
+    uint8_t modeSelected;
+    uint16_t crc;               // CRC-16 полей до crc
+} BackupRecord;
+
+#define BACKUP_MAGIC 0xB5A7
+#define BACKUP_COPIES 2
+#define BACKUP_RECORD_SIZE 20   // sizeof(BackupRecord)
+
+#if FSM_CONTEXT_COUNT * BACKUP_COPIES * BACKUP_RECORD_SIZE > BACKUP_SRAM_SIZE
+#error "Backup SRAM too small for FSM_CONTEXT_COUNT"
+#endif
+
+#define backupRecords ((BackupRecord (*)[BACKUP_COPIES])BKPSRAM_BASE)
+
+// Копия рукава, которую сейчас пишет backupWrite (номер + 1, 0 - нет): запись из прерывания
+// PVD, прервавшая запись задачи, идёт в другую копию и не смешивается с ней
+static volatile uint8_t writing[FSM_CONTEXT_COUNT];
+
+void initBackupSRAM(void) {
+    __HAL_RCC_PWR_CLK_ENABLE();
+    HAL_PWR_EnableBkUpAccess();
+    __HAL_RCC_BKPSRAM_CLK_ENABLE();
+    // Регулятор backup SRAM сохраняет её содержимое от VBAT без основного питания
+    HAL_PWREx_EnableBkUpReg();
+}
+
+static uint16_t recordCRC(const BackupRecord* record) {
+    return calculateCRC16((const uint8_t*)record, offsetof(BackupRecord, crc));
+}
+
+// Номер самой свежей целой копии рукава или -1
+static int newestCopy(uint8_t slot, BackupRecord* newest) {
+    int found = -1;
+    for (int i = 0; i < BACKUP_COPIES; i++) {
+        BackupRecord record = backupRecords[slot][i];
+        if (record.magic != BACKUP_MAGIC || record.slot != slot || record.crc != recordCRC(&record)) continue;
+        if (found < 0 || record.generation > newest->generation) {
+            *newest = record;
+            found = i;
+        }
+    }
+    return found;
+}
+
+bool backupRead(uint8_t slot, BackupTransaction* t) {
+    BackupRecord record;
+    if (slot >= FSM_CONTEXT_COUNT || newestCopy(slot, &record) < 0) return false;
+    t->generation = record.generation;
+    t->liters = record.liters;
+    t->priceTotal = record.priceTotal;
+    t->state = record.state;
+    t->mode = record.mode;
+    t->modeSelected = record.modeSelected;
+    return true;
+}
+
+void backupWrite(uint8_t slot, const BackupTransaction* t) {
+    if (slot >= FSM_CONTEXT_COUNT) return;
+    BackupRecord record;
+    int copy = (newestCopy(slot, &record) + 1) % BACKUP_COPIES;
+    if (writing[slot] == copy + 1) copy = (copy + 1) % BACKUP_COPIES;
+    uint8_t interrupted = writing[slot];
+    writing[slot] = copy + 1;
+    memset(&record, 0, sizeof(record));
+    record.magic = BACKUP_MAGIC;
+    record.slot = slot;
+    record.state = t->state;
+    record.generation = t->generation;
+    record.liters = t->liters;
+    record.priceTotal = t->priceTotal;
+    record.mode = t->mode;
+    record.modeSelected = t->modeSelected;
+    record.crc = recordCRC(&record);
+    backupRecords[slot][copy] = record;
+    writing[slot] = interrupted;
+}
@@ -0,0 +1,88 @@
+/* bus.c - Планировщик опроса постов на шине RS-422 (взвешенный round-robin) */
+
+#include "bus.h"
+#include "fsm.h"
+#include <string.h>
+
+static BusPost posts[BUS_MAX_POSTS];
+static uint8_t postCount = 0;
+static uint32_t totalPolls = 0;
+
+static int32_t classWeight(BusPostClass postClass) {
+    switch (postClass) {
+        case BUS_POST_ACTIVE:  return BUS_WEIGHT_ACTIVE;
+        case BUS_POST_OFFLINE: return BUS_WEIGHT_OFFLINE;
+        default:               return BUS_WEIGHT_IDLE;
+    }
+}
+
+void busInit(const uint8_t* addresses, uint8_t count) {
+    if (count > BUS_MAX_POSTS) count = BUS_MAX_POSTS;
+    memset(posts, 0, sizeof(posts));
+    postCount = count;
+    totalPolls = 0;
+    uint32_t now = getCurrentMillis();
+    for (uint8_t i = 0; i < postCount; i++) {
+        posts[i].address = addresses[i];
+        posts[i].postClass = BUS_POST_IDLE;
+        posts[i].lastPollTime = now;
+    }
+}
+
+// Плавный взвешенный round-robin: каждый пост набирает кредит по своему весу,
+// слот получает пост с наибольшим кредитом, и его кредит уменьшается на сумму весов.
+// Вес класса делится между его постами поровну, поэтому доля слотов класса не зависит
+// от числа постов в других классах: пост, ведущий отпуск, сохраняет большинство слотов
+// и при 31 посте в ожидании. Слоты активных постов распределяются равномерно, а не пачками
+uint8_t busNextPost(void) {
+    if (postCount == 0) return 0;
+
+    uint8_t classCount[BUS_POST_CLASS_COUNT] = {0};
+    for (uint8_t i = 0; i < postCount; i++) {
+        classCount[posts[i].postClass]++;
+    }
+
+    int32_t totalWeight = 0;
+    uint8_t best = 0;
+    for (uint8_t i = 0; i < postCount; i++) {
+        int32_t weight = classWeight(posts[i].postClass) * BUS_MAX_POSTS / classCount[posts[i].postClass];
+        if (weight < 1) weight = 1;
+        posts[i].credit += weight;
+        totalWeight += weight;
+        if (posts[i].credit > posts[best].credit) {
+            best = i;
+        }
+    }
+    posts[best].credit -= totalWeight;
+    return best;
+}
+
+void busRecordPoll(uint8_t index) {
+    if (index >= postCount) return;
+    uint32_t now = getCurrentMillis();
+    uint32_t staleness = now - posts[index].lastPollTime;
+    if (staleness > posts[index].maxStaleness) {
+        posts[index].maxStaleness = staleness;
+    }
+    posts[index].lastPollTime = now;
+    posts[index].polls++;
+    totalPolls++;
+}
+
+void busSetPostClass(uint8_t index, BusPostClass postClass) {
+    if (index < postCount) {
+        posts[index].postClass = postClass;
+    }
+}
+
+uint8_t busGetPostCount(void) {
+    return postCount;
+}
+
+const BusPost* busGetPost(uint8_t index) {
+    return (index < postCount) ? &posts[index] : NULL;
+}
+
+uint32_t busGetTotalPolls(void) {
+    return totalPolls;
+}
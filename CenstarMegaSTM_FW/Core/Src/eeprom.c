@@ -2,51 +2,168 @@
 
 #include "eeprom.h"
 #include "config.h"
+#include "log.h"
+#include "i2cbus.h"
+#include "crc.h"
+#include "backup.h"
 #include "FreeRTOS.h"
 #include "task.h"
 #include <stdbool.h>
+#include <string.h>
 
-extern I2C_HandleTypeDef hi2c1;
-
-// Адреса в EEPROM для хранения данных
-#define EEPROM_PRICE_ADDR 0
-#define EEPROM_LITERS_ADDR 4
-#define EEPROM_PRICE_TOTAL_ADDR 8
-#define EEPROM_STATE_ADDR 12
-#define EEPROM_MODE_ADDR 14
-#define EEPROM_MODE_SELECTED_ADDR 15
-
-// Низкоуровневые функции чтения/записи (адаптированы из вашего тестового кода)
-static HAL_StatusTypeDef EEPROM_WaitReady(void) {
-    uint32_t tick = HAL_GetTick();
-    while (HAL_I2C_IsDeviceReady(&hi2c1, EEPROM_I2C_ADDR, 1, 10) != HAL_OK) {
-        if (HAL_GetTick() - tick > 25) {
-            logMessage(LOG_LEVEL_ERROR, "EEPROM Timeout");
-            return HAL_TIMEOUT;
-        }
-    }
-    return HAL_OK;
+// Прежняя раскладка: запись рукава по фиксированному адресу slot * 16, цена в байтах 0..1,
+// транзакция с байта 4. Читается один раз, если журнал ещё пуст
+#define EEPROM_LEGACY_SLOT_SIZE 16
+#define EEPROM_LEGACY_TRANSACTION_ADDR 4
+
+// Раздел EEPROM: журнал снимков рукавов с адреса 0 (EEPROM_JOURNAL_SIZE байт), за ним
+// страница раскладки и история продаж.
+//
+// Журнал: кольцо записей. Каждое сохранение цены или транзакции дописывает
+// снимок рукава в следующую запись с номером на 1 больше, поэтому каждая ячейка
+// перезаписывается раз за оборот кольца, а не при каждом сохранении.
+// Запись (две в странице EEPROM, пишется одним циклом записи):
+//  0..3   номер seq (0xFFFFFFFF - стёртая запись)
+//  4      рукав
+//  5..7   состояние FSM, режим, режим выбран
+//  8..15  объём и сумма транзакции
+//  16..17 цена
+//  18..21 поколение транзакции (счётчик записей в backup SRAM), 22..25 - нули
+//  26..27 CRC-16 байтов 0..25
+//  28..31 копия seq: запись, прерванная отключением питания, содержит начало новой записи
+//         и конец прежней, и номера не совпадают даже при случайно верной CRC
+#define JOURNAL_RECORD_SIZE 32
+#define JOURNAL_RECORDS (EEPROM_JOURNAL_SIZE / JOURNAL_RECORD_SIZE)
+#define JOURNAL_RECORDS_UNPARTITIONED (EEPROM_SIZE / JOURNAL_RECORD_SIZE) // Журнал прежних прошивок: вся EEPROM
+#define JOURNAL_CRC_OFFSET 26
+#define JOURNAL_SEQ_COPY_OFFSET 28
+#define JOURNAL_READ_RECORDS 4          // Записей за одно чтение при запуске
+// Кольцо начинается после прежней раскладки: она перезаписывается только в конце первого
+// оборота, и недописанная первая запись журнала не портит ещё не перенесённые данные
+#define JOURNAL_FIRST_RECORD ((FSM_CONTEXT_COUNT * EEPROM_LEGACY_SLOT_SIZE + JOURNAL_RECORD_SIZE - 1) / JOURNAL_RECORD_SIZE)
+// Последняя запись рукава, отставшая от головы на половину окна, дописывается заново:
+// при запуске достаточно прочитать EEPROM_JOURNAL_WINDOW последних записей
+#define JOURNAL_CARRY_DISTANCE (EEPROM_JOURNAL_WINDOW / 2)
+
+// Страница раскладки в начале раздела истории: размер журнала (в записях), для которого
+// размечена EEPROM. Если её нет (прежняя прошивка) или размер другой, журнал сначала
+// переходит на кольцо нового размера (resizeJournal), и только после этого пишется история.
+//  0..3   LAYOUT_MAGIC, 4..5 записей журнала, 6..7 CRC-16 байтов 0..5
+//  8..63  две копии записи настроек (settings.c). При первой разметке стираются: до неё
+//         здесь лежали записи журнала прежней прошивки
+#define LAYOUT_ADDRESS EEPROM_JOURNAL_SIZE
+#define LAYOUT_SIZE 8
+#define LAYOUT_MAGIC 0x5452415FUL
+#define SETTINGS_ADDRESS (LAYOUT_ADDRESS + LAYOUT_SIZE)
+
+// История продаж: кольцо записей завершённых транзакций после страницы раскладки.
+// Номера записей идут подряд без пропусков, и запись с номером seq лежит на (headSeq - seq)
+// позиций раньше головы: весь индекс в памяти - голова кольца, а поиск по номеру и
+// "последние N" - одно чтение записи, без просмотра EEPROM.
+// Запись (номер, CRC и копия номера - на тех же местах, что в журнале):
+//  0..3   номер seq
+//  4      HISTORY_MAGIC: у записи журнала здесь номер рукава, и за историю она не сойдёт
+//  5..7   рукав, режим, флаги (HISTORY_FLAG_*)
+//  8..11  время записи (мс от запуска)
+//  12..15 доза
+//  16..23 объём (дл) и сумма
+//  24..25 цена
+//  26..27 CRC-16 байтов 0..25
+//  28..31 копия seq
+#define HISTORY_ADDRESS (EEPROM_JOURNAL_SIZE + EEPROM_PAGE_SIZE)
+#define HISTORY_RECORDS ((EEPROM_SIZE - HISTORY_ADDRESS) / JOURNAL_RECORD_SIZE)
+#define HISTORY_MAGIC 0xA5
+#define HISTORY_FLAG_RESTORED 0x01
+
+#if EEPROM_JOURNAL_SIZE % EEPROM_PAGE_SIZE != 0 || HISTORY_ADDRESS >= EEPROM_SIZE
+#error "EEPROM_JOURNAL_SIZE must be a whole number of pages below EEPROM_SIZE"
+#endif
+#if LAYOUT_SIZE + EEPROM_SETTINGS_COPIES * EEPROM_SETTINGS_RECORD_SIZE > EEPROM_PAGE_SIZE
+#error "Settings records do not fit in the layout page"
+#endif
+#if JOURNAL_RECORDS <= EEPROM_JOURNAL_WINDOW + JOURNAL_FIRST_RECORD
+#error "EEPROM_JOURNAL_SIZE too small for EEPROM_JOURNAL_WINDOW"
+#endif
+
+// Сброс дописывает до FSM_CONTEXT_COUNT изменившихся рукавов, и за ними и за переносом
+// одних рукавов другие отстают ещё на столько же записей
+#if 2 * FSM_CONTEXT_COUNT + 1 >= JOURNAL_CARRY_DISTANCE
+#error "EEPROM_JOURNAL_WINDOW too small for FSM_CONTEXT_COUNT"
+#endif
+
+// Снимок рукава; поля, которые ещё не сохранялись, стёрты (0xFF), как в прежней раскладке
+typedef struct {
+    uint32_t liters;
+    uint32_t priceTotal;
+    uint16_t price;
+    uint8_t state;
+    uint8_t mode;
+    uint8_t modeSelected;
+    uint32_t generation;        // 0 - транзакция не сохранялась или записана прежней прошивкой
+} JournalSlot;
+
+// Кольцо записей журнала или истории. Позиции считаются от записи first области
+// (ringAddress): журнал начинается после прежней раскладки
+typedef struct {
+    uint16_t base;                              // Адрес области
+    uint16_t first;
+    uint16_t records;                           // Записей в кольце
+    uint16_t head;                              // Последняя запись
+    uint32_t headSeq;                           // 0 - кольцо пусто
+} Ring;
+
+static Ring journal = { 0, JOURNAL_FIRST_RECORD, JOURNAL_RECORDS, 0, 0 };
+static Ring history = { HISTORY_ADDRESS, 0, HISTORY_RECORDS, 0, 0 };
+static bool partitioned;                        // Журнал в своём разделе: историю можно писать
+
+// Снимки рукавов в памяти: чтения отвечают из них, запросы записи меняют их сразу
+static JournalSlot slots[FSM_CONTEXT_COUNT];
+static uint16_t slotRecord[FSM_CONTEXT_COUNT];  // Позиция последней записи рукава в журнале
+static bool slotStored[FSM_CONTEXT_COUNT];
+
+// Отложенная запись: снимок рукава, отличающийся от последнего записанного в журнал (written),
+// дописывается, когда запросы записи затихнут на EEPROM_SETTLE_MS, но не позже
+// EEPROM_SETTLE_MAX_MS от первого изменения, или по барьеру flushEEPROM. Серия сохранений
+// рукава становится одной записью, а сохранение без изменений не пишется вовсе
+static JournalSlot written[FSM_CONTEXT_COUNT];
+static bool cacheDirty;
+static TickType_t dirtySince;                   // Первое изменение после сброса
+static TickType_t lastChange;
+static EEPROMStats stats;
+
+// Низкоуровневые функции чтения/записи (адаптированы из вашего тестового кода).
+// Передачи выполняет задача шины I2C1 вне очереди кадров дисплея
+static I2CTransaction eepromTransaction(uint16_t memAddr, uint8_t* data, uint16_t len, uint8_t flags) {
+    I2CTransaction t = {
+        .devAddress = EEPROM_I2C_ADDR,
+        .memAddress = memAddr,
+        .memAddSize = I2C_MEMADD_SIZE_16BIT,
+        .length = len,
+        .flags = flags,
+        .client = I2C_CLIENT_EEPROM,
+        .readyDelayMs = EEPROM_WRITE_CYCLE_MS,
+        .readyTimeoutMs = EEPROM_WRITE_TIMEOUT_MS,
+        .data = data
+    };
+    return t;
 }
 
+// Запись по страницам: после каждой задача шины дожидается конца цикла записи, опрашивая
+// микросхему раз в тик, и пока цикл идёт, передаёт кадры дисплея
 static HAL_StatusTypeDef EEPROM_Write(uint16_t memAddr, const uint8_t* data, uint16_t len) {
-    if (HAL_I2C_IsDeviceReady(&hi2c1, EEPROM_I2C_ADDR, 2, 10) != HAL_OK) {
-        logMessage(LOG_LEVEL_ERROR, "EEPROM Not Found");
-        return HAL_ERROR;
-    }
-
     while (len) {
         uint16_t pageRemain = EEPROM_PAGE_SIZE - (memAddr % EEPROM_PAGE_SIZE);
         uint16_t chunk = (len < pageRemain) ? len : pageRemain;
 
-        logMessage(LOG_LEVEL_DEBUG, "Writing chunk...");
-        if (HAL_I2C_Mem_Write(&hi2c1, EEPROM_I2C_ADDR, memAddr, I2C_MEMADD_SIZE_16BIT,
-                              (uint8_t*)data, chunk, 100) != HAL_OK) {
-            logMessage(LOG_LEVEL_ERROR, "EEPROM Write Error");
+        LOG_EVENT(LOG_LEVEL_DEBUG, LOG_MSG_EEPROM_CHUNK);
+        I2CTransaction t = eepromTransaction(memAddr, (uint8_t*)data, chunk, I2C_FLAG_WRITE_CYCLE);
+        HAL_StatusTypeDef status = i2cBusTransfer(&t, I2C_BUS_HIGH);
+        if (status == HAL_TIMEOUT) {
+            LOG_EVENT(LOG_LEVEL_ERROR, LOG_MSG_EEPROM_TIMEOUT);
             return HAL_ERROR;
         }
-
-        if (EEPROM_WaitReady() != HAL_OK) {
-            logMessage(LOG_LEVEL_ERROR, "EEPROM Wait Error");
+        if (status != HAL_OK) {
+            LOG_EVENT(LOG_LEVEL_ERROR, LOG_MSG_EEPROM_WRITE_ERROR);
             return HAL_ERROR;
         }
 
@@ -54,133 +171,707 @@ static HAL_StatusTypeDef EEPROM_Write(uint16_t memAddr, const uint8_t* data, uin
         data += chunk;
         len -= chunk;
     }
-    logMessage(LOG_LEVEL_DEBUG, "EEPROM Write OK");
+    LOG_EVENT(LOG_LEVEL_DEBUG, LOG_MSG_EEPROM_WRITE_OK);
     return HAL_OK;
 }
 
 static HAL_StatusTypeDef EEPROM_Read(uint16_t memAddr, uint8_t* data, uint16_t len) {
-    if (HAL_I2C_IsDeviceReady(&hi2c1, EEPROM_I2C_ADDR, 2, 10) != HAL_OK) {
-        logMessage(LOG_LEVEL_ERROR, "EEPROM Not Found");
+    I2CTransaction t = eepromTransaction(memAddr, data, len, I2C_FLAG_READ);
+    if (i2cBusTransfer(&t, I2C_BUS_HIGH) != HAL_OK) {
+        LOG_EVENT(LOG_LEVEL_ERROR, LOG_MSG_EEPROM_READ_ERROR);
+        return HAL_ERROR;
+    }
+    LOG_EVENT(LOG_LEVEL_DEBUG, LOG_MSG_EEPROM_READ_OK);
+    return HAL_OK;
+}
+
+static void putU32(uint8_t* p, uint32_t value) {
+    p[0] = value & 0xFF;
+    p[1] = (value >> 8) & 0xFF;
+    p[2] = (value >> 16) & 0xFF;
+    p[3] = (value >> 24) & 0xFF;
+}
+
+static uint32_t getU32(const uint8_t* p) {
+    return ((uint32_t)p[3] << 24) | ((uint32_t)p[2] << 16) | ((uint32_t)p[1] << 8) | p[0];
+}
+
+// CRC и копия номера записи журнала или истории
+static void sealRecord(uint8_t* record, uint32_t seq) {
+    uint16_t crc = calculateCRC16(record, JOURNAL_CRC_OFFSET);
+    record[JOURNAL_CRC_OFFSET] = crc & 0xFF;
+    record[JOURNAL_CRC_OFFSET + 1] = crc >> 8;
+    putU32(record + JOURNAL_SEQ_COPY_OFFSET, seq);
+}
+
+static void encodeRecord(uint8_t* record, uint32_t seq, uint8_t slot, const JournalSlot* data) {
+    memset(record, 0, JOURNAL_RECORD_SIZE);
+    putU32(record, seq);
+    record[4] = slot;
+    record[5] = data->state;
+    record[6] = data->mode;
+    record[7] = data->modeSelected;
+    putU32(record + 8, data->liters);
+    putU32(record + 12, data->priceTotal);
+    record[16] = data->price & 0xFF;
+    record[17] = (data->price >> 8) & 0xFF;
+    putU32(record + 18, data->generation);
+    sealRecord(record, seq);
+}
+
+// Номер целой записи кольца или 0 для стёртой, повреждённой, недописанной или записи
+// другого кольца
+static uint32_t recordSeq(const Ring* ring, const uint8_t* record) {
+    uint32_t seq = getU32(record);
+    uint16_t crc = record[JOURNAL_CRC_OFFSET] | (record[JOURNAL_CRC_OFFSET + 1] << 8);
+    if (seq == 0 || seq == 0xFFFFFFFF || getU32(record + JOURNAL_SEQ_COPY_OFFSET) != seq ||
+        calculateCRC16(record, JOURNAL_CRC_OFFSET) != crc || (record[4] == HISTORY_MAGIC) != (ring == &history)) {
+        return 0;
+    }
+    return seq;
+}
+
+static uint32_t decodeRecord(const uint8_t* record, uint8_t* slot, JournalSlot* data) {
+    uint32_t seq = recordSeq(&journal, record);
+    if (seq == 0) return 0;
+    *slot = record[4];
+    data->state = record[5];
+    data->mode = record[6];
+    data->modeSelected = record[7];
+    data->liters = getU32(record + 8);
+    data->priceTotal = getU32(record + 12);
+    data->price = record[16] | (record[17] << 8);
+    data->generation = getU32(record + 18);
+    return seq;
+}
+
+static uint16_t ringIndex(const Ring* ring, uint16_t position) {
+    return (position + ring->first) % ring->records;
+}
+
+static uint16_t ringAddress(const Ring* ring, uint16_t position) {
+    return ring->base + ringIndex(ring, position) * JOURNAL_RECORD_SIZE;
+}
+
+static uint16_t nextPosition(const Ring* ring) {
+    return (ring->headSeq == 0) ? 0 : (ring->head + 1) % ring->records;
+}
+
+static uint32_t readRecord(const Ring* ring, uint16_t position) {
+    uint8_t record[JOURNAL_RECORD_SIZE];
+    if (EEPROM_Read(ringAddress(ring, position), record, sizeof(record)) != HAL_OK) return 0;
+    return recordSeq(ring, record);
+}
+
+// Голова кольца двоичным поиском: от позиции 0 номера растут до головы, дальше идут
+// записи прошлого оборота (меньшие номера), стёртые или одна недописанная.
+// Если недописана сама позиция 0, голова - последняя позиция кольца
+static void findHead(Ring* ring) {
+    uint32_t first = readRecord(ring, 0);
+    ring->headSeq = 0;
+    if (first == 0) {
+        uint32_t last = readRecord(ring, ring->records - 1);
+        if (last != 0) {
+            ring->head = ring->records - 1;
+            ring->headSeq = last;
+        }
+        return;
+    }
+    uint16_t lo = 0, hi = ring->records;
+    ring->headSeq = first;
+    while (hi - lo > 1) {
+        uint16_t mid = (lo + hi) / 2;
+        uint32_t seq = readRecord(ring, mid);
+        if (seq != 0 && seq >= first) {
+            lo = mid;
+            ring->headSeq = seq;
+        } else {
+            hi = mid;
+        }
+    }
+    ring->head = lo;
+}
+
+// Снимки рукавов из последних EEPROM_JOURNAL_WINDOW записей: запись на k позиций раньше
+// головы принимается, только если её номер на k меньше (записи прошлого оборота не смешиваются)
+static uint8_t loadWindow(void) {
+    uint8_t restored = 0;
+    uint8_t buffer[JOURNAL_READ_RECORDS * JOURNAL_RECORD_SIZE];
+    uint16_t back = 0;
+    while (back < EEPROM_JOURNAL_WINDOW && back < journal.headSeq && restored < FSM_CONTEXT_COUNT) {
+        // Участок записей, заканчивающийся на (head - back), не переходящий ни через начало
+        // кольца, ни через конец области
+        uint16_t last = (journal.head + journal.records - back) % journal.records;
+        uint16_t count = JOURNAL_READ_RECORDS;
+        if (count > last + 1) count = last + 1;
+        if (count > ringIndex(&journal, last) + 1) count = ringIndex(&journal, last) + 1;
+        if (count > EEPROM_JOURNAL_WINDOW - back) count = EEPROM_JOURNAL_WINDOW - back;
+        uint16_t firstRecord = last + 1 - count;
+        if (EEPROM_Read(ringAddress(&journal, firstRecord), buffer, count * JOURNAL_RECORD_SIZE) != HAL_OK) {
+            break;
+        }
+        for (int16_t i = count - 1; i >= 0; i--, back++) {
+            uint8_t slot;
+            JournalSlot data;
+            uint32_t seq = decodeRecord(&buffer[i * JOURNAL_RECORD_SIZE], &slot, &data);
+            if (seq == 0 || seq != journal.headSeq - back || slot >= FSM_CONTEXT_COUNT || slotStored[slot]) continue;
+            slots[slot] = data;
+            slotRecord[slot] = firstRecord + i;
+            slotStored[slot] = true;
+            restored++;
+        }
+    }
+    return restored;
+}
+
+// Запись снимков рукавов list в следующие записи кольца. Записи одной страницы EEPROM
+// пишутся одним циклом записи; через начало кольца пакет не переходит
+static HAL_StatusTypeDef appendRecords(const uint8_t* list, uint8_t count) {
+    uint8_t buffer[EEPROM_PAGE_SIZE];
+    while (count) {
+        uint16_t position = nextPosition(&journal);
+        uint16_t batch = (EEPROM_PAGE_SIZE - ringAddress(&journal, position) % EEPROM_PAGE_SIZE) / JOURNAL_RECORD_SIZE;
+        if (batch > count) batch = count;
+        if (batch > journal.records - position) batch = journal.records - position;
+        for (uint16_t i = 0; i < batch; i++) {
+            encodeRecord(&buffer[i * JOURNAL_RECORD_SIZE], journal.headSeq + 1 + i, list[i], &slots[list[i]]);
+        }
+        if (EEPROM_Write(ringAddress(&journal, position), buffer, batch * JOURNAL_RECORD_SIZE) != HAL_OK) {
+            return HAL_ERROR;
+        }
+        for (uint16_t i = 0; i < batch; i++) {
+            slotRecord[list[i]] = position + i;
+            slotStored[list[i]] = true;
+            written[list[i]] = slots[list[i]];
+        }
+        journal.head = position + batch - 1;
+        journal.headSeq += batch;
+        stats.records += batch;
+        stats.pageWrites++;
+        list += batch;
+        count -= batch;
+    }
+    return HAL_OK;
+}
+
+// Снимки совпадают без учёта поколения: сохранение, сменившее только поколение, не дописывается
+// (тот же снимок с новым поколением есть в backup SRAM)
+static bool sameSnapshot(const JournalSlot* a, const JournalSlot* b) {
+    return a->liters == b->liters && a->priceTotal == b->priceTotal && a->price == b->price &&
+           a->state == b->state && a->mode == b->mode && a->modeSelected == b->modeSelected;
+}
+
+// Запись изменившихся рукавов и перенос к голове последних записей рукавов, отставших от неё
+static HAL_StatusTypeDef flushSlots(void) {
+    uint8_t list[FSM_CONTEXT_COUNT];
+    uint8_t count = 0;
+    cacheDirty = false;
+    for (uint8_t i = 0; i < FSM_CONTEXT_COUNT; i++) {
+        if (!sameSnapshot(&slots[i], &written[i])) list[count++] = i;
+    }
+    if (count == 0) return HAL_OK;
+    if (appendRecords(list, count) != HAL_OK) return HAL_ERROR;
+
+    // Расстояние считается от головы после уже выбранных переносов
+    uint8_t carried = 0;
+    for (uint8_t i = 0; i < FSM_CONTEXT_COUNT; i++) {
+        uint16_t distance = (journal.head + carried + journal.records - slotRecord[i]) % journal.records;
+        if (slotStored[i] && distance >= JOURNAL_CARRY_DISTANCE) list[carried++] = i;
+    }
+    appendRecords(list, carried);
+    return HAL_OK;
+}
+
+// Перенос записей прежней раскладки в пустой журнал (после обновления прошивки)
+static uint8_t importLegacy(void) {
+    uint8_t imported = 0;
+    uint8_t buffer[EEPROM_LEGACY_SLOT_SIZE];
+    for (uint8_t slot = 0; slot < FSM_CONTEXT_COUNT; slot++) {
+        if (EEPROM_Read(slot * EEPROM_LEGACY_SLOT_SIZE, buffer, sizeof(buffer)) != HAL_OK) continue;
+        const uint8_t* transaction = buffer + EEPROM_LEGACY_TRANSACTION_ADDR;
+        JournalSlot* data = &slots[slot];
+        data->price = buffer[0] | (buffer[1] << 8);
+        data->liters = getU32(transaction);
+        data->priceTotal = getU32(transaction + 4);
+        data->state = transaction[8];
+        data->mode = transaction[9];
+        data->modeSelected = transaction[10];
+        data->generation = 0;
+        if (data->price != 0xFFFF || data->state != 0xFF) {
+            slotStored[slot] = true;
+            imported++;
+        }
+    }
+    // Перенесённые рукава сразу дописываются в журнал
+    uint8_t list[FSM_CONTEXT_COUNT];
+    uint8_t count = 0;
+    for (uint8_t slot = 0; slot < FSM_CONTEXT_COUNT; slot++) {
+        if (slotStored[slot]) list[count++] = slot;
+    }
+    appendRecords(list, count);
+    return imported;
+}
+
+static void resetSlots(void) {
+    memset(slots, 0xFF, sizeof(slots));
+    for (uint8_t slot = 0; slot < FSM_CONTEXT_COUNT; slot++) {
+        slots[slot].generation = 0;
+    }
+    memset(slotStored, 0, sizeof(slotStored));
+}
+
+// Размер журнала (в записях) из страницы раскладки; 0 - страницы раскладки нет
+static uint16_t decodeLayout(const uint8_t* layout) {
+    uint16_t crc = layout[6] | (layout[7] << 8);
+    if (getU32(layout) != LAYOUT_MAGIC || calculateCRC16(layout, 6) != crc) return 0;
+    return layout[4] | (layout[5] << 8);
+}
+
+// При ошибке чтения раскладка считается текущей: переход по сбою шины испортил бы историю
+static uint16_t readLayout(void) {
+    uint8_t layout[LAYOUT_SIZE];
+    if (EEPROM_Read(LAYOUT_ADDRESS, layout, sizeof(layout)) != HAL_OK) return JOURNAL_RECORDS;
+    return decodeLayout(layout);
+}
+
+// Раскладка пишется в начало страницы, и копии настроек за ней стираются той же записью,
+// если страница только размечается (clearSettings): иначе они сохраняются
+static HAL_StatusTypeDef writeLayout(bool clearSettings) {
+    uint8_t page[EEPROM_PAGE_SIZE];
+    memset(page, 0xFF, sizeof(page));
+    putU32(page, LAYOUT_MAGIC);
+    page[4] = JOURNAL_RECORDS & 0xFF;
+    page[5] = JOURNAL_RECORDS >> 8;
+    uint16_t crc = calculateCRC16(page, 6);
+    page[6] = crc & 0xFF;
+    page[7] = crc >> 8;
+    return EEPROM_Write(LAYOUT_ADDRESS, page, clearSettings ? sizeof(page) : LAYOUT_SIZE);
+}
+
+// Переход журнала с кольца из oldRecords записей на кольцо из JOURNAL_RECORDS. Позиции
+// от 0 до common лежат в обоих кольцах по одним адресам; пока голова или последняя запись
+// какого-то рукава дальше, снимки всех рукавов дописываются в прежнее кольцо, как при обычной
+// работе. Отключение питания посреди перехода ничего не теряет: он продолжится при следующем
+// запуске. false - ошибка записи, журнал остаётся в прежнем кольце (снимки загружены)
+static bool resizeJournal(uint16_t oldRecords) {
+    uint16_t common = (oldRecords < JOURNAL_RECORDS ? oldRecords : JOURNAL_RECORDS) - JOURNAL_FIRST_RECORD;
+    uint16_t carried = 0;
+    journal.records = oldRecords;
+    findHead(&journal);
+    if (journal.headSeq != 0) {
+        loadWindow();
+        for (;;) {
+            uint8_t list[FSM_CONTEXT_COUNT];
+            uint8_t count = 0;
+            bool moved = journal.head < common;
+            for (uint8_t i = 0; i < FSM_CONTEXT_COUNT; i++) {
+                if (!slotStored[i]) continue;
+                list[count++] = i;
+                if (slotRecord[i] > journal.head) moved = false;
+            }
+            if (moved || count == 0) break;
+            if (appendRecords(list, count) != HAL_OK) return false;
+            carried += count;
+        }
+    }
+    LOG_EVENT(LOG_LEVEL_DEBUG, LOG_MSG_EEPROM_PARTITION, oldRecords, JOURNAL_RECORDS, carried);
+    journal.records = JOURNAL_RECORDS;
+    return true;
+}
+
+static void encodeHistory(uint8_t* record, const HistoryRecord* sale) {
+    memset(record, 0, JOURNAL_RECORD_SIZE);
+    putU32(record, sale->seq);
+    record[4] = HISTORY_MAGIC;
+    record[5] = sale->slot;
+    record[6] = sale->mode;
+    record[7] = sale->restored ? HISTORY_FLAG_RESTORED : 0;
+    putU32(record + 8, sale->timeMs);
+    putU32(record + 12, sale->preset);
+    putU32(record + 16, sale->liters);
+    putU32(record + 20, sale->amount);
+    record[24] = sale->price & 0xFF;
+    record[25] = sale->price >> 8;
+    sealRecord(record, sale->seq);
+}
+
+static void decodeHistory(const uint8_t* record, HistoryRecord* sale) {
+    sale->seq = getU32(record);
+    sale->slot = record[5];
+    sale->mode = record[6];
+    sale->restored = (record[7] & HISTORY_FLAG_RESTORED) != 0;
+    sale->timeMs = getU32(record + 8);
+    sale->preset = getU32(record + 12);
+    sale->liters = getU32(record + 16);
+    sale->amount = getU32(record + 20);
+    sale->price = record[24] | (record[25] << 8);
+}
+
+// Запись продажи с номером на 1 больше последнего
+static HAL_StatusTypeDef appendHistoryRecord(const HistoryRecord* sale) {
+    if (!partitioned) return HAL_ERROR;
+    uint8_t record[JOURNAL_RECORD_SIZE];
+    HistoryRecord numbered = *sale;
+    uint16_t position = nextPosition(&history);
+    numbered.seq = history.headSeq + 1;
+    encodeHistory(record, &numbered);
+    if (EEPROM_Write(ringAddress(&history, position), record, sizeof(record)) != HAL_OK) {
         return HAL_ERROR;
     }
+    history.head = position;
+    history.headSeq = numbered.seq;
+    LOG_EVENT(LOG_LEVEL_DEBUG, LOG_MSG_HISTORY_APPEND, numbered.seq, numbered.slot, numbered.mode,
+              numbered.preset, numbered.liters, numbered.amount, numbered.price);
+    return HAL_OK;
+}
 
-    HAL_StatusTypeDef status = HAL_I2C_Mem_Read(&hi2c1, EEPROM_I2C_ADDR, memAddr,
-                                                I2C_MEMADD_SIZE_16BIT, data, len, 100);
-    if (status != HAL_OK) {
-        logMessage(LOG_LEVEL_ERROR, "EEPROM Read Error");
+// Продажа с номером seq: позиция - по голове кольца, одно чтение
+static HAL_StatusTypeDef readHistoryRecord(uint32_t seq, HistoryRecord* sale) {
+    uint32_t count = history.headSeq < history.records ? history.headSeq : history.records;
+    if (!partitioned || seq == 0 || seq > history.headSeq || history.headSeq - seq >= count) return HAL_ERROR;
+    uint16_t position = (history.head + history.records - (history.headSeq - seq)) % history.records;
+    uint8_t record[JOURNAL_RECORD_SIZE];
+    if (EEPROM_Read(ringAddress(&history, position), record, sizeof(record)) != HAL_OK ||
+        recordSeq(&history, record) != seq) {
         return HAL_ERROR;
     }
-    logMessage(LOG_LEVEL_DEBUG, "EEPROM Read OK");
+    decodeHistory(record, sale);
     return HAL_OK;
 }
 
-// Обработчик запросов для задачи FreeRTOS
-void handleEEPROMRequest(EEPROMRequest* req) {
-    if (req->isWrite) {
-        if (req->memAddr == EEPROM_PRICE_ADDR) {
-            // Запись цены
-            uint8_t buffer[2];
-            buffer[0] = req->data.price & 0xFF;
-            buffer[1] = (req->data.price >> 8) & 0xFF;
-            EEPROM_Write(EEPROM_PRICE_ADDR, buffer, 2);
-        } else {
-            // Запись транзакции
-            uint8_t buffer[16];
-            // Liters
-            buffer[0] = req->data.transaction.liters & 0xFF;
-            buffer[1] = (req->data.transaction.liters >> 8) & 0xFF;
-            buffer[2] = (req->data.transaction.liters >> 16) & 0xFF;
-            buffer[3] = (req->data.transaction.liters >> 24) & 0xFF;
-            // Price
-            buffer[4] = req->data.transaction.price & 0xFF;
-            buffer[5] = (req->data.transaction.price >> 8) & 0xFF;
-            buffer[6] = (req->data.transaction.price >> 16) & 0xFF;
-            buffer[7] = (req->data.transaction.price >> 24) & 0xFF;
-            // State
-            buffer[8] = (uint8_t)req->data.transaction.state;
-            // Mode
-            buffer[9] = (uint8_t)req->data.transaction.mode;
-            // Mode Selected
-            buffer[10] = (uint8_t)req->data.transaction.modeSelected;
-            EEPROM_Write(EEPROM_LITERS_ADDR, buffer, 11);
+// Восстановление снимков рукавов и головы истории при запуске задачи EEPROM
+void initEEPROM(void) {
+    resetSlots();
+    memcpy(written, slots, sizeof(written));
+    cacheDirty = false;
+    partitioned = false;
+    journal.records = JOURNAL_RECORDS;
+    uint16_t layout = readLayout();
+    if (layout != JOURNAL_RECORDS) {
+        if (!resizeJournal(layout != 0 ? layout : JOURNAL_RECORDS_UNPARTITIONED)) {
+            memcpy(written, slots, sizeof(written));
+            return;
         }
+        resetSlots();
+        partitioned = writeLayout(layout == 0) == HAL_OK;
     } else {
-        if (req->memAddr == EEPROM_PRICE_ADDR) {
-            // Чтение цены
-            uint8_t buffer[2];
-            if (EEPROM_Read(EEPROM_PRICE_ADDR, buffer, 2) == HAL_OK) {
-                *req->priceOutSimple = (buffer[1] << 8) | buffer[0];
-            }
+        partitioned = true;
+    }
+
+    findHead(&journal);
+    if (journal.headSeq == 0) {
+        uint8_t imported = importLegacy();
+        if (imported) LOG_EVENT(LOG_LEVEL_DEBUG, LOG_MSG_EEPROM_LEGACY, imported);
+    } else {
+        uint8_t restored = loadWindow();
+        memcpy(written, slots, sizeof(written));
+        LOG_EVENT(LOG_LEVEL_DEBUG, LOG_MSG_EEPROM_JOURNAL, journal.head, journal.headSeq, restored);
+    }
+
+    if (partitioned) {
+        HistoryRecord last = {0};
+        findHead(&history);
+        readHistoryRecord(history.headSeq, &last);
+        LOG_EVENT(LOG_LEVEL_DEBUG, LOG_MSG_HISTORY,
+                  history.headSeq < history.records ? history.headSeq : history.records,
+                  history.headSeq, last.liters, last.amount);
+    }
+}
+
+// Выполнение запроса: чтения отвечают из снимков в памяти, записи меняют снимок рукава,
+// а в журнал он попадает при сбросе (processEEPROMCache или барьер EEPROM_ITEM_FLUSH)
+static HAL_StatusTypeDef processRequest(const EEPROMRequest* req) {
+    if (req->item == EEPROM_ITEM_FLUSH) {
+        stats.flushes++;
+        return flushSlots();
+    }
+    if (req->item == EEPROM_ITEM_HISTORY) {
+        return req->isWrite ? appendHistoryRecord(&req->data.history) : readHistoryRecord(req->data.historySeq, req->historyOut);
+    }
+    if (req->item == EEPROM_ITEM_HISTORY_RECENT) {
+        return readHistoryRecord(history.headSeq - req->data.historySeq, req->historyOut);
+    }
+    if (req->item == EEPROM_ITEM_SETTINGS) {
+        if (!partitioned || req->slot >= EEPROM_SETTINGS_COPIES) return HAL_ERROR;
+        return EEPROM_Write(SETTINGS_ADDRESS + req->slot * EEPROM_SETTINGS_RECORD_SIZE,
+                            req->data.settings, EEPROM_SETTINGS_RECORD_SIZE);
+    }
+    if (req->slot >= FSM_CONTEXT_COUNT) return HAL_ERROR;
+    JournalSlot* data = &slots[req->slot];
+    if (req->isWrite) {
+        JournalSlot before = *data;
+        stats.writes++;
+        if (req->item == EEPROM_ITEM_PRICE) {
+            data->price = req->data.price;
         } else {
-            // Чтение транзакции
-            uint8_t buffer[16];
-            if (EEPROM_Read(EEPROM_LITERS_ADDR, buffer, 11) == HAL_OK) {
-                *req->litersOut = (buffer[3] << 24) | (buffer[2] << 16) | (buffer[1] << 8) | buffer[0];
-                *req->priceOut = (buffer[7] << 24) | (buffer[6] << 16) | (buffer[5] << 8) | buffer[4];
-                *req->stateOut = (FSMState)buffer[8];
-                *req->modeOut = (FuelMode)buffer[9];
-                *req->modeSelectedOut = (bool)buffer[10];
-            }
+            data->liters = req->data.transaction.liters;
+            data->priceTotal = req->data.transaction.price;
+            data->state = (uint8_t)req->data.transaction.state;
+            data->mode = (uint8_t)req->data.transaction.mode;
+            data->modeSelected = req->data.transaction.modeSelected;
+            data->generation = req->data.transaction.generation;
+        }
+        if (sameSnapshot(data, &before)) {
+            stats.unchanged++;
+            return HAL_OK;
         }
+        TickType_t now = xTaskGetTickCount();
+        if (!cacheDirty) {
+            cacheDirty = true;
+            dirtySince = now;
+        }
+        lastChange = now;
+        return HAL_OK;
+    }
+    if (req->item == EEPROM_ITEM_PRICE) {
+        *req->priceOutSimple = data->price;
+    } else {
+        *req->litersOut = data->liters;
+        *req->priceOut = data->priceTotal;
+        *req->stateOut = (FSMState)data->state;
+        *req->modeOut = (FuelMode)data->mode;
+        *req->modeSelectedOut = data->modeSelected != 0;
+        if (req->generationOut != NULL) *req->generationOut = data->generation;
     }
+    return HAL_OK;
 }
 
-// Функции для вызова из других модулей
-void writePriceToEEPROM(uint16_t price) {
+// Обработчик запросов для задачи FreeRTOS: после выполнения - уведомление о завершении
+void handleEEPROMRequest(EEPROMRequest* req) {
+    HAL_StatusTypeDef status = processRequest(req);
+    if (req->done != NULL) {
+        req->done(req, status);
+    }
+}
+
+// Ожидание для задачи EEPROM до сброса изменённых снимков
+TickType_t eepromCacheTimeout(void) {
+    if (!cacheDirty) return portMAX_DELAY;
+    TickType_t now = xTaskGetTickCount();
+    TickType_t quiet = now - lastChange;
+    TickType_t age = now - dirtySince;
+    if (quiet >= pdMS_TO_TICKS(EEPROM_SETTLE_MS) || age >= pdMS_TO_TICKS(EEPROM_SETTLE_MAX_MS)) return 0;
+    TickType_t settle = pdMS_TO_TICKS(EEPROM_SETTLE_MS) - quiet;
+    TickType_t limit = pdMS_TO_TICKS(EEPROM_SETTLE_MAX_MS) - age;
+    return settle < limit ? settle : limit;
+}
+
+void processEEPROMCache(void) {
+    if (cacheDirty && eepromCacheTimeout() == 0) flushSlots();
+}
+
+const EEPROMStats* eepromGetStats(void) {
+    return &stats;
+}
+
+bool eepromSubmit(const EEPROMRequest* req) {
     extern QueueHandle_t eepromQueue;
+    return xQueueSend(eepromQueue, req, portMAX_DELAY) == pdTRUE;
+}
+
+// Ожидающая запрос задача и результат
+typedef struct {
+    TaskHandle_t task;
+    volatile bool done;
+    volatile HAL_StatusTypeDef status;
+} EEPROMWaiter;
+
+static void requestDone(const EEPROMRequest* req, HAL_StatusTypeDef status) {
+    EEPROMWaiter* waiter = (EEPROMWaiter*)req->context;
+    waiter->status = status;
+    waiter->done = true;
+    xTaskNotify(waiter->task, EEPROM_EVENT_DONE, eSetBits);
+}
+
+// Запрос с ожиданием до его выполнения задачей EEPROM. Уведомления, пришедшие вызывающей
+// задаче во время ожидания (FSM_EVENT_*), возвращаются ей: они не теряются
+static HAL_StatusTypeDef eepromRequestWait(EEPROMRequest* req) {
+    EEPROMWaiter waiter = { xTaskGetCurrentTaskHandle(), false, HAL_ERROR };
+    req->done = requestDone;
+    req->context = &waiter;
+    if (!eepromSubmit(req)) return HAL_ERROR;
+    uint32_t other = 0;
+    while (!waiter.done) {
+        uint32_t events = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &events, portMAX_DELAY);
+        other |= events & ~EEPROM_EVENT_DONE;
+    }
+    if (other != 0) {
+        xTaskNotify(waiter.task, other, eSetBits);
+    }
+    return waiter.status;
+}
+
+// Функции для вызова из других модулей
+void writePriceToEEPROM(uint8_t slot, uint16_t price) {
     EEPROMRequest req = {
         .isWrite = true,
-        .memAddr = EEPROM_PRICE_ADDR,
+        .slot = slot,
+        .item = EEPROM_ITEM_PRICE,
         .data.price = price
     };
-    xQueueSend(eepromQueue, &req, portMAX_DELAY);
+    eepromSubmit(&req);
 }
 
-uint16_t readPriceFromEEPROM(void) {
-    extern QueueHandle_t eepromQueue;
-    uint16_t price = 0;
+void flushEEPROM(void) {
+    EEPROMRequest req = {
+        .isWrite = true,
+        .item = EEPROM_ITEM_FLUSH
+    };
+    eepromSubmit(&req);
+}
+
+void appendHistory(const HistoryRecord* sale) {
+    EEPROMRequest req = {
+        .isWrite = true,
+        .item = EEPROM_ITEM_HISTORY,
+        .data.history = *sale
+    };
+    eepromSubmit(&req);
+}
+
+bool readHistory(uint32_t seq, HistoryRecord* sale) {
     EEPROMRequest req = {
         .isWrite = false,
-        .memAddr = EEPROM_PRICE_ADDR,
-        .priceOutSimple = &price
+        .item = EEPROM_ITEM_HISTORY,
+        .data.historySeq = seq,
+        .historyOut = sale
     };
-    xQueueSend(eepromQueue, &req, portMAX_DELAY);
-    // Ждём выполнения операции (блокирующий вызов)
-    while (uxQueueMessagesWaiting(eepromQueue) > 0) {
-        vTaskDelay(1 / portTICK_PERIOD_MS);
+    return eepromRequestWait(&req) == HAL_OK;
+}
+
+bool readRecentHistory(uint16_t back, HistoryRecord* sale) {
+    EEPROMRequest req = {
+        .isWrite = false,
+        .item = EEPROM_ITEM_HISTORY_RECENT,
+        .data.historySeq = back,
+        .historyOut = sale
+    };
+    return eepromRequestWait(&req) == HAL_OK;
+}
+
+// Чтение страницы раскладки до запуска планировщика. После включения питания или сброса
+// посреди цикла записи EEPROM может ещё не отвечать: сначала ожидание её готовности
+bool readSettingsRecords(uint8_t records[EEPROM_SETTINGS_COPIES][EEPROM_SETTINGS_RECORD_SIZE]) {
+    extern I2C_HandleTypeDef hi2c1;
+    uint8_t page[EEPROM_PAGE_SIZE];
+    if (HAL_I2C_IsDeviceReady(&hi2c1, EEPROM_I2C_ADDR, EEPROM_WRITE_TIMEOUT_MS, 1) != HAL_OK ||
+        HAL_I2C_Mem_Read(&hi2c1, EEPROM_I2C_ADDR, LAYOUT_ADDRESS, I2C_MEMADD_SIZE_16BIT, page, sizeof(page),
+                         EEPROM_WRITE_TIMEOUT_MS) != HAL_OK) {
+        LOG_EVENT(LOG_LEVEL_ERROR, LOG_MSG_EEPROM_READ_ERROR);
+        return false;
     }
+    if (decodeLayout(page) == 0) return false;
+    memcpy(records, page + LAYOUT_SIZE, EEPROM_SETTINGS_COPIES * EEPROM_SETTINGS_RECORD_SIZE);
+    return true;
+}
+
+bool writeSettingsRecord(uint8_t copy, const uint8_t* record) {
+    EEPROMRequest req = {
+        .isWrite = true,
+        .slot = copy,
+        .item = EEPROM_ITEM_SETTINGS
+    };
+    memcpy(req.data.settings, record, EEPROM_SETTINGS_RECORD_SIZE);
+    return eepromRequestWait(&req) == HAL_OK;
+}
+
+uint16_t readPriceFromEEPROM(uint8_t slot) {
+    uint16_t price = 0xFFFF;
+    EEPROMRequest req = {
+        .isWrite = false,
+        .slot = slot,
+        .item = EEPROM_ITEM_PRICE,
+        .priceOutSimple = &price
+    };
+    eepromRequestWait(&req);
     return price;
 }
 
-void saveTransactionState(uint32_t liters, uint32_t price, FSMState state, FuelMode mode, bool modeSelected) {
-    extern QueueHandle_t eepromQueue;
+// Поколение последнего снимка транзакции рукава (backup SRAM и журнал): задаётся
+// restoreTransactionState, растёт с каждым сохранением задачи FSM и прерывания PVD
+static volatile uint32_t liveGeneration[FSM_CONTEXT_COUNT];
+
+// Снимок в backup SRAM со следующим поколением. Поколение берётся и копия пишется при
+// запрещённых прерываниях: PVD (приоритет выше FreeRTOS, критические секции его не задерживают)
+// не вклинится между ними и не запишет снимок с тем же поколением. Можно вызывать из прерывания
+static uint32_t writeBackup(uint8_t slot, uint32_t liters, uint32_t price, FSMState state, FuelMode mode, bool modeSelected) {
+    if (slot >= FSM_CONTEXT_COUNT) return 0;
+    BackupTransaction t = {
+        .liters = liters,
+        .priceTotal = price,
+        .state = (uint8_t)state,
+        .mode = (uint8_t)mode,
+        .modeSelected = modeSelected
+    };
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    t.generation = ++liveGeneration[slot];
+    backupWrite(slot, &t);
+    __set_PRIMASK(primask);
+    return t.generation;
+}
+
+void updateTransactionState(uint8_t slot, uint32_t liters, uint32_t price, FSMState state, FuelMode mode, bool modeSelected) {
+    writeBackup(slot, liters, price, state, mode, modeSelected);
+}
+
+void saveTransactionState(uint8_t slot, uint32_t liters, uint32_t price, FSMState state, FuelMode mode, bool modeSelected) {
     EEPROMRequest req = {
         .isWrite = true,
-        .memAddr = EEPROM_LITERS_ADDR,
+        .slot = slot,
+        .item = EEPROM_ITEM_TRANSACTION,
         .data.transaction.liters = liters,
         .data.transaction.price = price,
         .data.transaction.state = state,
         .data.transaction.mode = mode,
-        .data.transaction.modeSelected = modeSelected
+        .data.transaction.modeSelected = modeSelected,
+        .data.transaction.generation = writeBackup(slot, liters, price, state, mode, modeSelected)
     };
-    xQueueSend(eepromQueue, &req, portMAX_DELAY);
+    eepromSubmit(&req);
 }
 
-bool restoreTransactionState(uint32_t* liters, uint32_t* price, FSMState* state, FuelMode* mode, bool* modeSelected) {
-    extern QueueHandle_t eepromQueue;
+// Снимок из журнала или из backup SRAM - какой свежее. Если свежее журнал (батарея была
+// снята), он же переписывается в backup SRAM, и поколения продолжаются от него
+bool restoreTransactionState(uint8_t slot, uint32_t* liters, uint32_t* price, FSMState* state, FuelMode* mode, bool* modeSelected) {
+    uint32_t generation = 0;
     EEPROMRequest req = {
         .isWrite = false,
-        .memAddr = EEPROM_LITERS_ADDR,
+        .slot = slot,
+        .item = EEPROM_ITEM_TRANSACTION,
         .litersOut = liters,
         .priceOut = price,
         .stateOut = state,
         .modeOut = mode,
-        .modeSelectedOut = modeSelected
+        .modeSelectedOut = modeSelected,
+        .generationOut = &generation
     };
-    xQueueSend(eepromQueue, &req, portMAX_DELAY);
-    // Ждём выполнения операции (блокирующий вызов)
-    while (uxQueueMessagesWaiting(eepromQueue) > 0) {
-        vTaskDelay(1 / portTICK_PERIOD_MS);
+    bool stored = eepromRequestWait(&req) == HAL_OK &&
+                  *liters != 0xFFFFFFFF && *price != 0xFFFFFFFF && *(uint8_t*)state != 0xFF;
+    if (!stored) generation = 0;
+    if (slot >= FSM_CONTEXT_COUNT) return false;
+
+    BackupTransaction backup;
+    bool backed = backupRead(slot, &backup);
+    LOG_EVENT(LOG_LEVEL_DEBUG, LOG_MSG_BACKUP_RESTORE, slot, backed ? backup.generation : 0, generation);
+    if (backed && backup.generation > generation) {
+        *liters = backup.liters;
+        *price = backup.priceTotal;
+        *state = (FSMState)backup.state;
+        *mode = (FuelMode)backup.mode;
+        *modeSelected = backup.modeSelected != 0;
+        liveGeneration[slot] = backup.generation;
+        return true;
+    }
+    liveGeneration[slot] = generation;
+    if (stored && !(backed && backup.generation == generation)) {
+        backup.generation = generation;
+        backup.liters = *liters;
+        backup.priceTotal = *price;
+        backup.state = (uint8_t)*state;
+        backup.mode = (uint8_t)*mode;
+        backup.modeSelected = *modeSelected;
+        backupWrite(slot, &backup);
     }
-    return (*liters != 0xFFFFFFFF && *price != 0xFFFFFFFF && *(uint8_t*)state != 0xFF);
+    return stored;
 }
@@ -3,12 +3,13 @@
 #include "frame.h"
 #include "crc.h"
 #include "config.h"
+#include <string.h>
 
 // Формирование кадра
 void assembleFrame(const uint8_t* slaveAddress, char command, const uint8_t* payload, int payloadLength, uint8_t* frameBuffer, int* frameLength) {
     if (payloadLength > MAX_FRAME_PAYLOAD) return;
     int index = 0;
-    frameBuffer[index++] = 0x02; // STX
+    frameBuffer[index++] = FRAME_STX;
     frameBuffer[index++] = slaveAddress[0];
     frameBuffer[index++] = slaveAddress[1];
     frameBuffer[index++] = (uint8_t)command;
@@ -19,3 +20,93 @@ void assembleFrame(const uint8_t* slaveAddress, char command, const uint8_t* pay
     frameBuffer[index++] = crc;
     *frameLength = index;
 }
+
+// Длина ответа по коду команды (0 - переменная длина, кадр закрывается паузой)
+uint8_t frameExpectedLength(char command) {
+    switch (command) {
+        case 'S': return STATUS_RESPONSE_LENGTH;
+        case 'L':
+        case 'R': return MONITOR_RESPONSE_LENGTH;
+        case 'C': return TOTAL_COUNTER_RESPONSE_LENGTH;
+        default:  return 0; // T и прочие ответы имеют переменную длину
+    }
+}
+
+// Проверка уже накопленной части заголовка: STX, 0x00, номер поста 1..32
+static bool headerValid(const FrameAssembler* fa) {
+    if (fa->length > 0 && fa->buffer[0] != FRAME_STX) return false;
+    if (fa->length > 1 && fa->buffer[1] != 0x00) return false;
+    if (fa->length > 2 && (fa->buffer[2] == 0 || fa->buffer[2] > 32)) return false;
+    return true;
+}
+
+static void updateExpectedLength(FrameAssembler* fa) {
+    fa->expectedLength = (fa->length > 3) ? frameExpectedLength((char)fa->buffer[3]) : 0;
+}
+
+// Отбрасывает байты до следующего STX, пока заголовок не станет корректным
+static void resync(FrameAssembler* fa) {
+    while (fa->length > 0) {
+        uint8_t skip = 1;
+        while (skip < fa->length && fa->buffer[skip] != FRAME_STX) skip++;
+        fa->droppedBytes += skip;
+        fa->length -= skip;
+        memmove(fa->buffer, fa->buffer + skip, fa->length);
+        if (headerValid(fa)) break;
+    }
+    updateExpectedLength(fa);
+}
+
+// Переносит готовый кадр в fa->frame и сдвигает остаток буфера
+static int takeFrame(FrameAssembler* fa, uint8_t len) {
+    memcpy(fa->frame, fa->buffer, len);
+    fa->length -= len;
+    memmove(fa->buffer, fa->buffer + len, fa->length);
+    if (!headerValid(fa)) {
+        resync(fa);
+    } else {
+        updateExpectedLength(fa);
+    }
+    return len;
+}
+
+static int checkComplete(FrameAssembler* fa) {
+    for (;;) {
+        uint8_t len;
+        if (fa->expectedLength != 0 && fa->length >= fa->expectedLength) {
+            len = fa->expectedLength;
+        } else if (fa->length >= MAX_FRAME_LENGTH) {
+            len = MAX_FRAME_LENGTH;
+        } else {
+            return 0;
+        }
+        if (calculateCRC(fa->buffer, len - 1) == fa->buffer[len - 1]) {
+            return takeFrame(fa, len);
+        }
+        fa->crcErrors++;
+        resync(fa);
+    }
+}
+
+void frameAssemblerReset(FrameAssembler* fa) {
+    memset(fa, 0, sizeof(*fa));
+}
+
+// Приём очередного байта: кадры фиксированной длины закрываются по счётчику
+int frameAssemblerPush(FrameAssembler* fa, uint8_t byte) {
+    fa->buffer[fa->length++] = byte;
+    if (!headerValid(fa)) {
+        resync(fa);
+    } else if (fa->length == 4) {
+        updateExpectedLength(fa);
+    }
+    return checkComplete(fa);
+}
+
+// Пауза на линии: закрывает кадр переменной длины, если сошлась CRC.
+// Иначе байты остаются в буфере - ТРК может выдерживать паузы между байтами
+int frameAssemblerIdle(FrameAssembler* fa) {
+    if (fa->expectedLength != 0 || fa->length < FRAME_MIN_LENGTH) return 0;
+    if (calculateCRC(fa->buffer, fa->length - 1) != fa->buffer[fa->length - 1]) return 0;
+    return takeFrame(fa, fa->length);
+}
@@ -2,46 +2,110 @@
 
 #include "fsm.h"
 #include "config.h"
+#include "settings.h"
 #include "eeprom.h"
 #include "oled.h"
 #include "rs422.h"
 #include "crc.h"
-#include <stdio.h>
+#include "log.h"
 #include <string.h>
 #include <stdbool.h>
 #include "FreeRTOS.h"
 #include "task.h"
 #include <stdlib.h>
 
-// Объявление Error_Handler (определён в main.c)
-void Error_Handler(void);
+// Вывод на дисплей только для рукава, выбранного пользователем. Дисплею передаются
+// значения, текст формирует задача OLED
+static void showState(const FSMContext* ctx, const DisplayState* state) {
+    if (ctx->hasFocus) {
+        displayState(state);
+    }
+}
+
+// Экран из строковой константы
+static void showMessage(const FSMContext* ctx, const char* text) {
+    DisplayState state = { .screen = DISPLAY_SCREEN_TEXT, .text = text };
+    showState(ctx, &state);
+}
+
+// Кратковременное предупреждение поверх экрана состояния (см. displayAlert)
+static void showAlert(const FSMContext* ctx, const char* text) {
+    if (ctx->hasFocus) {
+        DisplayState state = { .screen = DISPLAY_SCREEN_TEXT, .text = text };
+        displayAlert(&state);
+    }
+}
+
+// Экран ввода объёма или суммы после сброса введённого значения
+static void showPriceInputPrompt(const FSMContext* ctx) {
+    showMessage(ctx, ctx->fuelMode == FUEL_BY_VOLUME ? "Enter Volume" : "Enter Amount");
+}
 
-static SemaphoreHandle_t logMutex; // Мьютекс для синхронизации логов
+// Введённые символы с подписью ("Volume: 12.5")
+static void showInput(const FSMContext* ctx, const char* label) {
+    DisplayState state = { .screen = DISPLAY_SCREEN_INPUT, .text = label };
+    strcpy(state.input, ctx->priceInput);
+    showState(ctx, &state);
+}
 
 // Вспомогательные функции форматирования
-static void formatLiters(uint32_t dl, char* dst, size_t dstLen) {
-    uint32_t intPart = dl / 100;
-    uint32_t fracPart = dl % 100;
-    snprintf(dst, dstLen, "%lu.%02lu", (unsigned long)intPart, (unsigned long)fracPart);
+// Введённое значение в лог: цифры без точки и позиция точки (-1 - точки нет)
+static void logPriceInput(const FSMContext* ctx) {
+    uint32_t digits = 0;
+    int point = -1;
+    for (int i = 0; ctx->priceInput[i] != '\0'; i++) {
+        if (ctx->priceInput[i] == '.') {
+            point = i;
+        } else {
+            digits = digits * 10 + (uint32_t)(ctx->priceInput[i] - '0');
+        }
+    }
+    LOG_EVENT(LOG_LEVEL_DEBUG, LOG_MSG_INPUT, digits, point);
+}
+
+static void displayFuelMode(const FSMContext* ctx) {
+    DisplayState state = { .screen = DISPLAY_SCREEN_FUEL_MODE, .mode = ctx->fuelMode };
+    showState(ctx, &state);
 }
 
-static void displayFuelMode(FuelMode mode) {
-    char msg[32];
-    switch (mode) {
-        case FUEL_BY_VOLUME:    snprintf(msg, sizeof(msg), "Mode: Volume");     break;
-        case FUEL_BY_PRICE:     snprintf(msg, sizeof(msg), "Mode: Price");      break;
-        case FUEL_BY_FULL_TANK: snprintf(msg, sizeof(msg), "Mode: Full Tank");  break;
+static void displayTransaction(const FSMContext* ctx, uint32_t liters, uint32_t amount, DisplayStatus status) {
+    DisplayState state = {
+        .screen = DISPLAY_SCREEN_TRANSACTION,
+        .status = status,
+        .liters_dL = liters,
+        .amount = amount,
+        .price = ctx->price
+    };
+    showState(ctx, &state);
+}
+
+// На посту с несколькими рукавами байт [5] статуса - номер рукава, к которому он относится.
+// Для остальных рукавов поста такой статус означает, что их рукав свободен
+static void filterNozzleStatus(const FSMContext* ctx, uint8_t* buffer) {
+    if (NOZZLES_PER_POST > 1 && buffer[3] == 'S' &&
+        buffer[5] >= '1' && buffer[5] <= '9' && buffer[5] != '0' + ctx->nozzle) {
+        buffer[4] = '1';
+        buffer[5] = '0';
     }
-    displayMessage(msg);
 }
 
-static void displayTransaction(uint32_t liters, uint32_t price, const char* status, bool priceScaled) {
-    char litersBuf[12];
-    formatLiters(liters, litersBuf, sizeof(litersBuf));
-    char displayStr[48];
-    uint32_t displayPrice = priceScaled ? price * 10 : price;
-    snprintf(displayStr, sizeof(displayStr), "%s\nL: %s\nP: %lu", status, litersBuf, (unsigned long)displayPrice);
-    displayMessage(displayStr);
+// Завершение запроса, с которым выполняется текущий шаг (см. completeFSM)
+static const RS422Reply* activeReply = NULL;
+static bool activeReplyConsumed = false;
+
+// Ответ поста с приведением статуса к рукаву контекста: длина ответа,
+// 0 - ответа нет (таймаут), -1 - ошибка CRC или неожиданный ответ
+static int waitForReply(FSMContext* ctx, uint8_t* buffer, int expectedLength, char expectedCommand) {
+    if (activeReply == NULL) return 0;
+    activeReplyConsumed = true;
+    if (activeReply->status == RS422_TIMEOUT) return 0;
+    if (activeReply->status != RS422_OK || activeReply->data[3] != expectedCommand) {
+        LOG_EVENT(LOG_LEVEL_ERROR, LOG_MSG_INVALID_RESPONSE);
+        return -1;
+    }
+    memcpy(buffer, activeReply->data, activeReply->length);
+    filterNozzleStatus(ctx, buffer);
+    return activeReply->length;
 }
 
 // Обработка ответов ТРК
@@ -53,10 +117,10 @@ static bool handleResponse(uint8_t* buffer, int length, int expected, FSMContext
     }
     ctx->waitingForResponse = false;
     ctx->errorCount++;
-    if (ctx->errorCount >= MAX_ERROR_COUNT) {
+    if (ctx->errorCount >= settings->maxErrorCount) {
         ctx->state = FSM_STATE_ERROR;
         ctx->stateEntryTime = getCurrentMillis();
-        displayMessage("Pump Error");
+        showMessage(ctx, "Pump Error");
     }
     return false;
 }
@@ -92,68 +156,66 @@ static bool isValidStatus(uint8_t* buffer) {
 // Обновление состояний FSM
 static void updateCheckStatus(FSMContext* ctx) {
     unsigned long currentMillis = getCurrentMillis();
-    static unsigned long lastResponseTime = 0;
-    static unsigned long nozzleUpStartTime = 0;
-    if (currentMillis - lastResponseTime < DELAY_AFTER_RESPONSE) return;
-    lastResponseTime = currentMillis;
+    if (currentMillis - ctx->lastResponseTime < settings->delayAfterResponse) return;
+    ctx->lastResponseTime = currentMillis;
 
     if (!ctx->waitingForResponse) {
-        rs422SendStatus();
+        ctx->pendingSeq = rs422SendStatus(ctx->address);
         ctx->waitingForResponse = true;
     } else {
         uint8_t respBuffer[32] = {0};
-        int respLength = rs422WaitForResponse(respBuffer, STATUS_RESPONSE_LENGTH, 'S');
+        int respLength = waitForReply(ctx, respBuffer, STATUS_RESPONSE_LENGTH, 'S');
         if (handleResponse(respBuffer, respLength, STATUS_RESPONSE_LENGTH, ctx)) {
             if (respBuffer[4] == '9' && respBuffer[5] == '0') {
-                rs422SendNozzleOff();
+                ctx->pendingSeq = rs422SendNozzleOff(ctx->address);
                 ctx->waitingForResponse = true;
-                nozzleUpStartTime = 0;
+                ctx->nozzleUpStartTime = 0;
             } else if (respBuffer[4] == '1' && respBuffer[5] == '0') {
                 ctx->state = FSM_STATE_IDLE;
                 ctx->stateEntryTime = currentMillis;
                 ctx->nozzleUpWarning = false;
                 if (ctx->modeSelected) {
-                    displayFuelMode(ctx->fuelMode);
+                    displayFuelMode(ctx);
                 } else {
-                    displayMessage("Please select mode");
+                    showMessage(ctx, "Please select mode");
                 }
-                nozzleUpStartTime = 0;
+                ctx->nozzleUpStartTime = 0;
             } else if (respBuffer[4] == '2' && respBuffer[5] == '1') {
-                rs422SendNozzleOff();
+                ctx->pendingSeq = rs422SendNozzleOff(ctx->address);
                 ctx->waitingForResponse = true;
                 ctx->nozzleUpWarning = true;
-                if (nozzleUpStartTime == 0) {
-                    nozzleUpStartTime = currentMillis;
+                if (ctx->nozzleUpStartTime == 0) {
+                    ctx->nozzleUpStartTime = currentMillis;
                 }
-                if (currentMillis - nozzleUpStartTime > 60000) {
+                if (currentMillis - ctx->nozzleUpStartTime > 60000) {
                     ctx->state = FSM_STATE_ERROR;
                     ctx->stateEntryTime = currentMillis;
-                    displayMessage("Nozzle up long! Check");
+                    showMessage(ctx, "Nozzle up long! Check");
                 } else {
-                    displayMessage("Nozzle up! Hang up");
+                    showMessage(ctx, "Nozzle up! Hang up");
                 }
             } else if (respBuffer[4] == '7' && respBuffer[5] == '1') {
                 ctx->state = FSM_STATE_TRANSACTION_PAUSED;
                 ctx->stateEntryTime = currentMillis;
                 ctx->monitorActive = true;
                 ctx->monitorState = 0;
-                displayTransaction(ctx->currentLiters_dL, ctx->currentPriceTotal, "Paused", ctx->price > 9999);
-                saveTransactionState(ctx->currentLiters_dL, ctx->currentPriceTotal, ctx->state, ctx->fuelMode, ctx->modeSelected);
+                displayTransaction(ctx, ctx->currentLiters_dL, ctx->currentPriceTotal, DISPLAY_STATUS_PAUSED);
+                saveTransactionState(ctx->slot, ctx->currentLiters_dL, ctx->currentPriceTotal, ctx->state, ctx->fuelMode, ctx->modeSelected);
             } else if (respBuffer[4] == '6' && respBuffer[5] == '1') {
                 ctx->state = FSM_STATE_TRANSACTION;
                 ctx->stateEntryTime = currentMillis;
                 ctx->monitorActive = true;
                 ctx->monitorState = 1;
                 ctx->transactionStarted = true;
-                rs422SendLitersMonitor();
+                ctx->pendingSeq = rs422SendLitersMonitor(ctx->address);
                 ctx->waitingForResponse = true;
-                displayTransaction(ctx->currentLiters_dL, ctx->currentPriceTotal, "Restoring trans...", ctx->price > 9999);
+                displayTransaction(ctx, ctx->currentLiters_dL, ctx->currentPriceTotal, DISPLAY_STATUS_RESTORING);
             } else {
                 ctx->errorCount++;
-                if (ctx->errorCount >= MAX_ERROR_COUNT) {
+                if (ctx->errorCount >= settings->maxErrorCount) {
                     ctx->state = FSM_STATE_ERROR;
                     ctx->stateEntryTime = currentMillis;
-                    displayMessage("Pump Error");
+                    showMessage(ctx, "Pump Error");
                 }
             }
         }
@@ -162,22 +224,21 @@ static void updateCheckStatus(FSMContext* ctx) {
 
 static void updateError(FSMContext* ctx) {
     unsigned long currentMillis = getCurrentMillis();
-    static unsigned long lastResponseTime = 0;
-    if (currentMillis - lastResponseTime < DELAY_AFTER_RESPONSE) return;
-    lastResponseTime = currentMillis;
+    if (currentMillis - ctx->lastResponseTime < settings->delayAfterResponse) return;
+    ctx->lastResponseTime = currentMillis;
 
-    if (currentMillis - ctx->stateEntryTime >= RESPONSE_TIMEOUT) {
-        rs422SendStatus();
+    if (currentMillis - ctx->stateEntryTime >= settings->responseTimeout) {
+        ctx->pendingSeq = rs422SendStatus(ctx->address);
         ctx->waitingForResponse = true;
         ctx->stateEntryTime = currentMillis;
-        displayMessage("Pump offline! Check");
+        showMessage(ctx, "Pump offline! Check");
     }
     if (ctx->waitingForResponse) {
         uint8_t respBuffer[32] = {0};
-        int respLength = rs422WaitForResponse(respBuffer, STATUS_RESPONSE_LENGTH, 'S');
+        int respLength = waitForReply(ctx, respBuffer, STATUS_RESPONSE_LENGTH, 'S');
         if (handleResponse(respBuffer, respLength, STATUS_RESPONSE_LENGTH, ctx)) {
             if (respBuffer[4] == '9' && respBuffer[5] == '0') {
-                rs422SendNozzleOff();
+                ctx->pendingSeq = rs422SendNozzleOff(ctx->address);
                 ctx->waitingForResponse = true;
             } else if (respBuffer[4] == '1' && respBuffer[5] == '0') {
                 ctx->state = FSM_STATE_IDLE;
@@ -188,22 +249,22 @@ static void updateError(FSMContext* ctx) {
                 ctx->monitorState = 0;
                 ctx->waitingForResponse = false;
                 if (ctx->modeSelected) {
-                    displayFuelMode(ctx->fuelMode);
+                    displayFuelMode(ctx);
                 } else {
-                    displayMessage("Please select mode");
+                    showMessage(ctx, "Please select mode");
                 }
             } else if (respBuffer[4] == '2' && respBuffer[5] == '1') {
-                rs422SendNozzleOff();
+                ctx->pendingSeq = rs422SendNozzleOff(ctx->address);
                 ctx->waitingForResponse = true;
                 ctx->nozzleUpWarning = true;
-                displayMessage("Nozzle up! Hang up");
+                showMessage(ctx, "Nozzle up! Hang up");
             } else if (respBuffer[4] == '7' && respBuffer[5] == '1') {
                 ctx->state = FSM_STATE_TRANSACTION_PAUSED;
                 ctx->stateEntryTime = currentMillis;
                 ctx->monitorActive = true;
                 ctx->monitorState = 0;
-                displayTransaction(ctx->currentLiters_dL, ctx->currentPriceTotal, "Paused", ctx->price > 9999);
-                saveTransactionState(ctx->currentLiters_dL, ctx->currentPriceTotal, ctx->state, ctx->fuelMode, ctx->modeSelected);
+                displayTransaction(ctx, ctx->currentLiters_dL, ctx->currentPriceTotal, DISPLAY_STATUS_PAUSED);
+                saveTransactionState(ctx->slot, ctx->currentLiters_dL, ctx->currentPriceTotal, ctx->state, ctx->fuelMode, ctx->modeSelected);
             } else {
                 ctx->state = FSM_STATE_CHECK_STATUS;
                 ctx->stateEntryTime = currentMillis;
@@ -215,20 +276,18 @@ static void updateError(FSMContext* ctx) {
 
 static void updateIdle(FSMContext* ctx) {
     unsigned long currentMillis = getCurrentMillis();
-    static unsigned long lastResponseTime = 0;
-    static unsigned long nozzleUpStartTime = 0;
-    if (currentMillis - lastResponseTime < DELAY_AFTER_RESPONSE) return;
-    lastResponseTime = currentMillis;
+    if (currentMillis - ctx->lastResponseTime < settings->delayAfterResponse) return;
+    ctx->lastResponseTime = currentMillis;
 
     // Принудительный сброс nozzleUpWarning через 3 секунды после входа в IDLE
     if (ctx->nozzleUpWarning && (currentMillis - ctx->stateEntryTime > 3000)) {
         ctx->nozzleUpWarning = false;
         ctx->errorCount = 0;
-        logMessage(LOG_LEVEL_DEBUG, "Forced reset of nozzleUpWarning");
+        LOG_EVENT(LOG_LEVEL_DEBUG, LOG_MSG_NOZZLE_WARNING_RESET);
         if (ctx->modeSelected) {
-            displayFuelMode(ctx->fuelMode);
+            displayFuelMode(ctx);
         } else {
-            displayMessage("Please select mode");
+            showMessage(ctx, "Please select mode");
         }
     }
 
@@ -239,46 +298,46 @@ static void updateIdle(FSMContext* ctx) {
         ctx->monitorState = 0;
         ctx->waitingForResponse = false;
         if (ctx->modeSelected) {
-            displayFuelMode(ctx->fuelMode);
+            displayFuelMode(ctx);
         } else {
-            displayMessage("Please select mode");
+            showMessage(ctx, "Please select mode");
         }
         return;
     }
     if (ctx->statusPollingActive && !ctx->waitingForResponse) {
-        rs422SendStatus();
+        ctx->pendingSeq = rs422SendStatus(ctx->address);
         ctx->waitingForResponse = true;
     } else if (ctx->waitingForResponse) {
         uint8_t respBuffer[32] = {0};
-        int respLength = rs422WaitForResponse(respBuffer, STATUS_RESPONSE_LENGTH, 'S');
+        int respLength = waitForReply(ctx, respBuffer, STATUS_RESPONSE_LENGTH, 'S');
         if (handleResponse(respBuffer, respLength, STATUS_RESPONSE_LENGTH, ctx)) {
             if (respBuffer[4] == '9' && respBuffer[5] == '0') {
-                rs422SendNozzleOff();
+                ctx->pendingSeq = rs422SendNozzleOff(ctx->address);
                 ctx->waitingForResponse = true;
-                nozzleUpStartTime = 0;
+                ctx->nozzleUpStartTime = 0;
                 ctx->nozzleUpWarning = false;
             } else if (respBuffer[4] == '1' && respBuffer[5] == '0') {
                 ctx->nozzleUpWarning = false;
                 if (ctx->modeSelected) {
-                    displayFuelMode(ctx->fuelMode);
+                    displayFuelMode(ctx);
                 } else {
-                    displayMessage("Please select mode");
+                    showMessage(ctx, "Please select mode");
                 }
-                nozzleUpStartTime = 0;
+                ctx->nozzleUpStartTime = 0;
             } else if (respBuffer[4] == '2' && respBuffer[5] == '1') {
-                rs422SendNozzleOff();
+                ctx->pendingSeq = rs422SendNozzleOff(ctx->address);
                 ctx->waitingForResponse = true;
                 ctx->nozzleUpWarning = true;
-                if (nozzleUpStartTime == 0) {
-                    nozzleUpStartTime = currentMillis;
+                if (ctx->nozzleUpStartTime == 0) {
+                    ctx->nozzleUpStartTime = currentMillis;
                 }
-                displayMessage("Nozzle up! Hang up");
+                showMessage(ctx, "Nozzle up! Hang up");
             } else {
                 ctx->errorCount++;
-                if (ctx->errorCount >= MAX_ERROR_COUNT) {
+                if (ctx->errorCount >= settings->maxErrorCount) {
                     ctx->state = FSM_STATE_ERROR;
                     ctx->stateEntryTime = currentMillis;
-                    displayMessage("Pump Error");
+                    showMessage(ctx, "Pump Error");
                 }
             }
         }
@@ -296,9 +355,9 @@ static void updateViewPrice(FSMContext* ctx) {
         ctx->stateEntryTime = currentMillis;
         if (!ctx->nozzleUpWarning) {
             if (ctx->modeSelected) {
-                displayFuelMode(ctx->fuelMode);
+                displayFuelMode(ctx);
             } else {
-                displayMessage("Please select mode");
+                showMessage(ctx, "Please select mode");
             }
         }
     }
@@ -321,9 +380,9 @@ static void updateTransitionEditPrice(FSMContext* ctx) {
         ctx->stateEntryTime = currentMillis;
         if (!ctx->nozzleUpWarning) {
             if (ctx->modeSelected) {
-                displayFuelMode(ctx->fuelMode);
+                displayFuelMode(ctx);
             } else {
-                displayMessage("Please select mode");
+                showMessage(ctx, "Please select mode");
             }
         }
     }
@@ -331,14 +390,14 @@ static void updateTransitionEditPrice(FSMContext* ctx) {
 
 static void updateEditPrice(FSMContext* ctx) {
     unsigned long currentMillis = getCurrentMillis();
-    if (currentMillis - ctx->stateEntryTime >= EDIT_TIMEOUT) {
+    if (currentMillis - ctx->stateEntryTime >= settings->editTimeout) {
         ctx->state = FSM_STATE_IDLE;
         ctx->stateEntryTime = currentMillis;
         if (!ctx->nozzleUpWarning) {
             if (ctx->modeSelected) {
-                displayFuelMode(ctx->fuelMode);
+                displayFuelMode(ctx);
             } else {
-                displayMessage("Please select mode");
+                showMessage(ctx, "Please select mode");
             }
         }
     }
@@ -350,23 +409,22 @@ static void updateConfirmTransaction(FSMContext* ctx) {
 
 static void updateTransaction(FSMContext* ctx) {
     unsigned long currentMillis = getCurrentMillis();
-    static unsigned long lastResponseTime = 0;
-    if (currentMillis - lastResponseTime < DELAY_AFTER_RESPONSE) return;
-    lastResponseTime = currentMillis;
+    if (currentMillis - ctx->lastResponseTime < settings->delayAfterResponse) return;
+    ctx->lastResponseTime = currentMillis;
 
     if (!ctx->waitingForResponse) {
         if (!ctx->transactionStarted) {
-            rs422SendStatus();
+            ctx->pendingSeq = rs422SendStatus(ctx->address);
             ctx->waitingForResponse = true;
         } else {
             if (!ctx->monitorActive) {
-                rs422SendStatus();
+                ctx->pendingSeq = rs422SendStatus(ctx->address);
                 ctx->waitingForResponse = true;
             } else {
                 switch (ctx->monitorState) {
-                    case 0: rs422SendStatus(); break;
-                    case 1: rs422SendLitersMonitor(); break;
-                    case 2: rs422SendRevenueStatus(); break;
+                    case 0: ctx->pendingSeq = rs422SendStatus(ctx->address); break;
+                    case 1: ctx->pendingSeq = rs422SendLitersMonitor(ctx->address); break;
+                    case 2: ctx->pendingSeq = rs422SendRevenueStatus(ctx->address); break;
                 }
                 ctx->waitingForResponse = true;
             }
@@ -375,40 +433,45 @@ static void updateTransaction(FSMContext* ctx) {
         uint8_t respBuffer[32] = {0};
         int expectedLength = ctx->monitorActive ? (ctx->monitorState == 0 ? STATUS_RESPONSE_LENGTH : MONITOR_RESPONSE_LENGTH) : STATUS_RESPONSE_LENGTH;
         char expectedCommand = ctx->monitorState == 0 ? 'S' : (ctx->monitorState == 1 ? 'L' : 'R');
-        int respLength = rs422WaitForResponse(respBuffer, expectedLength, expectedCommand);
+        int respLength = waitForReply(ctx, respBuffer, expectedLength, expectedCommand);
         if (handleResponse(respBuffer, respLength, STATUS_RESPONSE_LENGTH, ctx)) {
             if (!ctx->transactionStarted && respBuffer[4] == '2' && respBuffer[5] == '1') { // Только S21
                 uint16_t protocolPrice = ctx->price > 9999 ? ctx->price / 10 : ctx->price;
-                rs422SendTransaction(ctx->fuelMode, ctx->transactionVolume, ctx->transactionAmount, protocolPrice);
+                ctx->pendingSeq = rs422SendTransaction(ctx->address, ctx->nozzle, ctx->fuelMode, ctx->transactionVolume, ctx->transactionAmount, protocolPrice);
                 ctx->waitingForResponse = true;
                 ctx->transactionStarted = true;
                 ctx->currentLiters_dL = 0;
                 ctx->currentPriceTotal = 0;
                 ctx->errorCount = 0;
-                displayTransaction(ctx->currentLiters_dL, ctx->currentPriceTotal, "Dispensing...", ctx->price > 9999);
-                logMessage(LOG_LEVEL_DEBUG, "Transaction started");
+                ctx->restoredTransaction = false;
+                displayTransaction(ctx, ctx->currentLiters_dL, ctx->currentPriceTotal, DISPLAY_STATUS_DISPENSING);
+                LOG_EVENT(LOG_LEVEL_DEBUG, LOG_MSG_TRANSACTION_STARTED);
             } else if (ctx->monitorState == 0) {
                 if (isValidStatus(respBuffer)) {
                     for (size_t i = 0; i < sizeof(statusActions) / sizeof(statusActions[0]); i++) {
                         if (respBuffer[4] == statusActions[i].code[0] && respBuffer[5] == statusActions[i].code[1]) {
-                            ctx->state = statusActions[i].nextState;
+                            // Статус 90 - пистолет повешен, а итог ещё не подтверждён: его нужно запросить (T),
+                            // а не закрыть. Так бывает, если ТРК прошла 81 между опросами или завершила
+                            // восстановленную транзакцию, пока питания не было
+                            bool closedUnconfirmed = (ctx->transactionStarted || ctx->restoredTransaction) &&
+                                                     respBuffer[4] == '9' && respBuffer[5] == '0';
+                            FSMState nextState = closedUnconfirmed ? FSM_STATE_TRANSACTION_END : statusActions[i].nextState;
+                            ctx->state = nextState;
                             ctx->stateEntryTime = currentMillis;
                             if (statusActions[i].resetErrorCount) ctx->errorCount = 0;
-                            if (statusActions[i].nextState == FSM_STATE_TRANSACTION_END) {
-                                rs422SendTransactionUpdate();
+                            if (nextState == FSM_STATE_TRANSACTION_END) {
+                                // N отправит updateTransactionEnd, когда завершится запрос T
+                                ctx->pendingSeq = rs422SendTransactionUpdate(ctx->address);
                                 ctx->waitingForResponse = true;
-                                if (respBuffer[4] == '9' && respBuffer[5] == '0') {
-                                    rs422SendNozzleOff();
-                                }
-                                displayTransaction(ctx->currentLiters_dL, ctx->currentPriceTotal, "Trans stopped", ctx->price > 9999);
-                                saveTransactionState(ctx->currentLiters_dL, ctx->currentPriceTotal, ctx->state, ctx->fuelMode, ctx->modeSelected);
-                            } else if (statusActions[i].nextState == FSM_STATE_TRANSACTION_PAUSED) {
-                                displayTransaction(ctx->currentLiters_dL, ctx->currentPriceTotal, "Paused", ctx->price > 9999);
-                                saveTransactionState(ctx->currentLiters_dL, ctx->currentPriceTotal, ctx->state, ctx->fuelMode, ctx->modeSelected);
-                            } else if (statusActions[i].nextState == FSM_STATE_TRANSACTION && respBuffer[4] == '6' && respBuffer[5] == '1') {
+                                displayTransaction(ctx, ctx->currentLiters_dL, ctx->currentPriceTotal, DISPLAY_STATUS_STOPPED);
+                                saveTransactionState(ctx->slot, ctx->currentLiters_dL, ctx->currentPriceTotal, ctx->state, ctx->fuelMode, ctx->modeSelected);
+                            } else if (nextState == FSM_STATE_TRANSACTION_PAUSED) {
+                                displayTransaction(ctx, ctx->currentLiters_dL, ctx->currentPriceTotal, DISPLAY_STATUS_PAUSED);
+                                saveTransactionState(ctx->slot, ctx->currentLiters_dL, ctx->currentPriceTotal, ctx->state, ctx->fuelMode, ctx->modeSelected);
+                            } else if (nextState == FSM_STATE_TRANSACTION && respBuffer[4] == '6' && respBuffer[5] == '1') {
                                 ctx->monitorActive = true;
                                 ctx->monitorState = 1;
-                                rs422SendLitersMonitor();
+                                ctx->pendingSeq = rs422SendLitersMonitor(ctx->address);
                                 ctx->waitingForResponse = true;
                             }
                             break;
@@ -416,7 +479,7 @@ static void updateTransaction(FSMContext* ctx) {
                     }
                 }
             } else if (ctx->monitorActive) {
-                if (ctx->monitorState == 1 && respBuffer[3] == 'L' && respBuffer[4] == '1') {
+                if (ctx->monitorState == 1 && respBuffer[3] == 'L' && respBuffer[4] == '0' + ctx->nozzle) {
                     char litersStr[7] = {0};
                     if (respLength >= 14) {
                         memcpy(litersStr, respBuffer + 8, 6);
@@ -428,10 +491,11 @@ static void updateTransaction(FSMContext* ctx) {
                             }
                         }
                         ctx->currentLiters_dL = valid ? atol(litersStr) : ctx->currentLiters_dL;
-                        displayTransaction(ctx->currentLiters_dL, ctx->currentPriceTotal, "Dispensing...", ctx->price > 9999);
+                        displayTransaction(ctx, ctx->currentLiters_dL, ctx->currentPriceTotal, DISPLAY_STATUS_DISPENSING);
+                        updateTransactionState(ctx->slot, ctx->currentLiters_dL, ctx->currentPriceTotal, ctx->state, ctx->fuelMode, ctx->modeSelected);
                     }
                     ctx->monitorState = 2;
-                } else if (ctx->monitorState == 2 && respBuffer[3] == 'R' && respBuffer[4] == '1') {
+                } else if (ctx->monitorState == 2 && respBuffer[3] == 'R' && respBuffer[4] == '0' + ctx->nozzle) {
                     char priceStr[7] = {0};
                     if (respLength >= 14) {
                         memcpy(priceStr, respBuffer + 8, 6);
@@ -443,7 +507,8 @@ static void updateTransaction(FSMContext* ctx) {
                             }
                         }
                         ctx->currentPriceTotal = valid ? atol(priceStr) : ctx->currentPriceTotal;
-                        displayTransaction(ctx->currentLiters_dL, ctx->currentPriceTotal, "Dispensing...", ctx->price > 9999);
+                        displayTransaction(ctx, ctx->currentLiters_dL, ctx->currentPriceTotal, DISPLAY_STATUS_DISPENSING);
+                        updateTransactionState(ctx->slot, ctx->currentLiters_dL, ctx->currentPriceTotal, ctx->state, ctx->fuelMode, ctx->modeSelected);
                     }
                     ctx->monitorState = 0;
                 }
@@ -454,43 +519,42 @@ static void updateTransaction(FSMContext* ctx) {
 
 static void updateTransactionPaused(FSMContext* ctx) {
     unsigned long currentMillis = getCurrentMillis();
-    static unsigned long lastResponseTime = 0;
-    if (currentMillis - lastResponseTime < DELAY_AFTER_RESPONSE) return;
-    lastResponseTime = currentMillis;
+    if (currentMillis - ctx->lastResponseTime < settings->delayAfterResponse) return;
+    ctx->lastResponseTime = currentMillis;
 
     if (currentMillis - ctx->stateEntryTime > 30000) {
         ctx->finalLiters_dL = ctx->currentLiters_dL;
         ctx->finalPriceTotal = ctx->currentPriceTotal;
-        rs422SendTransactionUpdate();
+        ctx->pendingSeq = rs422SendTransactionUpdate(ctx->address);
         ctx->waitingForResponse = true;
         ctx->state = FSM_STATE_TRANSACTION_END;
         ctx->stateEntryTime = currentMillis;
-        displayMessage("Nozzle back! Trans end");
-        saveTransactionState(ctx->finalLiters_dL, ctx->finalPriceTotal, ctx->state, ctx->fuelMode, ctx->modeSelected);
+        showMessage(ctx, "Nozzle back! Trans end");
+        saveTransactionState(ctx->slot, ctx->finalLiters_dL, ctx->finalPriceTotal, ctx->state, ctx->fuelMode, ctx->modeSelected);
         return;
     }
 
     if (!ctx->waitingForResponse) {
-        rs422SendStatus();
+        ctx->pendingSeq = rs422SendStatus(ctx->address);
         ctx->waitingForResponse = true;
     } else {
         uint8_t respBuffer[32] = {0};
-        int respLength = rs422WaitForResponse(respBuffer, STATUS_RESPONSE_LENGTH, 'S');
+        int respLength = waitForReply(ctx, respBuffer, STATUS_RESPONSE_LENGTH, 'S');
         if (handleResponse(respBuffer, respLength, STATUS_RESPONSE_LENGTH, ctx)) {
             if (respBuffer[4] == '9' && respBuffer[5] == '0') {
                 ctx->finalLiters_dL = ctx->currentLiters_dL;
                 ctx->finalPriceTotal = ctx->currentPriceTotal;
-                rs422SendTransactionUpdate();
+                ctx->pendingSeq = rs422SendTransactionUpdate(ctx->address);
                 ctx->waitingForResponse = true;
                 ctx->state = FSM_STATE_TRANSACTION_END;
                 ctx->stateEntryTime = currentMillis;
-                saveTransactionState(ctx->finalLiters_dL, ctx->finalPriceTotal, ctx->state, ctx->fuelMode, ctx->modeSelected);
+                saveTransactionState(ctx->slot, ctx->finalLiters_dL, ctx->finalPriceTotal, ctx->state, ctx->fuelMode, ctx->modeSelected);
             } else if (respBuffer[4] != '7' || respBuffer[5] != '1') {
                 ctx->monitorActive = true;
                 ctx->monitorState = 0;
                 ctx->state = FSM_STATE_TRANSACTION;
                 ctx->stateEntryTime = currentMillis;
-                displayTransaction(ctx->currentLiters_dL, ctx->currentPriceTotal, "Dispensing...", ctx->price > 9999);
+                displayTransaction(ctx, ctx->currentLiters_dL, ctx->currentPriceTotal, DISPLAY_STATUS_DISPENSING);
             }
         }
     }
@@ -498,32 +562,27 @@ static void updateTransactionPaused(FSMContext* ctx) {
 
 static void updateTransactionEnd(FSMContext* ctx) {
     unsigned long currentMillis = getCurrentMillis();
-    static unsigned long lastResponseTime = 0;
-    static bool dataReceived = false;
-    static uint8_t retryCount = 0;
 
     if (ctx->stateEntryTime == currentMillis) {
-        dataReceived = false;
-        retryCount = 0;
+        ctx->transactionDataReceived = false;
+        ctx->transactionRetryCount = 0;
     }
 
-    if (currentMillis - lastResponseTime < DELAY_AFTER_RESPONSE) return;
-    lastResponseTime = currentMillis;
+    if (currentMillis - ctx->lastResponseTime < settings->delayAfterResponse) return;
+    ctx->lastResponseTime = currentMillis;
 
-    if (!ctx->waitingForResponse && !dataReceived && retryCount < 5) {
-        rs422SendTransactionUpdate();
+    if (!ctx->waitingForResponse && !ctx->transactionDataReceived && ctx->transactionRetryCount < 5) {
+        ctx->pendingSeq = rs422SendTransactionUpdate(ctx->address);
         ctx->waitingForResponse = true;
-        retryCount++;
-        char logMsg[64];
-        snprintf(logMsg, sizeof(logMsg), "Requesting transaction update, attempt: %d", retryCount);
-        logMessage(LOG_LEVEL_DEBUG, logMsg);
+        ctx->transactionRetryCount++;
+        LOG_EVENT(LOG_LEVEL_DEBUG, LOG_MSG_TRANSACTION_REQUEST, ctx->transactionRetryCount);
     } else if (ctx->waitingForResponse) {
         uint8_t respBuffer[32] = {0};
-        int respLength = rs422WaitForResponse(respBuffer, TRANSACTION_END_RESPONSE_LENGTH, 'T');
-        if (respLength >= 18) {
+        int respLength = waitForReply(ctx, respBuffer, TRANSACTION_END_RESPONSE_LENGTH, 'T');
+        if (respLength >= TRANSACTION_END_MIN_LENGTH) {
             ctx->waitingForResponse = false;
             ctx->errorCount = 0;
-            if (respBuffer[3] == 'T' && respBuffer[4] == '1') {
+            if (respBuffer[3] == 'T' && respBuffer[4] == '0' + ctx->nozzle) {
                 char priceStr[7] = {0};
                 char litersStr[7] = {0};
                 int offset = (respBuffer[5] == 'u') ? 10 : 8;
@@ -537,31 +596,49 @@ static void updateTransactionEnd(FSMContext* ctx) {
                     }
                 }
                 if (valid) {
+                    // Сверка восстановленного снимка: итог по счётчику ТРК
+                    if (ctx->restoredTransaction) {
+                        LOG_EVENT(LOG_LEVEL_DEBUG, LOG_MSG_RESTORED_RECONCILED, ctx->finalLiters_dL, ctx->finalPriceTotal,
+                                  (uint32_t)atol(litersStr), (uint32_t)atol(priceStr));
+                    }
                     ctx->finalLiters_dL = atol(litersStr);
                     ctx->finalPriceTotal = atol(priceStr);
                 } else {
-                    logMessage(LOG_LEVEL_ERROR, "Invalid transaction data, using last valid values");
+                    LOG_EVENT(LOG_LEVEL_ERROR, LOG_MSG_TRANSACTION_INVALID);
                 }
-                displayTransaction(ctx->finalLiters_dL, ctx->finalPriceTotal, "Filling end", ctx->price > 9999);
-                rs422SendNozzleOff();
+                // Продажа в историю: по ней сверяется смена, когда верхний уровень недоступен
+                HistoryRecord sale = {
+                    .timeMs = currentMillis,
+                    .preset = ctx->fuelMode == FUEL_BY_VOLUME ? ctx->transactionVolume : ctx->transactionAmount,
+                    .liters = ctx->finalLiters_dL,
+                    .amount = ctx->finalPriceTotal,
+                    .price = ctx->price,
+                    .slot = ctx->slot,
+                    .mode = ctx->fuelMode,
+                    .restored = ctx->restoredTransaction
+                };
+                appendHistory(&sale);
+                ctx->restoredTransaction = false;
+                displayTransaction(ctx, ctx->finalLiters_dL, ctx->finalPriceTotal, DISPLAY_STATUS_END);
+                ctx->pendingSeq = rs422SendNozzleOff(ctx->address);
                 ctx->waitingForResponse = false;
-                dataReceived = true;
-                retryCount = 0;
-                saveTransactionState(ctx->finalLiters_dL, ctx->finalPriceTotal, ctx->state, ctx->fuelMode, ctx->modeSelected);
-                char logMsg[64];
-                snprintf(logMsg, sizeof(logMsg), "Transaction end: Liters=%lu, Price=%lu",
-                         (unsigned long)ctx->finalLiters_dL, (unsigned long)ctx->finalPriceTotal);
-                logMessage(LOG_LEVEL_DEBUG, logMsg);
+                ctx->transactionDataReceived = true;
+                ctx->transactionRetryCount = 0;
+                // Итог получен: после перезапуска восстанавливать нечего. Итог продажи пишется
+                // в журнал сразу, не дожидаясь затишья
+                saveTransactionState(ctx->slot, ctx->finalLiters_dL, ctx->finalPriceTotal, FSM_STATE_IDLE, ctx->fuelMode, ctx->modeSelected);
+                flushEEPROM();
+                LOG_EVENT(LOG_LEVEL_DEBUG, LOG_MSG_TRANSACTION_END, ctx->finalLiters_dL, ctx->finalPriceTotal);
             }
         } else {
             ctx->waitingForResponse = false;
             ctx->errorCount++;
-            retryCount++;
-            if (retryCount >= 5) {
+            ctx->transactionRetryCount++;
+            if (ctx->transactionRetryCount >= 5) {
                 ctx->state = FSM_STATE_ERROR;
                 ctx->stateEntryTime = currentMillis;
-                displayMessage("Trans error! Check pump");
-                logMessage(LOG_LEVEL_ERROR, "Transaction data error after retries");
+                showMessage(ctx, "Trans error! Check pump");
+                LOG_EVENT(LOG_LEVEL_ERROR, LOG_MSG_TRANSACTION_FAILED);
             }
         }
     }
@@ -569,20 +646,19 @@ static void updateTransactionEnd(FSMContext* ctx) {
 
 static void updateTotalCounter(FSMContext* ctx) {
     unsigned long currentMillis = getCurrentMillis();
-    static unsigned long lastResponseTime = 0;
-    if (currentMillis - lastResponseTime < DELAY_AFTER_RESPONSE) return;
-    lastResponseTime = currentMillis;
+    if (currentMillis - ctx->lastResponseTime < settings->delayAfterResponse) return;
+    ctx->lastResponseTime = currentMillis;
 
-    if (!ctx->waitingForResponse && ctx->c0RetryCount < MAX_ERROR_COUNT && (currentMillis - ctx->lastC0SendTime) >= RESPONSE_TIMEOUT) {
-        rs422SendTotalCounter();
+    if (!ctx->waitingForResponse && ctx->c0RetryCount < settings->maxErrorCount && (currentMillis - ctx->lastC0SendTime) >= settings->responseTimeout) {
+        ctx->pendingSeq = rs422SendTotalCounter(ctx->address, ctx->nozzle);
         ctx->waitingForResponse = true;
         ctx->lastC0SendTime = currentMillis;
         ctx->c0RetryCount++;
     } else if (ctx->waitingForResponse) {
         uint8_t respBuffer[32] = {0};
-        int respLength = rs422WaitForResponse(respBuffer, TOTAL_COUNTER_RESPONSE_LENGTH, 'C');
+        int respLength = waitForReply(ctx, respBuffer, TOTAL_COUNTER_RESPONSE_LENGTH, 'C');
         if (handleResponse(respBuffer, respLength, TOTAL_COUNTER_RESPONSE_LENGTH, ctx)) {
-            if (respBuffer[3] == 'C' && respBuffer[4] == '1') {
+            if (respBuffer[3] == 'C' && respBuffer[4] == '0' + ctx->nozzle) {
                 char totalStr[10] = {0};
                 memcpy(totalStr, respBuffer + 6, 9);
                 bool valid = true;
@@ -594,19 +670,16 @@ static void updateTotalCounter(FSMContext* ctx) {
                 }
                 if (valid) {
                     uint32_t totalLiters_mL = atol(totalStr);
-                    char litersBuf[12];
-                    formatLiters(totalLiters_mL / 10, litersBuf, sizeof(litersBuf));
-                    char displayStr[32];
-                    snprintf(displayStr, sizeof(displayStr), "TOTAL:\n%s", litersBuf);
-                    displayMessage(displayStr);
+                    DisplayState state = { .screen = DISPLAY_SCREEN_TOTAL, .liters_dL = totalLiters_mL / 10 };
+                    showState(ctx, &state);
                 } else {
-                    displayMessage("TOTAL:\nError");
+                    showMessage(ctx, "TOTAL:\nError");
                 }
                 ctx->waitingForResponse = false;
-                ctx->c0RetryCount = MAX_ERROR_COUNT;
+                ctx->c0RetryCount = settings->maxErrorCount;
             } else {
-                if (ctx->c0RetryCount >= MAX_ERROR_COUNT) {
-                    displayMessage("TOTAL:\nError");
+                if (ctx->c0RetryCount >= settings->maxErrorCount) {
+                    showMessage(ctx, "TOTAL:\nError");
                 }
             }
         }
@@ -616,29 +689,23 @@ static void updateTotalCounter(FSMContext* ctx) {
 // Инициализация FSM
 void initFSM(FSMContext* ctx)
 {
-    // Инициализация мьютекса для логов
-    logMutex = xSemaphoreCreateMutex();
-    if (logMutex == NULL) {
-        Error_Handler();
-    }
-
-    // Инициализация логов через UART3
-    char logMsg[32];
-    snprintf(logMsg, sizeof(logMsg), "FSM Initialized\r\n");
-    logMessage(LOG_LEVEL_DEBUG, logMsg);
-
-    // Отправка команды Nozzle Off
-    rs422SendNozzleOff();
+    LOG_EVENT(LOG_LEVEL_DEBUG, LOG_MSG_FSM_INIT);
 
     // Чтение цены из EEPROM
-    ctx->price = readPriceFromEEPROM();
-    ctx->priceValid = ctx->price > 0;
+    ctx->price = readPriceFromEEPROM(ctx->slot);
+    // Запись рукава, в которую ещё не писали, читается как стёртая (0xFFFF)
+    ctx->priceValid = ctx->price > 0 && ctx->price != 0xFFFF;
     ctx->fuelMode = FUEL_BY_VOLUME;
     ctx->stateEntryTime = getCurrentMillis();
     ctx->waitingForResponse = false;
+    ctx->keyCommand = 0;
     ctx->errorCount = 0;
     ctx->c0RetryCount = 0;
     ctx->lastC0SendTime = 0;
+    ctx->lastResponseTime = 0;
+    ctx->nozzleUpStartTime = 0;
+    ctx->transactionDataReceived = false;
+    ctx->transactionRetryCount = 0;
     ctx->statusPollingActive = true;
     ctx->transactionVolume = 0;
     ctx->transactionAmount = 0;
@@ -654,54 +721,94 @@ void initFSM(FSMContext* ctx)
     ctx->lastKeyTime = 0;
     ctx->priceInput[0] = '\0';
     ctx->modeSelected = false;
+    ctx->restoredTransaction = false;
 
     // Проверка сохранённой транзакции
     uint32_t savedLiters, savedPrice;
     FSMState savedState;
     FuelMode savedMode;
     bool savedModeSelected;
-    if (restoreTransactionState(&savedLiters, &savedPrice, &savedState, &savedMode, &savedModeSelected)) {
+    if (restoreTransactionState(ctx->slot, &savedLiters, &savedPrice, &savedState, &savedMode, &savedModeSelected)) {
         ctx->currentLiters_dL = savedLiters;
         ctx->currentPriceTotal = savedPrice;
         ctx->state = savedState;
-        if (savedState == FSM_STATE_TRANSACTION || savedState == FSM_STATE_TRANSACTION_PAUSED) {
+        if (savedState == FSM_STATE_TRANSACTION || savedState == FSM_STATE_TRANSACTION_PAUSED ||
+            savedState == FSM_STATE_TRANSACTION_END) {
             ctx->fuelMode = savedMode;
             ctx->modeSelected = savedModeSelected;
+            // Итог транзакции даст ответ T; до него (и если ответ неверен) итог - снимок.
+            // Сохранённое состояние FSM_STATE_TRANSACTION_END означает, что ответа T ещё не было:
+            // после него транзакция сохраняется закрытой (FSM_STATE_IDLE)
+            ctx->finalLiters_dL = savedLiters;
+            ctx->finalPriceTotal = savedPrice;
+            ctx->restoredTransaction = true;
             ctx->transactionStarted = true;
-            ctx->monitorActive = true;
+            ctx->monitorActive = savedState != FSM_STATE_TRANSACTION_END;
             ctx->monitorState = 1;
-            displayTransaction(ctx->currentLiters_dL, ctx->currentPriceTotal, "Restoring trans...", ctx->price > 9999);
+            // Nozzle Off не отправляется: он закрыл бы транзакцию на ТРК до ответа T
+            displayTransaction(ctx, ctx->currentLiters_dL, ctx->currentPriceTotal, DISPLAY_STATUS_RESTORING);
         } else {
             // Игнорируем сохранённый режим для неактивных транзакций
             ctx->state = ctx->priceValid ? FSM_STATE_CHECK_STATUS : FSM_STATE_WAIT_FOR_PRICE_INPUT;
             if (!ctx->priceValid) {
-                displayMessage("Set price (0-99999)");
+                showMessage(ctx, "Set price (0-99999)");
             } else {
-                displayMessage("Please select mode");
+                showMessage(ctx, "Please select mode");
             }
         }
     } else {
         ctx->state = ctx->priceValid ? FSM_STATE_CHECK_STATUS : FSM_STATE_WAIT_FOR_PRICE_INPUT;
         if (!ctx->priceValid) {
-            displayMessage("Set price (0-99999)");
+            showMessage(ctx, "Set price (0-99999)");
         } else {
-            displayMessage("Please select mode");
+            showMessage(ctx, "Please select mode");
         }
     }
 
-    if (ctx->state == FSM_STATE_CHECK_STATUS) {
-        rs422SendStatus();
-        ctx->waitingForResponse = true;
+    // Отправка команды Nozzle Off, если транзакция не восстановлена
+    if (!ctx->restoredTransaction) {
+        ctx->pendingSeq = rs422SendNozzleOff(ctx->address);
     }
 
+    // Первый запрос статуса отправит updateCheckStatus, когда планировщик шины
+    // выделит посту слот опроса
+
     // Отображение приветственного сообщения
-    displayMessage("CENSTAR");
-    vTaskDelay(DISPLAY_WELCOME_DURATION / portTICK_PERIOD_MS);
+    if (ctx->hasFocus) {
+        displayMessage("CENSTAR");
+        vTaskDelay(DISPLAY_WELCOME_DURATION / portTICK_PERIOD_MS);
+    }
+}
+
+// Передача команды, поставленной в очередь клавишей (processKeyFSM). Вызывается в слоте
+// опроса поста, когда предыдущий запрос завершён
+static void sendKeyCommand(FSMContext* ctx) {
+    switch (ctx->keyCommand) {
+        case 'N': ctx->pendingSeq = rs422SendNozzleOff(ctx->address); break;
+        case 'B': ctx->pendingSeq = rs422SendPause(ctx->address); break;
+        case 'G': ctx->pendingSeq = rs422SendResume(ctx->address); break;
+        case 'T': ctx->pendingSeq = rs422SendTransactionUpdate(ctx->address); break;
+        case 'C':
+            ctx->pendingSeq = rs422SendTotalCounter(ctx->address, ctx->nozzle);
+            ctx->lastC0SendTime = getCurrentMillis();
+            break;
+        default: return;
+    }
+    ctx->waitingForResponse = true;
+    ctx->keyCommand = 0;
 }
 
 // Основной цикл FSM
 void updateFSM(FSMContext* ctx)
 {
+    // Пока запрос к ТРК не завершён, контекст ждёт completeFSM
+    if (ctx->waitingForResponse && activeReply == NULL) return;
+
+    if (ctx->keyCommand != 0 && !ctx->waitingForResponse) {
+        sendKeyCommand(ctx);
+        return;
+    }
+
     switch (ctx->state) {
         case FSM_STATE_CHECK_STATUS:        updateCheckStatus(ctx); break;
         case FSM_STATE_ERROR:               updateError(ctx); break;
@@ -720,23 +827,45 @@ void updateFSM(FSMContext* ctx)
     }
 }
 
+// Шаг FSM с ответом на запрос ctx->pendingSeq. Если состояние сменилось и ответ
+// никто не разобрал (например, по клавише), ожидание снимается, чтобы контекст не завис
+void completeFSM(FSMContext* ctx, const RS422Reply* reply)
+{
+    // Ответ на запрос, переданный до клавиши, относится к прежнему состоянию: вместо его
+    // разбора шина сразу отдаётся команде по клавише
+    if (ctx->keyCommand != 0) {
+        ctx->waitingForResponse = false;
+        sendKeyCommand(ctx);
+        return;
+    }
+
+    activeReply = reply;
+    activeReplyConsumed = false;
+    updateFSM(ctx);
+    if (!activeReplyConsumed && ctx->pendingSeq == reply->seq) {
+        ctx->waitingForResponse = false;
+    }
+    activeReply = NULL;
+}
+
 // Управление вводом клавиш
 void processKeyFSM(FSMContext* ctx, char key)
 {
     unsigned long currentMillis = getCurrentMillis();
-    if (currentMillis - ctx->lastKeyTime < KEY_DEBOUNCE_MS) {
-        displayMessage("Slow down! Wait");
+    if (currentMillis - ctx->lastKeyTime < settings->keyDebounceMs) {
+        showAlert(ctx, "Slow down! Wait");
+        return;
+    }
+    // Команда по предыдущей клавише ещё не передана: клавиши, ставящие команды, ждут её
+    if (ctx->keyCommand != 0 && (key == 'A' || key == 'E' || key == 'K')) {
+        showAlert(ctx, "Slow down! Wait");
         return;
     }
     ctx->lastKeyTime = currentMillis;
 
-    char logMsg[32];
-    snprintf(logMsg, sizeof(logMsg), "Key pressed: %c", key);
-    logMessage(LOG_LEVEL_DEBUG, logMsg);
-    snprintf(logMsg, sizeof(logMsg), "Mode selected: %d", ctx->modeSelected);
-    logMessage(LOG_LEVEL_DEBUG, logMsg);
-    snprintf(logMsg, sizeof(logMsg), "Current mode: %d", ctx->fuelMode);
-    logMessage(LOG_LEVEL_DEBUG, logMsg);
+    LOG_EVENT(LOG_LEVEL_DEBUG, LOG_MSG_KEY_PRESSED, key);
+    LOG_EVENT(LOG_LEVEL_DEBUG, LOG_MSG_MODE_SELECTED, ctx->modeSelected);
+    LOG_EVENT(LOG_LEVEL_DEBUG, LOG_MSG_CURRENT_MODE, ctx->fuelMode);
 
     // Обработка клавиш в зависимости от состояния
     // Не все состояния требуют обработки клавиш (например, CHECK_STATUS, ERROR, TRANSACTION),
@@ -748,12 +877,8 @@ void processKeyFSM(FSMContext* ctx, char key)
                 if (len < PRICE_FORMAT_LENGTH) {
                     ctx->priceInput[len] = key;
                     ctx->priceInput[len + 1] = '\0';
-                    char displayStr[32];
-                    snprintf(displayStr, sizeof(displayStr), "%s: %s",
-                             ctx->fuelMode == FUEL_BY_VOLUME ? "Volume" : "Amount", ctx->priceInput);
-                    displayMessage(displayStr);
-                    snprintf(logMsg, sizeof(logMsg), "Input so far: %s", ctx->priceInput);
-                    logMessage(LOG_LEVEL_DEBUG, logMsg);
+                    showInput(ctx, ctx->fuelMode == FUEL_BY_VOLUME ? "Volume" : "Amount");
+                    logPriceInput(ctx);
                 }
                 ctx->stateEntryTime = currentMillis;
             }
@@ -762,12 +887,8 @@ void processKeyFSM(FSMContext* ctx, char key)
                 if (len < PRICE_FORMAT_LENGTH - 1 && strchr(ctx->priceInput, '.') == NULL) {
                     ctx->priceInput[len] = '.';
                     ctx->priceInput[len + 1] = '\0';
-                    char displayStr[32];
-                    snprintf(displayStr, sizeof(displayStr), "%s: %s",
-                             ctx->fuelMode == FUEL_BY_VOLUME ? "Volume" : "Amount", ctx->priceInput);
-                    displayMessage(displayStr);
-                    snprintf(logMsg, sizeof(logMsg), "Input so far: %s", ctx->priceInput);
-                    logMessage(LOG_LEVEL_DEBUG, logMsg);
+                    showInput(ctx, ctx->fuelMode == FUEL_BY_VOLUME ? "Volume" : "Amount");
+                    logPriceInput(ctx);
                 }
                 ctx->stateEntryTime = currentMillis;
             }
@@ -777,14 +898,15 @@ void processKeyFSM(FSMContext* ctx, char key)
                     ctx->stateEntryTime = currentMillis;
                     if (!ctx->nozzleUpWarning) {
                         if (ctx->modeSelected) {
-                            displayFuelMode(ctx->fuelMode);
+                            displayFuelMode(ctx);
                         } else {
-                            displayMessage("Please select mode");
+                            showMessage(ctx, "Please select mode");
                         }
                     }
                 } else {
                     ctx->priceInput[0] = '\0';
-                    displayMessage("Cleared");
+                    showAlert(ctx, "Cleared");
+                    showPriceInputPrompt(ctx);
                     ctx->stateEntryTime = currentMillis;
                 }
             }
@@ -796,23 +918,24 @@ void processKeyFSM(FSMContext* ctx, char key)
                         if (floatValue > 0 && floatValue <= 9999.99) {
                             value = (uint32_t)(floatValue * 100);
                         } else {
-                            displayMessage("Invalid volume!");
+                            showAlert(ctx, "Invalid volume!");
                             ctx->priceInput[0] = '\0';
+                            showPriceInputPrompt(ctx);
                             ctx->stateEntryTime = currentMillis;
-                            logMessage(LOG_LEVEL_ERROR, "Invalid volume: Out of range");
+                            LOG_EVENT(LOG_LEVEL_ERROR, LOG_MSG_INVALID_VOLUME);
                             break;
                         }
                     } else {
                         value = atol(ctx->priceInput);
                         if (value == 0) {
-                            displayMessage("Invalid amount!");
+                            showAlert(ctx, "Invalid amount!");
                             ctx->priceInput[0] = '\0';
+                            showPriceInputPrompt(ctx);
                             ctx->stateEntryTime = currentMillis;
-                            logMessage(LOG_LEVEL_ERROR, "Invalid amount: Zero");
+                            LOG_EVENT(LOG_LEVEL_ERROR, LOG_MSG_INVALID_AMOUNT);
                             break;
                         }
-                        snprintf(logMsg, sizeof(logMsg), "Parsed amount: %lu", (unsigned long)value);
-                        logMessage(LOG_LEVEL_DEBUG, logMsg);
+                        LOG_EVENT(LOG_LEVEL_DEBUG, LOG_MSG_PARSED_AMOUNT, value);
                     }
                     if (ctx->fuelMode == FUEL_BY_VOLUME) {
                         ctx->transactionVolume = value;
@@ -824,46 +947,44 @@ void processKeyFSM(FSMContext* ctx, char key)
                     ctx->state = FSM_STATE_CONFIRM_TRANSACTION;
                     ctx->stateEntryTime = currentMillis;
                     ctx->priceInput[0] = '\0';
-                    displayMessage("Confirm? Press K");
-                    snprintf(logMsg, sizeof(logMsg), "Confirmed value: %lu", (unsigned long)value);
-                    logMessage(LOG_LEVEL_DEBUG, logMsg);
+                    showMessage(ctx, "Confirm? Press K");
+                    LOG_EVENT(LOG_LEVEL_DEBUG, LOG_MSG_CONFIRMED_VALUE, value);
                 }
             }
             break;
         }
         case FSM_STATE_IDLE: {
             if (ctx->nozzleUpWarning && key == 'K') {
-                displayMessage("Nozzle up! Hang up");
+                showMessage(ctx, "Nozzle up! Hang up");
                 ctx->stateEntryTime = currentMillis;
             } else if (key == 'G') {
                 ctx->state = FSM_STATE_VIEW_PRICE;
                 ctx->stateEntryTime = currentMillis;
-                char priceStr[16];
-                snprintf(priceStr, sizeof(priceStr), "Price: %u", ctx->price);
-                displayMessage(priceStr);
+                DisplayState state = { .screen = DISPLAY_SCREEN_PRICE, .price = ctx->price };
+                showState(ctx, &state);
             } else if (key == 'E') {
                 ctx->statusPollingActive = true;
                 ctx->modeSelected = false;
                 if (!ctx->nozzleUpWarning) {
-                    displayMessage("Please select mode");
+                    showMessage(ctx, "Please select mode");
                 }
                 ctx->stateEntryTime = currentMillis;
             } else if (key == 'C') {
                 ctx->fuelMode = (FuelMode)((ctx->fuelMode + 1) % 3);
                 ctx->modeSelected = true;
-                displayFuelMode(ctx->fuelMode);
+                displayFuelMode(ctx);
                 ctx->stateEntryTime = currentMillis;
             } else if (key == 'K' && !ctx->nozzleUpWarning) {
                 if (ctx->fuelMode == FUEL_BY_VOLUME || ctx->fuelMode == FUEL_BY_PRICE) {
                     ctx->priceInput[0] = '\0';
                     ctx->state = FSM_STATE_WAIT_FOR_PRICE_INPUT;
-                    displayMessage(ctx->fuelMode == FUEL_BY_VOLUME ? "Enter Volume" : "Enter Amount");
+                    showPriceInputPrompt(ctx);
                 } else {
                     ctx->transactionVolume = 0;
                     ctx->transactionAmount = 999999;
                     ctx->state = FSM_STATE_CONFIRM_TRANSACTION;
                     ctx->stateEntryTime = currentMillis;
-                    displayMessage("Confirm? Press K");
+                    showMessage(ctx, "Confirm? Press K");
                 }
             } else if (key == 'A') {
                 ctx->statusPollingActive = false;
@@ -871,10 +992,9 @@ void processKeyFSM(FSMContext* ctx, char key)
                 ctx->stateEntryTime = currentMillis;
                 ctx->errorCount = 0;
                 ctx->c0RetryCount = 0;
-                ctx->waitingForResponse = true;
                 ctx->lastC0SendTime = currentMillis;
-                rs422SendTotalCounter();
-                displayMessage("TOTAL:\nWaiting...");
+                ctx->keyCommand = 'C';
+                showMessage(ctx, "TOTAL:\nWaiting...");
             }
             break;
         }
@@ -883,15 +1003,15 @@ void processKeyFSM(FSMContext* ctx, char key)
                 ctx->state = FSM_STATE_EDIT_PRICE;
                 ctx->stateEntryTime = currentMillis;
                 ctx->priceInput[0] = '\0';
-                displayMessage("Editing Price");
+                showMessage(ctx, "Editing Price");
             } else if (key == 'E') {
                 ctx->state = FSM_STATE_IDLE;
                 ctx->stateEntryTime = currentMillis;
                 if (!ctx->nozzleUpWarning) {
                     if (ctx->modeSelected) {
-                        displayFuelMode(ctx->fuelMode);
+                        displayFuelMode(ctx);
                     } else {
-                        displayMessage("Please select mode");
+                        showMessage(ctx, "Please select mode");
                     }
                 }
             }
@@ -904,34 +1024,35 @@ void processKeyFSM(FSMContext* ctx, char key)
                 if (len < PRICE_FORMAT_LENGTH) {
                     ctx->priceInput[len] = key;
                     ctx->priceInput[len + 1] = '\0';
-                    char displayStr[32];
-                    snprintf(displayStr, sizeof(displayStr), "New Price: %s", ctx->priceInput);
-                    displayMessage(displayStr);
+                    showInput(ctx, "New Price");
                 }
             } else if (key == 'E') {
                 ctx->priceInput[0] = '\0';
-                displayMessage("Price cleared");
+                showAlert(ctx, "Price cleared");
+                showMessage(ctx, "Editing Price");
             } else if (key == 'K') {
                 if (strlen(ctx->priceInput) > 0) {
                     uint16_t newPrice = atol(ctx->priceInput);
                     if (newPrice >= PRICE_MIN && newPrice <= 99999) {
                         ctx->price = newPrice;
-                        writePriceToEEPROM(ctx->price);
-                        displayMessage("Price updated!");
+                        writePriceToEEPROM(ctx->slot, ctx->price);
+                        flushEEPROM();
+                        showMessage(ctx, "Price updated!");
                         ctx->state = FSM_STATE_TRANSITION_EDIT_PRICE;
                         ctx->stateEntryTime = currentMillis;
                         ctx->priceInput[0] = '\0';
                     } else {
-                        displayMessage("Price too high! Max");
+                        showAlert(ctx, "Price too high! Max");
                         ctx->priceInput[0] = '\0';
+                        showMessage(ctx, "Editing Price");
                     }
                 } else {
                     ctx->state = FSM_STATE_IDLE;
                     if (!ctx->nozzleUpWarning) {
                         if (ctx->modeSelected) {
-                            displayFuelMode(ctx->fuelMode);
+                            displayFuelMode(ctx);
                         } else {
-                            displayMessage("Please select mode");
+                            showMessage(ctx, "Please select mode");
                         }
                     }
                     ctx->stateEntryTime = currentMillis;
@@ -947,9 +1068,9 @@ void processKeyFSM(FSMContext* ctx, char key)
                 ctx->stateEntryTime = currentMillis;
                 if (ctx->state == FSM_STATE_IDLE && !ctx->nozzleUpWarning) {
                     if (ctx->modeSelected) {
-                        displayFuelMode(ctx->fuelMode);
+                        displayFuelMode(ctx);
                     } else {
-                        displayMessage("Please select mode");
+                        showMessage(ctx, "Please select mode");
                     }
                 }
             }
@@ -959,8 +1080,8 @@ void processKeyFSM(FSMContext* ctx, char key)
             if (key == 'K') {
                 ctx->state = FSM_STATE_TRANSACTION;
                 ctx->stateEntryTime = currentMillis;
-                displayMessage("Confirm! UP Nozzle");
-                logMessage(LOG_LEVEL_DEBUG, "Transaction confirmed");
+                showMessage(ctx, "Confirm! UP Nozzle");
+                LOG_EVENT(LOG_LEVEL_DEBUG, LOG_MSG_CONFIRMED);
             } else if (key == 'E') {
                 ctx->state = FSM_STATE_IDLE;
                 ctx->stateEntryTime = currentMillis;
@@ -970,19 +1091,22 @@ void processKeyFSM(FSMContext* ctx, char key)
                 ctx->waitingForResponse = false;
                 ctx->errorCount = 0;
                 if (ctx->modeSelected) {
-                    displayFuelMode(ctx->fuelMode);
+                    displayFuelMode(ctx);
                 } else {
-                    displayMessage("Please select mode");
+                    showMessage(ctx, "Please select mode");
                 }
-                logMessage(LOG_LEVEL_DEBUG, "Confirm cancelled, returning to idle");
+                LOG_EVENT(LOG_LEVEL_DEBUG, LOG_MSG_CONFIRM_CANCELLED);
             }
             break;
         }
         case FSM_STATE_TRANSACTION: {
             if (key == 'E' && !ctx->transactionStarted) {
-                rs422SendNozzleOff();
-                ctx->waitingForResponse = false;
-                ctx->statusPollingActive = false;
+                // Отмена до начала отпуска: N уходит в слоте поста, а после его завершения IDLE
+                // возобновляет опрос статуса по своему сроку (FSM_IDLE_POLL_PERIOD после ответа) -
+                // задача FSM не ждёт. Ответ на незавершённый запрос статуса относится к отменённому
+                // отпуску и отбрасывается
+                ctx->keyCommand = 'N';
+                ctx->statusPollingActive = true;
                 ctx->state = FSM_STATE_IDLE;
                 ctx->stateEntryTime = currentMillis;
                 ctx->transactionStarted = false;
@@ -997,48 +1121,41 @@ void processKeyFSM(FSMContext* ctx, char key)
                 ctx->skipFirstStatusCheck = true;
                 ctx->transactionVolume = 0;
                 ctx->transactionAmount = 0;
-                rs422SendNozzleOff();
-                vTaskDelay(100 / portTICK_PERIOD_MS);
-                ctx->statusPollingActive = true;
-                rs422SendStatus();
                 if (!ctx->nozzleUpWarning) {
                     if (ctx->modeSelected) {
-                        displayFuelMode(ctx->fuelMode);
+                        displayFuelMode(ctx);
                     } else {
-                        displayMessage("Please select mode");
+                        showMessage(ctx, "Please select mode");
                     }
                 }
-                logMessage(LOG_LEVEL_DEBUG, "Transaction cancelled, returning to idle");
+                LOG_EVENT(LOG_LEVEL_DEBUG, LOG_MSG_CANCELLED);
             } else if (key == 'E') {
-                rs422SendPause();
-                ctx->waitingForResponse = true;
+                ctx->keyCommand = 'B';
                 ctx->state = FSM_STATE_TRANSACTION_PAUSED;
                 ctx->stateEntryTime = currentMillis;
-                displayTransaction(ctx->currentLiters_dL, ctx->currentPriceTotal, "Paused", ctx->price > 9999);
-                saveTransactionState(ctx->currentLiters_dL, ctx->currentPriceTotal, ctx->state, ctx->fuelMode, ctx->modeSelected);
-                logMessage(LOG_LEVEL_DEBUG, "Transaction paused");
+                displayTransaction(ctx, ctx->currentLiters_dL, ctx->currentPriceTotal, DISPLAY_STATUS_PAUSED);
+                saveTransactionState(ctx->slot, ctx->currentLiters_dL, ctx->currentPriceTotal, ctx->state, ctx->fuelMode, ctx->modeSelected);
+                LOG_EVENT(LOG_LEVEL_DEBUG, LOG_MSG_PAUSED);
             }
             break;
         }
         case FSM_STATE_TRANSACTION_PAUSED: {
             if (key == 'K') {
-                rs422SendResume();
-                ctx->waitingForResponse = true;
+                ctx->keyCommand = 'G';
                 ctx->state = FSM_STATE_TRANSACTION;
                 ctx->stateEntryTime = currentMillis;
                 ctx->monitorActive = true;
                 ctx->monitorState = 0;
-                displayTransaction(ctx->currentLiters_dL, ctx->currentPriceTotal, "Dispensing...", ctx->price > 9999);
-                logMessage(LOG_LEVEL_DEBUG, "Transaction resumed");
+                displayTransaction(ctx, ctx->currentLiters_dL, ctx->currentPriceTotal, DISPLAY_STATUS_DISPENSING);
+                LOG_EVENT(LOG_LEVEL_DEBUG, LOG_MSG_RESUMED);
             } else if (key == 'E') {
                 ctx->finalLiters_dL = ctx->currentLiters_dL;
                 ctx->finalPriceTotal = ctx->currentPriceTotal;
-                rs422SendTransactionUpdate();
-                ctx->waitingForResponse = true;
+                ctx->keyCommand = 'T';
                 ctx->state = FSM_STATE_TRANSACTION_END;
                 ctx->stateEntryTime = currentMillis;
-                saveTransactionState(ctx->finalLiters_dL, ctx->finalPriceTotal, ctx->state, ctx->fuelMode, ctx->modeSelected);
-                logMessage(LOG_LEVEL_DEBUG, "Transaction ended from paused");
+                saveTransactionState(ctx->slot, ctx->finalLiters_dL, ctx->finalPriceTotal, ctx->state, ctx->fuelMode, ctx->modeSelected);
+                LOG_EVENT(LOG_LEVEL_DEBUG, LOG_MSG_ENDED_FROM_PAUSED);
             }
             break;
         }
@@ -1060,11 +1177,11 @@ void processKeyFSM(FSMContext* ctx, char key)
                 ctx->transactionVolume = 0;
                 ctx->transactionAmount = 0;
                 if (ctx->modeSelected) {
-                    displayFuelMode(ctx->fuelMode);
+                    displayFuelMode(ctx);
                 } else {
-                    displayMessage("Please select mode");
+                    showMessage(ctx, "Please select mode");
                 }
-                logMessage(LOG_LEVEL_DEBUG, "Transaction end, returning to idle");
+                LOG_EVENT(LOG_LEVEL_DEBUG, LOG_MSG_ENDED);
             }
             break;
         }
@@ -1080,11 +1197,11 @@ void processKeyFSM(FSMContext* ctx, char key)
                 ctx->c0RetryCount = 0;
                 ctx->nozzleUpWarning = false;
                 if (ctx->modeSelected) {
-                    displayFuelMode(ctx->fuelMode);
+                    displayFuelMode(ctx);
                 } else {
-                    displayMessage("Please select mode");
+                    showMessage(ctx, "Please select mode");
                 }
-                logMessage(LOG_LEVEL_DEBUG, "Total counter cancelled, returning to idle");
+                LOG_EVENT(LOG_LEVEL_DEBUG, LOG_MSG_TOTAL_CANCELLED);
             }
             break;
         }
@@ -1092,24 +1209,132 @@ void processKeyFSM(FSMContext* ctx, char key)
     }
 }
 
+// Отказ питания: снимок идущей транзакции в backup SRAM за время, пока напряжение падает от
+// порога PVD до сброса. Вызывается из прерывания, поля контекста читаются без блокировки:
+// объём и сумма могут быть из соседних ответов L и R, как и при обычном обновлении снимка
+void powerFailFSM(const FSMContext* ctx) {
+    bool active = ctx->state == FSM_STATE_TRANSACTION || ctx->state == FSM_STATE_TRANSACTION_PAUSED ||
+                  (ctx->state == FSM_STATE_TRANSACTION_END && !ctx->transactionDataReceived);
+    if (!active) return;
+    updateTransactionState(ctx->slot, ctx->currentLiters_dL, ctx->currentPriceTotal,
+                           (FSMState)ctx->state, (FuelMode)ctx->fuelMode, ctx->modeSelected);
+}
+
 // Получение состояния FSM
 FSMState getCurrentState(const FSMContext* ctx) {
-    return ctx->state;
+    return (FSMState)ctx->state;
 }
 
 FuelMode getCurrentFuelMode(const FSMContext* ctx) {
-    return ctx->fuelMode;
+    return (FuelMode)ctx->fuelMode;
 }
 
-// Функция логирования через UART3
-void logMessage(int level, const char* msg) {
-    if (level >= LOG_LEVEL) {
-        extern UART_HandleTypeDef huart3;
-        char logMsg[128];
-        snprintf(logMsg, sizeof(logMsg), "[%lu] %s\r\n", getCurrentMillis(), msg);
-        if (xSemaphoreTake(logMutex, portMAX_DELAY) == pdTRUE) {
-            HAL_UART_Transmit(&huart3, (uint8_t*)logMsg, strlen(logMsg), HAL_MAX_DELAY);
-            xSemaphoreGive(logMutex);
-        }
+// Срок следующего шага по состоянию. Запросы к ТРК разнесены на settings->delayAfterResponse,
+// пост в ожидании опрашивается раз в FSM_IDLE_POLL_PERIOD, остальные состояния ждут таймаута или клавиши
+uint32_t getFSMTimeToDeadline(const FSMContext* ctx, uint32_t now) {
+    // Контекст с незавершённым запросом будит завершение от задачи RS-422
+    if (ctx->waitingForResponse) return FSM_NO_DEADLINE;
+    // Команда по клавише передаётся в ближайшем слоте поста
+    if (ctx->keyCommand != 0) return 0;
+
+    uint32_t nextPoll = ctx->lastResponseTime + settings->delayAfterResponse;
+    uint32_t due;
+    switch (ctx->state) {
+        case FSM_STATE_CHECK_STATUS:
+        case FSM_STATE_TRANSACTION:
+        case FSM_STATE_TRANSACTION_PAUSED:
+            due = nextPoll;
+            break;
+        case FSM_STATE_TRANSACTION_END:
+            if (ctx->transactionDataReceived || ctx->transactionRetryCount >= 5) {
+                return FSM_NO_DEADLINE;
+            }
+            due = nextPoll;
+            break;
+        case FSM_STATE_TOTAL_COUNTER:
+            if (ctx->c0RetryCount < settings->maxErrorCount) {
+                due = ctx->lastC0SendTime + settings->responseTimeout;
+            } else {
+                return FSM_NO_DEADLINE;
+            }
+            break;
+        case FSM_STATE_ERROR:
+            due = ctx->stateEntryTime + settings->responseTimeout;
+            break;
+        case FSM_STATE_IDLE:
+            if (ctx->skipFirstStatusCheck) {
+                due = nextPoll;
+            } else if (ctx->statusPollingActive) {
+                due = ctx->lastResponseTime + FSM_IDLE_POLL_PERIOD;
+            } else if (ctx->nozzleUpWarning) {
+                due = ctx->stateEntryTime + 3001; // Принудительный сброс nozzleUpWarning в updateIdle
+            } else {
+                return FSM_NO_DEADLINE;
+            }
+            break;
+        case FSM_STATE_VIEW_PRICE:
+            due = ctx->stateEntryTime + 10000;
+            break;
+        case FSM_STATE_EDIT_PRICE:
+            due = ctx->stateEntryTime + settings->editTimeout;
+            break;
+        case FSM_STATE_TRANSITION_PRICE_SET:
+        case FSM_STATE_TRANSITION_EDIT_PRICE:
+            due = ctx->stateEntryTime + TRANSITION_TIMEOUT;
+            break;
+        default:
+            return FSM_NO_DEADLINE;
+    }
+    int32_t remaining = (int32_t)(due - now);
+    return remaining > 0 ? (uint32_t)remaining : 0;
+}
+
+// Класс поста для планировщика опроса шины. Итог отпуска, по которому данные уже получены
+// (или попытки исчерпаны), и подтверждение ждут только клавиши и слотов не требуют
+BusPostClass getBusPostClass(const FSMContext* ctx) {
+    switch (ctx->state) {
+        case FSM_STATE_TRANSACTION:
+        case FSM_STATE_TRANSACTION_PAUSED:
+            return BUS_POST_ACTIVE;
+        case FSM_STATE_TRANSACTION_END:
+            if (ctx->transactionDataReceived || ctx->transactionRetryCount >= 5) {
+                return BUS_POST_IDLE;
+            }
+            return BUS_POST_ACTIVE;
+        case FSM_STATE_ERROR:
+            return BUS_POST_OFFLINE;
+        default:
+            return BUS_POST_IDLE;
+    }
+}
+
+// Перерисовка экрана рукава (при переключении фокуса)
+void redrawFSM(FSMContext* ctx) {
+    if (ctx->hasFocus) {
+        DisplayState banner = { .screen = DISPLAY_SCREEN_NOZZLE, .post = ctx->address, .nozzle = ctx->nozzle };
+        displayAlert(&banner);
+    }
+    switch (ctx->state) {
+        case FSM_STATE_TRANSACTION:
+            displayTransaction(ctx, ctx->currentLiters_dL, ctx->currentPriceTotal, DISPLAY_STATUS_DISPENSING);
+            break;
+        case FSM_STATE_TRANSACTION_PAUSED:
+            displayTransaction(ctx, ctx->currentLiters_dL, ctx->currentPriceTotal, DISPLAY_STATUS_PAUSED);
+            break;
+        case FSM_STATE_TRANSACTION_END:
+            displayTransaction(ctx, ctx->finalLiters_dL, ctx->finalPriceTotal, DISPLAY_STATUS_END);
+            break;
+        case FSM_STATE_ERROR:
+            showMessage(ctx, "Pump offline! Check");
+            break;
+        default:
+            if (!ctx->priceValid) {
+                showMessage(ctx, "Set price (0-99999)");
+            } else if (ctx->modeSelected) {
+                displayFuelMode(ctx);
+            } else {
+                showMessage(ctx, "Please select mode");
+            }
+            break;
     }
 }
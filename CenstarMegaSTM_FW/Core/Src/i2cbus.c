@@ -0,0 +1,218 @@
+/* i2cbus.c - Диспетчер шины I2C1: единственная задача, обращающаяся к hi2c1 */
+
+#include "i2cbus.h"
+#include "config.h"
+#include "fsm.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+
+extern I2C_HandleTypeDef hi2c1;
+extern QueueHandle_t i2cHighQueue;
+extern QueueHandle_t i2cLowQueue;
+
+static TaskHandle_t busTask = NULL;
+
+// Текущая передача: завершает обработчик прерывания (i2cBusTransferComplete)
+static volatile bool transferActive;
+static volatile HAL_StatusTypeDef transferStatus;
+
+// Транзакция, ожидающая готовности устройства: после записи страницы EEPROM (конец цикла
+// записи) или до передачи (I2C_FLAG_WAIT_READY). Устройство опрашивается раз в тик, а шина
+// в это время передаёт транзакции других устройств
+static I2CTransaction held;
+static bool holding;
+static TickType_t heldStart;
+static TickType_t heldNextPoll;
+static TickType_t heldDeadline;
+
+static I2CBusStats stats;
+
+void initI2CBus(void) {
+    busTask = xTaskGetCurrentTaskHandle();
+}
+
+static void finishTransaction(const I2CTransaction* t, HAL_StatusTypeDef status) {
+    if (t->done != NULL) {
+        t->done(t, status);
+    }
+}
+
+static void holdTransaction(const I2CTransaction* t, uint16_t delayMs) {
+    TickType_t now = xTaskGetTickCount();
+    held = *t;
+    holding = true;
+    heldStart = now;
+    heldNextPoll = now + pdMS_TO_TICKS(delayMs);
+    heldDeadline = now + pdMS_TO_TICKS(t->readyTimeoutMs);
+}
+
+// Ожидание окончания передачи без опроса; зависшая передача прерывается сбросом I2C1
+static HAL_StatusTypeDef waitTransfer(void) {
+    TickType_t start = xTaskGetTickCount();
+    TickType_t timeout = pdMS_TO_TICKS(I2C_BUS_TRANSFER_TIMEOUT_MS);
+    while (transferActive) {
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        if (elapsed >= timeout) {
+            transferActive = false;
+            HAL_I2C_DeInit(&hi2c1);
+            HAL_I2C_Init(&hi2c1);
+            return HAL_TIMEOUT;
+        }
+        // Уведомления о новых транзакциях тоже будят задачу: условие проверяется заново
+        ulTaskNotifyTake(pdTRUE, timeout - elapsed);
+    }
+    return transferStatus;
+}
+
+// Запись через DMA, чтение по прерываниям (короткие чтения EEPROM)
+static void runTransaction(const I2CTransaction* t) {
+    if (t->flags & I2C_FLAG_WAIT_READY) {
+        holdTransaction(t, 0);
+        return;
+    }
+    if (holding) stats.overlapped++;
+
+    uint32_t begin = getCycleCount();
+    transferActive = true;
+    HAL_StatusTypeDef status;
+    if (t->flags & I2C_FLAG_READ) {
+        status = HAL_I2C_Mem_Read_IT(&hi2c1, t->devAddress, t->memAddress, t->memAddSize, t->data, t->length);
+    } else {
+        status = HAL_I2C_Mem_Write_DMA(&hi2c1, t->devAddress, t->memAddress, t->memAddSize, t->data, t->length);
+    }
+    if (status == HAL_OK) {
+        status = waitTransfer();
+    } else {
+        transferActive = false;
+    }
+    stats.transactions[t->client]++;
+    stats.busyUs[t->client] += (getCycleCount() - begin) / (SystemCoreClock / 1000000);
+
+    if (status != HAL_OK) {
+        if (status == HAL_TIMEOUT) {
+            stats.timeouts++;
+        } else {
+            stats.errors++;
+        }
+        finishTransaction(t, status);
+    } else if (t->flags & I2C_FLAG_WRITE_CYCLE) {
+        holdTransaction(t, t->readyDelayMs);
+    } else {
+        finishTransaction(t, HAL_OK);
+    }
+}
+
+// Один опрос готовности удерживаемого устройства: адрес без данных, без повторов в цикле
+static void pollHeld(TickType_t now) {
+    stats.ackPolls++;
+    bool ready = HAL_I2C_IsDeviceReady(&hi2c1, held.devAddress, 1, 1) == HAL_OK;
+    bool expired = (int32_t)(now - heldDeadline) >= 0;
+    if (!ready && !expired) {
+        heldNextPoll = now + 1;
+        return;
+    }
+
+    holding = false;
+    stats.readyWaitMs += (now - heldStart) * portTICK_PERIOD_MS;
+    if (!ready) stats.timeouts++;
+    if (held.flags & I2C_FLAG_WRITE_CYCLE) {
+        finishTransaction(&held, ready ? HAL_OK : HAL_TIMEOUT);
+    } else {
+        // Устройство так и не ответило: передача всё равно выполняется, ошибку вернёт она
+        held.flags &= ~I2C_FLAG_WAIT_READY;
+        runTransaction(&held);
+    }
+}
+
+// Транзакция из начала очереди. Пока устройство удерживается, очередь, в начале которой
+// транзакция к нему же (или ещё одна с ожиданием готовности), пропускается целиком:
+// порядок транзакций внутри очереди сохраняется
+static bool takeTransaction(QueueHandle_t queue, I2CTransaction* t) {
+    if (xQueuePeek(queue, t, 0) != pdTRUE) return false;
+    if (holding && (t->devAddress == held.devAddress ||
+                    (t->flags & (I2C_FLAG_WRITE_CYCLE | I2C_FLAG_WAIT_READY)))) {
+        return false;
+    }
+    xQueueReceive(queue, t, 0);
+    return true;
+}
+
+// Шаг задачи шины: опрос удерживаемого устройства в свой срок, затем одна транзакция
+// (сначала из очереди EEPROM), иначе сон до новой транзакции или следующего опроса
+void processI2CBus(void) {
+    TickType_t now = xTaskGetTickCount();
+    if (holding && (int32_t)(now - heldNextPoll) >= 0) {
+        pollHeld(now);
+    }
+
+    I2CTransaction t;
+    if (takeTransaction(i2cHighQueue, &t) || takeTransaction(i2cLowQueue, &t)) {
+        runTransaction(&t);
+        return;
+    }
+
+    TickType_t wait = portMAX_DELAY;
+    if (holding) {
+        now = xTaskGetTickCount();
+        wait = ((int32_t)(heldNextPoll - now) > 0) ? heldNextPoll - now : 0;
+    }
+    ulTaskNotifyTake(pdTRUE, wait);
+}
+
+bool i2cBusSubmit(const I2CTransaction* t, I2CBusPriority priority) {
+    QueueHandle_t queue = (priority == I2C_BUS_HIGH) ? i2cHighQueue : i2cLowQueue;
+    if (xQueueSend(queue, t, 0) != pdTRUE) {
+        return false;
+    }
+    if (busTask != NULL) {
+        xTaskNotifyGive(busTask);
+    }
+    return true;
+}
+
+// Ожидающая транзакцию задача и результат
+typedef struct {
+    TaskHandle_t task;
+    volatile bool done;
+    volatile HAL_StatusTypeDef status;
+} I2CBusWaiter;
+
+static void transferDone(const I2CTransaction* t, HAL_StatusTypeDef status) {
+    I2CBusWaiter* waiter = (I2CBusWaiter*)t->context;
+    waiter->status = status;
+    waiter->done = true;
+    xTaskNotifyGive(waiter->task);
+}
+
+HAL_StatusTypeDef i2cBusTransfer(const I2CTransaction* t, I2CBusPriority priority) {
+    I2CBusWaiter waiter = { xTaskGetCurrentTaskHandle(), false, HAL_ERROR };
+    I2CTransaction request = *t;
+    request.done = transferDone;
+    request.context = &waiter;
+    QueueHandle_t queue = (priority == I2C_BUS_HIGH) ? i2cHighQueue : i2cLowQueue;
+    xQueueSend(queue, &request, portMAX_DELAY);
+    if (busTask != NULL) {
+        xTaskNotifyGive(busTask);
+    }
+    while (!waiter.done) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+    return waiter.status;
+}
+
+const I2CBusStats* i2cBusGetStats(void) {
+    return &stats;
+}
+
+// Контекст прерывания: результат передачи и пробуждение задачи шины
+void i2cBusTransferComplete(HAL_StatusTypeDef status) {
+    if (!transferActive) return;
+    transferStatus = status;
+    transferActive = false;
+    BaseType_t woken = pdFALSE;
+    if (busTask != NULL) {
+        vTaskNotifyGiveFromISR(busTask, &woken);
+    }
+    portYIELD_FROM_ISR(woken);
+}
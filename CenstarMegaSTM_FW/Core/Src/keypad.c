@@ -2,6 +2,7 @@
 
 #include "keypad.h"
 #include "config.h"
+#include "settings.h"
 #include "FreeRTOS.h"
 #include "task.h"
 
@@ -34,7 +35,7 @@ char getKeypadKey(void) {
 
         for (uint8_t c = 0; c < KEYPAD_COL_COUNT; c++) {
             if (HAL_GPIO_ReadPin(ColPort[c], ColPin[c]) == GPIO_PIN_RESET) {
-                vTaskDelay(KEY_DEBOUNCE_MS / portTICK_PERIOD_MS); // Антидребезг
+                vTaskDelay(settings->keyDebounceMs / portTICK_PERIOD_MS); // Антидребезг
                 if (HAL_GPIO_ReadPin(ColPort[c], ColPin[c]) == GPIO_PIN_RESET) {
                     return KeyMap[r][c];
                 }
@@ -0,0 +1,179 @@
+/* log.c - Асинхронный лог через UART3: кольцевой буфер без блокировок, выгружаемый DMA
+ *
+ * Позиции в кольце - свободно бегущие 16-битные счётчики, индекс в буфере берётся по маске.
+ * Производитель резервирует место одной атомарной операцией над словом reserve
+ * (позиция резерва в младших 16 битах, число незавершённых записей - в старших), копирует
+ * сообщение и снимает свою запись. Тот, кто снял последнюю незавершённую запись, публикует
+ * позицию резерва в committed: все байты до неё уже скопированы. DMA передаёт байты
+ * от tail до committed непрерывными участками, следующий участок запускается из прерывания.
+ * Сообщения каталога logmsg.h при LOG_BINARY записываются без форматирования
+ */
+
+#include "log.h"
+#include <stdio.h>
+#include <string.h>
+
+#if (LOG_RING_SIZE & (LOG_RING_SIZE - 1)) != 0 || LOG_RING_SIZE > 32768
+#error "LOG_RING_SIZE must be a power of two not above 32768"
+#endif
+
+#define LOG_WRITER_ONE (1UL << 16)
+
+extern UART_HandleTypeDef huart3;
+
+static uint8_t ring[LOG_RING_SIZE];
+static uint32_t reserve = 0;            // Незавершённые записи << 16 | позиция резерва
+static uint16_t committed = 0;          // Байты до этой позиции готовы к передаче
+static volatile uint16_t tail = 0;      // Начало непереданных байт (меняет только владелец передачи)
+static volatile uint16_t txLength = 0;  // Длина участка, переданного DMA
+static uint32_t txBusy = 0;             // 1 - передачей владеет задача или прерывание DMA
+static LogStats stats;
+
+// Публикация готовых байт: committed только растёт, даже если запоздавший производитель
+// публикует позицию, которую уже обогнал другой
+static void publish(uint16_t head) {
+    uint16_t current = __atomic_load_n(&committed, __ATOMIC_RELAXED);
+    while ((int16_t)(head - current) > 0 &&
+           !__atomic_compare_exchange_n(&committed, &current, head, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+    }
+}
+
+// Запуск передачи следующего участка. Вызывается только владельцем txBusy
+static void kick(void) {
+    for (;;) {
+        uint16_t start = tail;
+        uint16_t pending = __atomic_load_n(&committed, __ATOMIC_ACQUIRE) - start;
+        if (pending == 0) {
+            __atomic_store_n(&txBusy, 0, __ATOMIC_RELEASE);
+            // Производитель мог опубликовать байты, пока передача считалась занятой
+            uint32_t idle = 0;
+            if (__atomic_load_n(&committed, __ATOMIC_ACQUIRE) == tail ||
+                !__atomic_compare_exchange_n(&txBusy, &idle, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+                return;
+            }
+            continue;
+        }
+
+        uint16_t index = start & (LOG_RING_SIZE - 1);
+        uint16_t chunk = LOG_RING_SIZE - index;
+        if (chunk > pending) chunk = pending;
+        txLength = chunk;
+        if (HAL_UART_Transmit_DMA(&huart3, &ring[index], chunk) != HAL_OK) {
+            // UART занят - участок уйдёт при следующей записи в лог
+            __atomic_store_n(&txBusy, 0, __ATOMIC_RELEASE);
+        }
+        return;
+    }
+}
+
+bool logWrite(const char* data, uint16_t length) {
+    if (length == 0) return true;
+
+    // Резервирование места
+    uint32_t old = __atomic_load_n(&reserve, __ATOMIC_RELAXED);
+    uint32_t next;
+    uint16_t head;
+    do {
+        head = (uint16_t)old;
+        uint16_t used = head - tail;
+        if (length > LOG_RING_SIZE - used) {
+            __atomic_fetch_add(&stats.droppedMessages, 1, __ATOMIC_RELAXED);
+            __atomic_fetch_add(&stats.droppedBytes, length, __ATOMIC_RELAXED);
+            return false;
+        }
+        next = ((old & 0xFFFF0000UL) + LOG_WRITER_ONE) | (uint16_t)(head + length);
+    } while (!__atomic_compare_exchange_n(&reserve, &old, next, true, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED));
+
+    uint16_t used = (uint16_t)(head + length - tail);
+    uint16_t peak = __atomic_load_n(&stats.peak, __ATOMIC_RELAXED);
+    while (used > peak &&
+           !__atomic_compare_exchange_n(&stats.peak, &peak, used, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+
+    // Копирование с переходом через конец буфера
+    uint16_t index = head & (LOG_RING_SIZE - 1);
+    uint16_t first = LOG_RING_SIZE - index;
+    if (first > length) first = length;
+    memcpy(&ring[index], data, first);
+    memcpy(ring, data + first, length - first);
+
+    // Снятие записи; последний завершивший публикует всё зарезервированное
+    next = __atomic_sub_fetch(&reserve, LOG_WRITER_ONE, __ATOMIC_RELEASE);
+    if ((next >> 16) == 0) {
+        publish((uint16_t)next);
+    }
+
+    uint32_t idle = 0;
+    if (__atomic_compare_exchange_n(&txBusy, &idle, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        kick();
+    }
+    return true;
+}
+
+const LogStats* logGetStats(void) {
+    return &stats;
+}
+
+// Участок передан (контекст прерывания): освобождаем его и запускаем следующий
+void logTxComplete(void) {
+    stats.sentBytes += txLength;
+    tail += txLength;
+    kick();
+}
+
+// Ошибка передачи: участок считается потерянным, выгрузка продолжается
+void logTxError(void) {
+    if (__atomic_load_n(&txBusy, __ATOMIC_ACQUIRE) == 0) return;
+    __atomic_fetch_add(&stats.droppedBytes, txLength, __ATOMIC_RELAXED);
+    tail += txLength;
+    kick();
+}
+
+#if LOG_BINARY
+static uint8_t putVarint(uint8_t* dst, uint32_t value) {
+    uint8_t n = 0;
+    while (value >= 0x80) {
+        dst[n++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    dst[n++] = (uint8_t)value;
+    return n;
+}
+#endif
+
+void logEvent(int level, LogMessageId id, const uint32_t* args, uint8_t count) {
+    if (level < LOG_LEVEL || id >= LOG_MSG_COUNT) return;
+    if (count > LOG_MAX_ARGS) count = LOG_MAX_ARGS;
+    uint32_t now = HAL_GetTick();
+
+#if LOG_BINARY
+    uint8_t record[LOG_RECORD_MAX];
+    uint8_t length = 0;
+    record[length++] = LOG_RECORD_SYNC;
+    record[length++] = (uint8_t)id;
+    record[length++] = count;
+    length += putVarint(&record[length], now);
+    for (uint8_t i = 0; i < count; i++) {
+        length += putVarint(&record[length], args[i]);
+    }
+    uint8_t check = 0;
+    for (uint8_t i = 1; i < length; i++) {
+        check ^= record[i];
+    }
+    record[length++] = check;
+    logWrite((const char*)record, length);
+#else
+    (void)count;
+    char line[160];
+    int length = snprintf(line, sizeof(line), "[%lu] ", (unsigned long)now);
+    length += logFormat(line + length, sizeof(line) - 2 - length, logFormats[id], args);
+    if (length > (int)sizeof(line) - 3) length = sizeof(line) - 3;
+    line[length++] = '\r';
+    line[length++] = '\n';
+    logWrite(line, (uint16_t)length);
+#endif
+}
+
+void logStart(void) {
+    LOG_EVENT(LOG_LEVEL_ERROR, LOG_MSG_CATALOG, logCatalogHash(), LOG_MSG_COUNT);
+}
@@ -0,0 +1,107 @@
+/* logmsg.c - Каталог сообщений лога и форматирование записей по нему */
+
+#include "logmsg.h"
+#include <stdio.h>
+#include <string.h>
+
+#define LOG_MSG_FORMAT(id, format) format,
+const char* const logFormats[LOG_MSG_COUNT] = {
+    LOG_MESSAGES(LOG_MSG_FORMAT)
+};
+#undef LOG_MSG_FORMAT
+
+// Разбор преобразования после '%': флаги, ширина и точность копируются в spec,
+// модификаторы длины пропускаются. Возвращает символ преобразования
+static char parseConversion(const char** format, char* spec, size_t specSize) {
+    const char* p = *format;
+    size_t n = 0;
+    spec[n++] = '%';
+    while (*p != '\0' && strchr("-+ #0123456789.", *p) != NULL) {
+        if (n < specSize - 3) spec[n++] = *p;
+        p++;
+    }
+    while (*p == 'l' || *p == 'h') p++;
+    char conversion = *p;
+    if (conversion != '\0') p++;
+    spec[n] = '\0';
+    *format = p;
+    return conversion;
+}
+
+uint8_t logFormatArgs(const char* format) {
+    uint8_t count = 0;
+    char spec[16];
+    while ((format = strchr(format, '%')) != NULL) {
+        format++;
+        char conversion = parseConversion(&format, spec, sizeof(spec));
+        if (conversion != '%' && conversion != '\0') count++;
+    }
+    return count;
+}
+
+int logFormat(char* dst, size_t size, const char* format, const uint32_t* args) {
+    size_t length = 0;
+    uint8_t arg = 0;
+    char spec[16];
+    char field[24];
+
+    while (*format != '\0') {
+        const char* text = format;
+        int fieldLength;
+        if (*format != '%') {
+            format++;
+            fieldLength = 1;
+        } else {
+            format++;
+            char conversion = parseConversion(&format, spec, sizeof(spec));
+            uint32_t value = (conversion != '%' && arg < LOG_MAX_ARGS) ? args[arg++] : 0;
+            size_t n = strlen(spec);
+            switch (conversion) {
+                case 'd':
+                case 'i':
+                    strcpy(spec + n, "ld");
+                    fieldLength = snprintf(field, sizeof(field), spec, (long)(int32_t)value);
+                    break;
+                case 'u':
+                case 'x':
+                case 'X':
+                    spec[n] = 'l';
+                    spec[n + 1] = conversion;
+                    spec[n + 2] = '\0';
+                    fieldLength = snprintf(field, sizeof(field), spec, (unsigned long)value);
+                    break;
+                case 'c':
+                    strcpy(spec + n, "c");
+                    fieldLength = snprintf(field, sizeof(field), spec, (int)(uint8_t)value);
+                    break;
+                default:
+                    // %% и неизвестные преобразования выводятся как есть
+                    fieldLength = (int)(format - text) - (conversion == '%' ? 1 : 0);
+                    memcpy(field, text + (conversion == '%' ? 1 : 0), (size_t)fieldLength);
+                    break;
+            }
+            if (fieldLength < 0) fieldLength = 0;
+            if (fieldLength >= (int)sizeof(field)) fieldLength = sizeof(field) - 1;
+            text = field;
+        }
+        if (length + 1 < size) {
+            size_t room = size - 1 - length;
+            memcpy(dst + length, text, (size_t)fieldLength < room ? (size_t)fieldLength : room);
+        }
+        length += (size_t)fieldLength;
+    }
+    if (size > 0) dst[length < size ? length : size - 1] = '\0';
+    return (int)length;
+}
+
+// FNV-1a по всем форматам каталога в порядке идентификаторов
+uint32_t logCatalogHash(void) {
+    uint32_t hash = 2166136261UL;
+    for (int id = 0; id < LOG_MSG_COUNT; id++) {
+        for (const char* p = logFormats[id]; ; p++) {
+            hash = (hash ^ (uint8_t)*p) * 16777619UL;
+            if (*p == '\0') break;
+        }
+    }
+    return hash;
+}
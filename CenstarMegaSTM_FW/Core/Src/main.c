@@ -12,7 +12,13 @@
 #include "oled.h"
 #include "rs422.h"
 #include "eeprom.h"
+#include "settings.h"
+#include "backup.h"
+#include "i2cbus.h"
+#include "bus.h"
+#include "log.h"
 #include <stdio.h>
+#include <string.h>
 
 // Дескрипторы периферии (сгенерированы CubeMX)
 I2C_HandleTypeDef hi2c1;
@@ -23,13 +29,30 @@ TIM_HandleTypeDef htim2;
 
 // Очереди FreeRTOS
 QueueHandle_t keypadQueue;    // Очередь для клавиш
-QueueHandle_t oledQueue;      // Очередь для сообщений OLED
+QueueHandle_t oledStateMailbox; // Последний экран состояния для OLED (перезаписывается)
+QueueHandle_t oledAlertQueue; // Очередь предупреждений для OLED
 QueueHandle_t rs422TxQueue;   // Очередь для отправки команд RS-422
 QueueHandle_t rs422RxQueue;   // Очередь для приёма ответов RS-422
+QueueHandle_t rs422EventQueue; // Очередь завершений запросов RS-422 для FSM
 QueueHandle_t eepromQueue;    // Очередь для операций с EEPROM
+QueueHandle_t i2cHighQueue;   // Транзакции I2C1 к EEPROM (выполняются первыми)
+QueueHandle_t i2cLowQueue;    // Транзакции I2C1 к дисплею (участки кадров)
 
-// Контекст FSM
-FSMContext fsmContext;
+#if NOZZLES_PER_POST > NOZZLE_COUNT
+#error "NOZZLES_PER_POST exceeds NOZZLE_COUNT"
+#endif
+#if FSM_CONTEXT_COUNT > BUS_MAX_POSTS
+#error "FSM_CONTEXT_COUNT exceeds BUS_MAX_POSTS"
+#endif
+
+// Задача FSM (получатель уведомлений FSM_EVENT_*)
+TaskHandle_t fsmTaskHandle = NULL;
+
+// Задача OLED (получатель уведомлений OLED_EVENT_*)
+TaskHandle_t oledTaskHandle = NULL;
+
+// Контексты FSM, по одному на рукав: рукава поста идут подряд
+FSMContext fsmContexts[FSM_CONTEXT_COUNT];
 
 // Прототипы задач FreeRTOS
 void StartFSMTask(void *argument);
@@ -37,6 +60,7 @@ void StartKeypadTask(void *argument);
 void StartRS422Task(void *argument);
 void StartOLEDTask(void *argument);
 void StartEEPROMTask(void *argument);
+void StartI2CTask(void *argument);
 void StartWatchdogTask(void *argument);
 
 // Прототипы функций инициализации
@@ -48,6 +72,7 @@ void MX_USART2_UART_Init(void);
 void MX_USART3_UART_Init(void);
 void MX_IWDG_Init(void);
 void MX_TIM2_Init(void);
+void MX_PVD_Init(void);
 
 // Глобальные переменные
 static volatile uint32_t tim2_counter = 0; // Счётчик для замены millis()
@@ -64,33 +89,48 @@ int main(void)
     MX_GPIO_Init();
     MX_DMA_Init();
     MX_I2C1_Init();
-    MX_USART2_UART_Init();
     MX_USART3_UART_Init();
+    logStart();
+    // Настройки из EEPROM: до UART2 (скорость RS-422) и до запуска задач, которые их читают
+    initSettings();
+    MX_USART2_UART_Init();
     MX_IWDG_Init();
     MX_TIM2_Init();
+    initBackupSRAM();
 
     // Запуск TIM2 для отсчёта времени
     HAL_TIM_Base_Start_IT(&htim2);
 
+    // Счётчик тактов DWT для измерения стоимости шага FSM
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
     // Создание очередей FreeRTOS
-    keypadQueue = xQueueCreate(10, sizeof(char));              // Очередь для клавиш
-    oledQueue = xQueueCreate(5, 128 * sizeof(char));          // Очередь для сообщений OLED
-    rs422TxQueue = xQueueCreate(10, sizeof(RS422Command));    // Очередь для команд RS-422
-    rs422RxQueue = xQueueCreate(10, 32 * sizeof(uint8_t));    // Очередь для ответов RS-422
+    keypadQueue = xQueueCreate(10, sizeof(KeypadEvent));       // Очередь для клавиш
+    oledStateMailbox = xQueueCreate(1, sizeof(DisplayState)); // Почтовый ящик экрана состояния
+    oledAlertQueue = xQueueCreate(OLED_ALERT_QUEUE_LENGTH, sizeof(DisplayState)); // Очередь предупреждений
+    rs422TxQueue = xQueueCreate(10, sizeof(RS422Request));    // Очередь для запросов RS-422
+    rs422RxQueue = xQueueCreate(10, sizeof(RS422Frame));      // Очередь для принятых кадров RS-422
+    rs422EventQueue = xQueueCreate(10, sizeof(RS422Reply));   // Очередь для завершений запросов RS-422
     eepromQueue = xQueueCreate(5, sizeof(EEPROMRequest));     // Очередь для операций с EEPROM
+    i2cHighQueue = xQueueCreate(I2C_BUS_HIGH_QUEUE_LENGTH, sizeof(I2CTransaction)); // Транзакции EEPROM
+    i2cLowQueue = xQueueCreate(I2C_BUS_LOW_QUEUE_LENGTH, sizeof(I2CTransaction));   // Участки кадров дисплея
 
     // Проверка создания очередей
-    if (keypadQueue == NULL || oledQueue == NULL || rs422TxQueue == NULL ||
-        rs422RxQueue == NULL || eepromQueue == NULL) {
+    if (keypadQueue == NULL || oledStateMailbox == NULL || oledAlertQueue == NULL || rs422TxQueue == NULL ||
+        rs422RxQueue == NULL || rs422EventQueue == NULL || eepromQueue == NULL ||
+        i2cHighQueue == NULL || i2cLowQueue == NULL) {
         Error_Handler();
     }
 
     // Создание задач FreeRTOS
-    xTaskCreate(StartFSMTask, "FSM", 512, NULL, 3, NULL);         // Задача FSM
+    xTaskCreate(StartFSMTask, "FSM", 512, NULL, 3, &fsmTaskHandle); // Задача FSM
     xTaskCreate(StartKeypadTask, "Keypad", 256, NULL, 4, NULL);   // Задача клавиатуры
     xTaskCreate(StartRS422Task, "RS422", 512, NULL, 4, NULL);     // Задача RS-422
-    xTaskCreate(StartOLEDTask, "OLED", 256, NULL, 2, NULL);       // Задача OLED
+    xTaskCreate(StartOLEDTask, "OLED", 256, NULL, 2, &oledTaskHandle); // Задача OLED
     xTaskCreate(StartEEPROMTask, "EEPROM", 256, NULL, 2, NULL);   // Задача EEPROM
+    xTaskCreate(StartI2CTask, "I2C", 256, NULL, 4, NULL);         // Задача шины I2C1
     xTaskCreate(StartWatchdogTask, "Watchdog", 128, NULL, 5, NULL); // Задача Watchdog
 
     // Запуск планировщика FreeRTOS
@@ -100,29 +140,208 @@ int main(void)
     while (1) {}
 }
 
-// Задача FSM
+// Накопитель статистики FSM за период FSM_STATS_PERIOD (значения в тактах процессора)
+typedef struct {
+    uint32_t count;
+    uint32_t total;
+    uint32_t max;
+} FSMStat;
+
+static void statRecord(FSMStat* stat, uint32_t cycles)
+{
+    stat->count++;
+    stat->total += cycles;
+    if (cycles > stat->max) stat->max = cycles;
+}
+
+static uint32_t statAverage(const FSMStat* stat)
+{
+    return stat->count ? stat->total / stat->count : 0;
+}
+
+// Учёт опроса шины: шаг рукава передал запрос, если номер последнего запроса изменился
+// (и когда ответа рукав не ждёт, как у N после итога). Слот, в котором рукаву нечего передать,
+// опросом не считается
+static void countPoll(const FSMContext* ctx, uint16_t seqBefore)
+{
+    if (ctx->pendingSeq != seqBefore) {
+        busRecordPoll(ctx->slot);
+    }
+}
+
+// Вывод в лог размера контекстов, стоимости шага FSM и задержек от нажатия клавиши
+// и от приёма ответа до их обработки
+static void logFSMStats(const FSMStat* steps, const FSMStat* keyLatency, const FSMStat* replyLatency)
+{
+    uint32_t cyclesPerUs = SystemCoreClock / 1000000;
+    LOG_EVENT(LOG_LEVEL_DEBUG, LOG_MSG_FSM_STATS,
+              FSM_CONTEXT_COUNT, sizeof(FSMContext), sizeof(fsmContexts), statAverage(steps), steps->max);
+    LOG_EVENT(LOG_LEVEL_DEBUG, LOG_MSG_FSM_LATENCY,
+              statAverage(keyLatency) / cyclesPerUs, keyLatency->max / cyclesPerUs, keyLatency->count,
+              statAverage(replyLatency) / cyclesPerUs, replyLatency->max / cyclesPerUs, replyLatency->count);
+
+    // Обмен с каждым постом: время реакции ТРК, текущий таймаут, ответы/запросы, неответы,
+    // интервал пробных запросов недоступного поста и наибольший интервал между запросами к посту
+    for (uint8_t i = 0; i < busGetPostCount(); i++) {
+        const BusPost* post = busGetPost(i);
+        if (i > 0 && busGetPost(i - 1)->address == post->address) continue;
+        const RS422PumpStats* stats = rs422GetPumpStats(post->address);
+        if (stats == NULL) continue;
+        LOG_EVENT(LOG_LEVEL_DEBUG, LOG_MSG_POST_STATS,
+                  post->address, stats->srtt8 / 8, stats->rttvar4 / 4, stats->maxRtt, stats->timeout,
+                  stats->replies, stats->requests, stats->timeouts, stats->errors, stats->skipped,
+                  stats->backoff, post->maxStaleness);
+    }
+
+    // Дисплей: кадры, наибольшая частота кадров, байты на шину, кадры, отложенные до конца
+    // передачи предыдущего, экраны, заменённые до отрисовки, и отброшенные предупреждения
+    const OLEDStats* oled = oledGetStats();
+    LOG_EVENT(LOG_LEVEL_DEBUG, LOG_MSG_OLED_STATS,
+              oled->frames, oled->peakFps, oled->bytes, oled->deferred,
+              oled->errors, oled->superseded, oled->alertsDropped);
+
+    // Шина I2C1: транзакции и время передач по клиентам, опросы готовности устройств
+    // и транзакции, выполненные, пока другое устройство занято
+    const I2CBusStats* i2c = i2cBusGetStats();
+    LOG_EVENT(LOG_LEVEL_DEBUG, LOG_MSG_I2C_STATS,
+              i2c->transactions[I2C_CLIENT_EEPROM], i2c->busyUs[I2C_CLIENT_EEPROM] / 1000,
+              i2c->transactions[I2C_CLIENT_OLED], i2c->busyUs[I2C_CLIENT_OLED] / 1000,
+              i2c->errors, i2c->timeouts, i2c->ackPolls, i2c->readyWaitMs, i2c->overlapped);
+
+    // EEPROM: запросы записи, из них без изменений, барьеры, записи журнала и циклы записи страниц
+    const EEPROMStats* eeprom = eepromGetStats();
+    LOG_EVENT(LOG_LEVEL_DEBUG, LOG_MSG_EEPROM_STATS,
+              eeprom->writes, eeprom->unchanged, eeprom->flushes, eeprom->records, eeprom->pageWrites);
+
+    // Лог: передано через DMA, отброшено при заполненном кольце, наибольшее заполнение кольца
+    const LogStats* logStats = logGetStats();
+    LOG_EVENT(LOG_LEVEL_DEBUG, LOG_MSG_LOG_STATS,
+              logStats->sentBytes, logStats->droppedMessages, logStats->droppedBytes, logStats->peak, LOG_RING_SIZE);
+}
+
+// Задача FSM: один цикл обслуживает все рукава всех постов шины и никогда не ждёт ТРК -
+// запросы выполняет задача RS-422, а их завершения приходят через rs422EventQueue.
+// При FSM_EVENT_DRIVEN задача спит до уведомления (клавиша, завершение запроса) или до ближайшего
+// срока одного из рукавов, иначе работает прежний опрос с периодом 10 мс
 void StartFSMTask(void *argument)
 {
-    initFSM(&fsmContext);
+    uint8_t focusIndex = 0;
+    uint8_t addresses[FSM_CONTEXT_COUNT];
+    for (uint8_t i = 0; i < FSM_CONTEXT_COUNT; i++) {
+        fsmContexts[i].address = settings->postAddress + i / NOZZLES_PER_POST;
+        fsmContexts[i].nozzle = 1 + i % NOZZLES_PER_POST;
+        fsmContexts[i].slot = i;
+        fsmContexts[i].hasFocus = (i == focusIndex);
+        addresses[i] = fsmContexts[i].address;
+        initFSM(&fsmContexts[i]);
+    }
+    busInit(addresses, FSM_CONTEXT_COUNT);
+    // Снимки при отказе питания - только после восстановления транзакций рукавов
+    MX_PVD_Init();
+
+    FSMStat stepStat = {0}, keyStat = {0}, replyStat = {0};
+    uint32_t statStart = getCurrentMillis();
+    logFSMStats(&stepStat, &keyStat, &replyStat);
+
+    uint8_t postIndex = busNextPost();
     for (;;) {
-        updateFSM(&fsmContext);
-        char key;
-        if (xQueueReceive(keypadQueue, &key, 0) == pdTRUE) {
-            processKeyFSM(&fsmContext, key);
+        // Завершения запросов к ТРК: ответ отдаётся контексту, который его ждёт.
+        // Ответы на команды, которых FSM не ждёт, отбрасываются
+        RS422Reply reply;
+        while (xQueueReceive(rs422EventQueue, &reply, 0) == pdTRUE) {
+            for (uint8_t i = 0; i < FSM_CONTEXT_COUNT; i++) {
+                if (fsmContexts[i].waitingForResponse && fsmContexts[i].pendingSeq == reply.seq) {
+                    uint32_t stepStart = getCycleCount();
+                    completeFSM(&fsmContexts[i], &reply);
+                    statRecord(&stepStat, getCycleCount() - stepStart);
+                    countPoll(&fsmContexts[i], reply.seq);
+                    if (reply.status == RS422_OK) {
+                        statRecord(&replyStat, getCycleCount() - reply.time);
+                    }
+                    break;
+                }
+            }
+        }
+
+        // Шаг рукава, которому планировщик выделил шину. Пока его запрос не завершён,
+        // шина занята и следующий рукав не выбирается
+        FSMContext* ctx = &fsmContexts[postIndex];
+        if (!ctx->waitingForResponse) {
+#if FSM_EVENT_DRIVEN
+            bool due = getFSMTimeToDeadline(ctx, getCurrentMillis()) == 0;
+#else
+            bool due = true;
+#endif
+            if (due) {
+                uint16_t seqBefore = ctx->pendingSeq;
+                uint32_t stepStart = getCycleCount();
+                updateFSM(ctx);
+                statRecord(&stepStat, getCycleCount() - stepStart);
+                countPoll(ctx, seqBefore);
+            }
+            if (!ctx->waitingForResponse) {
+                busSetPostClass(postIndex, getBusPostClass(ctx));
+                postIndex = busNextPost();
+            }
         }
+
+        // Клавиши обрабатываются сразу: ожидание ответа ТРК их больше не задерживает.
+        // Команды ТРК по клавишам ставятся в контекст и уходят в слоте его поста
+        KeypadEvent event;
+        while (xQueueReceive(keypadQueue, &event, 0) == pdTRUE) {
+            if (event.key == 'F' && FSM_CONTEXT_COUNT > 1) {
+                // Переключение рукава на клавиатуре и дисплее
+                fsmContexts[focusIndex].hasFocus = false;
+                focusIndex = (focusIndex + 1) % FSM_CONTEXT_COUNT;
+                fsmContexts[focusIndex].hasFocus = true;
+                redrawFSM(&fsmContexts[focusIndex]);
+            } else {
+                processKeyFSM(&fsmContexts[focusIndex], event.key);
+            }
+            statRecord(&keyStat, getCycleCount() - event.time);
+        }
+
+        uint32_t now = getCurrentMillis();
+        if (now - statStart >= FSM_STATS_PERIOD) {
+            logFSMStats(&stepStat, &keyStat, &replyStat);
+            memset(&stepStat, 0, sizeof(stepStat));
+            memset(&keyStat, 0, sizeof(keyStat));
+            memset(&replyStat, 0, sizeof(replyStat));
+            statStart = now;
+        }
+
+#if FSM_EVENT_DRIVEN
+        // Пока шина занята, спим до завершения запроса или клавиши.
+        // Иначе - до ближайшего срока среди всех рукавов или до вывода статистики
+        uint32_t wait = FSM_STATS_PERIOD - (now - statStart);
+        if (!fsmContexts[postIndex].waitingForResponse) {
+            for (uint8_t i = 0; i < FSM_CONTEXT_COUNT && wait > 0; i++) {
+                uint32_t remaining = getFSMTimeToDeadline(&fsmContexts[i], now);
+                if (remaining < wait) wait = remaining;
+            }
+        }
+        if (wait > 0) {
+            uint32_t events;
+            xTaskNotifyWait(0, FSM_EVENT_KEY | FSM_EVENT_REPLY, &events, pdMS_TO_TICKS(wait));
+        }
+#else
         vTaskDelay(10 / portTICK_PERIOD_MS); // Периодичность 10 мс
+#endif
     }
 }
 
-// Задача клавиатуры
+// Задача клавиатуры: событие несёт момент нажатия и будит задачу FSM
 void StartKeypadTask(void *argument)
 {
     for (;;) {
-        char key = getKeypadKey();
-        if (key) {
-            xQueueSend(keypadQueue, &key, portMAX_DELAY);
+        KeypadEvent event;
+        event.key = getKeypadKey();
+        if (event.key) {
+            event.time = getCycleCount();
+            xQueueSend(keypadQueue, &event, portMAX_DELAY);
+            xTaskNotify(fsmTaskHandle, FSM_EVENT_KEY, eSetBits);
         }
-        vTaskDelay(20 / portTICK_PERIOD_MS); // Периодичность 20 мс (с учётом антидребезга)
+        vTaskDelay(settings->keyScanMs / portTICK_PERIOD_MS); // Период опроса (с учётом антидребезга)
     }
 }
 
@@ -130,10 +349,10 @@ void StartKeypadTask(void *argument)
 void StartRS422Task(void *argument)
 {
     initRS422();
-    RS422Command cmd;
+    RS422Request req;
     for (;;) {
-        if (xQueueReceive(rs422TxQueue, &cmd, portMAX_DELAY) == pdTRUE) {
-            sendRS422Command(&cmd);
+        if (xQueueReceive(rs422TxQueue, &req, portMAX_DELAY) == pdTRUE) {
+            processRS422Request(&req);
         }
     }
 }
@@ -142,22 +361,59 @@ void StartRS422Task(void *argument)
 void StartOLEDTask(void *argument)
 {
     initOLED();
-    char msg[128];
+    DisplayState state = { .screen = DISPLAY_SCREEN_TEXT, .text = "" };
+    DisplayState alert;
+    bool alertShown = false;
+    TickType_t alertEnd = 0;
     for (;;) {
-        if (xQueueReceive(oledQueue, msg, portMAX_DELAY) == pdTRUE) {
-            displayMessage(msg);
+        // Кадр, отложенный до конца передачи предыдущего, передаётся по OLED_EVENT_FLUSHED
+        // и без нового сообщения; OLED_TX_TIMEOUT_MS - запасной срок повтора
+        TickType_t wait = ssd1306_UpdatePending() ? pdMS_TO_TICKS(OLED_TX_TIMEOUT_MS) : portMAX_DELAY;
+        if (alertShown) {
+            TickType_t left = alertEnd - xTaskGetTickCount();
+            if ((int32_t)left < 0) left = 0;
+            if (left < wait) wait = left;
+        }
+        xTaskNotifyWait(0, UINT32_MAX, NULL, wait);
+
+        // Экран состояния забирается всегда, чтобы после предупреждения показать самый свежий
+        bool stateChanged = xQueueReceive(oledStateMailbox, &state, 0) == pdTRUE;
+        TickType_t now = xTaskGetTickCount();
+        if (alertShown && (int32_t)(now - alertEnd) >= 0) {
+            alertShown = false;
+            stateChanged = true;
+        }
+        if (!alertShown && xQueueReceive(oledAlertQueue, &alert, 0) == pdTRUE) {
+            renderState(&alert);
+            alertShown = true;
+            alertEnd = now + pdMS_TO_TICKS(OLED_ALERT_MS);
+        } else if (!alertShown && stateChanged) {
+            renderState(&state);
         }
+        ssd1306_UpdateScreen();
     }
 }
 
 // Задача EEPROM
 void StartEEPROMTask(void *argument)
 {
+    initEEPROM();
     EEPROMRequest req;
     for (;;) {
-        if (xQueueReceive(eepromQueue, &req, portMAX_DELAY) == pdTRUE) {
+        // Пока есть изменённые снимки, ожидание ограничено сроком их записи
+        if (xQueueReceive(eepromQueue, &req, eepromCacheTimeout()) == pdTRUE) {
             handleEEPROMRequest(&req);
         }
+        processEEPROMCache();
+    }
+}
+
+// Задача шины I2C1: единственная, кто обращается к hi2c1
+void StartI2CTask(void *argument)
+{
+    initI2CBus();
+    for (;;) {
+        processI2CBus();
     }
 }
 
@@ -178,10 +434,67 @@ void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim)
     }
 }
 
-// Функция для получения текущего времени (замена millis())
+// Завершение передачи UART: кадры RS-422 на UART2, лог на UART3
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+    if (huart == &huart2) {
+        rs422TxCpltCallback();
+    } else if (huart == &huart3) {
+        logTxComplete();
+    }
+}
+
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
+{
+    if (huart == &huart2) {
+        rs422ErrorCallback();
+    } else if (huart == &huart3) {
+        logTxError();
+    }
+}
+
+// Завершение и ошибка передачи I2C1 (запись через DMA, чтение по прерываниям)
+void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+    if (hi2c == &hi2c1) {
+        i2cBusTransferComplete(HAL_OK);
+    }
+}
+
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+    if (hi2c == &hi2c1) {
+        i2cBusTransferComplete(HAL_OK);
+    }
+}
+
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c)
+{
+    if (hi2c == &hi2c1) {
+        i2cBusTransferComplete(HAL_ERROR);
+    }
+}
+
+// Отказ питания (PVD): напряжение ниже PVD_LEVEL, транзакции рукавов сохраняются в backup SRAM
+void HAL_PWR_PVDCallback(void)
+{
+    for (uint8_t i = 0; i < FSM_CONTEXT_COUNT; i++) {
+        powerFailFSM(&fsmContexts[i]);
+    }
+}
+
+// Функция для получения текущего времени (замена millis()).
+// Счёт ведётся по тику FreeRTOS: tim2_counter растёт только при переполнении TIM2,
+// а от этого времени считаются сроки, до которых спит задача FSM
 uint32_t getCurrentMillis(void)
 {
-    return tim2_counter;
+    return xTaskGetTickCount() * portTICK_PERIOD_MS;
+}
+
+// Счётчик тактов DWT (включается в main до запуска планировщика)
+uint32_t getCycleCount(void)
+{
+    return DWT->CYCCNT;
 }
 
 // Функции инициализации (сгенерированы CubeMX, оставлены без изменений)
@@ -229,7 +542,7 @@ void MX_I2C1_Init(void)
 void MX_USART2_UART_Init(void)
 {
     huart2.Instance = USART2;
-    huart2.Init.BaudRate = 9600;
+    huart2.Init.BaudRate = settings->baudRate;
     huart2.Init.WordLength = UART_WORDLENGTH_8B;
     huart2.Init.StopBits = UART_STOPBITS_1;
     huart2.Init.Parity = UART_PARITY_NONE;
@@ -322,6 +635,21 @@ void MX_DMA_Init(void)
     HAL_NVIC_EnableIRQ(DMA1_Stream0_IRQn);
 }
 
+// PVD: прерывание по снижению напряжения ниже порога. Приоритет выше порога FreeRTOS
+// (configMAX_SYSCALL_INTERRUPT_PRIORITY): обработчик не вызывает FreeRTOS, и его
+// не задерживают ни критические секции, ни передачи I2C1
+void MX_PVD_Init(void)
+{
+    PWR_PVDTypeDef sConfigPVD = {0};
+
+    sConfigPVD.PVDLevel = PVD_LEVEL;
+    sConfigPVD.Mode = PWR_PVD_MODE_IT_RISING;
+    HAL_PWR_ConfigPVD(&sConfigPVD);
+    HAL_PWR_EnablePVD();
+    HAL_NVIC_SetPriority(PVD_IRQn, 0, 0);
+    HAL_NVIC_EnableIRQ(PVD_IRQn);
+}
+
 void Error_Handler(void)
 {
     __disable_irq();
@@ -2,17 +2,52 @@
 
 #include "oled.h"
 #include "config.h"
+#include "fsm.h"
 #include <string.h>
+#include "i2cbus.h"
 #include "FreeRTOS.h"
 #include "task.h"
 #include <stdbool.h>
 
-extern I2C_HandleTypeDef hi2c1;
+#define SSD1306_PAGES (SSD1306_HEIGHT / 8)
+#define OLED_LINE_CHARS (SSD1306_WIDTH / 6)     // Символов в строке: 5 столбцов глифа и пробел
+#define OLED_BIG_CHAR_WIDTH 12                  // Крупный символ: 10 столбцов глифа и 2 пробела
+#define OLED_BIG_TEXT_X 8                       // Начало крупного текста после подписи мелким шрифтом
+#define OLED_WINDOW_OVERHEAD 10                 // Байт на шине на окно, кроме данных: адрес и управляющий
+                                                // байт у команды и у данных, 6 байт команды окна
 
-// Внутренний буфер дисплея (1 КБ)
+// Два буфера по 1 КБ: в Buffer рисует задача OLED, из txFrame в это время через DMA
+// передаются изменённые окна предыдущего кадра, уложенные подряд
 static uint8_t Buffer[SSD1306_WIDTH * SSD1306_HEIGHT / 8];
+static uint8_t txFrame[SSD1306_WIDTH * SSD1306_HEIGHT / 8];
 static uint8_t CurrentX, CurrentY;
 
+// Изменённые с последней передачи страницы и диапазоны столбцов в них
+static uint8_t dirtyPages;
+static uint8_t dirtyStart[SSD1306_PAGES];
+static uint8_t dirtyEnd[SSD1306_PAGES];
+
+// Окно дисплея: столбцы start..end страниц firstPage..lastPage, данные в txFrame с offset
+typedef struct {
+    uint8_t start;
+    uint8_t end;
+    uint8_t firstPage;
+    uint8_t lastPage;
+    uint16_t offset;
+} OLEDWindow;
+
+// Передаваемый кадр: для каждого окна в очереди шины команда окна и данные. txFrame
+// и txCommands не изменяются, пока задача шины не завершит последний участок кадра
+static OLEDWindow txWindows[SSD1306_PAGES];
+static uint8_t txWindowCount;
+static uint8_t txCommands[SSD1306_PAGES][6];
+static volatile bool txActive;
+static volatile bool txFailed;          // Кадр передан не полностью: следующий передаётся целиком
+
+static OLEDStats stats;
+static uint32_t fpsWindowStart;
+static uint16_t fpsWindowFrames;
+
 // Шрифт 5×7 (ASCII 32-126), так как font5x7.inc не предоставлен
 static const uint8_t Font5x7[] = {
     0x00, 0x00, 0x00, 0x00, 0x00, //
@@ -112,24 +147,184 @@ static const uint8_t Font5x7[] = {
     0x10, 0x08, 0x08, 0x10, 0x08, // ~
 };
 
-// Низкоуровневые функции (взяты из вашего тестового кода)
-static HAL_StatusTypeDef CMD(uint8_t c) {
-    uint8_t d[2] = {0x00, c};
-    return HAL_I2C_Master_Transmit(&hi2c1, OLED_I2C_ADDR, d, 2, HAL_MAX_DELAY);
+// Инициализация одной передачей: управляющий байт 0x00 (Co = 0, D/C = 0), далее только команды.
+// Горизонтальная адресация (0x20 0x00): окно 0x21/0x22 заполняется данными подряд по страницам
+static const uint8_t InitCommands[] = {
+    0xAE, 0x20, 0x00, 0xB0, 0xC8,
+    0x00, 0x10, 0x40, 0x81, 0x7F,
+    0xA1, 0xA6, 0xA8, 0x3F, 0xA4,
+    0xD3, 0x00, 0xD5, 0xF0, 0xD9,
+    0x22, 0xDA, 0x12, 0xDB, 0x20,
+    0x8D, 0x14, 0xAF
+};
+
+static void markDirty(uint8_t page, uint8_t col) {
+    uint8_t bit = 1 << page;
+    if (!(dirtyPages & bit)) {
+        dirtyPages |= bit;
+        dirtyStart[page] = col;
+        dirtyEnd[page] = col;
+    } else if (col < dirtyStart[page]) {
+        dirtyStart[page] = col;
+    } else if (col > dirtyEnd[page]) {
+        dirtyEnd[page] = col;
+    }
+}
+
+// Запись байта буфера; страница помечается изменённой, только если байт действительно изменился
+static void putByte(uint8_t page, uint8_t col, uint8_t value) {
+    uint8_t* cell = &Buffer[SSD1306_WIDTH * page + col];
+    if (*cell != value) {
+        *cell = value;
+        markDirty(page, col);
+    }
 }
 
-void ssd1306_UpdateScreen(void) {
-    for (uint8_t page = 0; page < 8; page++) {
-        CMD(0xB0 + page);
-        CMD(0x00);
-        CMD(0x10);
-        HAL_I2C_Mem_Write(&hi2c1, OLED_I2C_ADDR, 0x40, I2C_MEMADD_SIZE_8BIT,
-                          &Buffer[SSD1306_WIDTH * page], SSD1306_WIDTH, HAL_MAX_DELAY);
+static void markAllDirty(void) {
+    for (uint8_t page = 0; page < SSD1306_PAGES; page++) {
+        markDirty(page, 0);
+        markDirty(page, SSD1306_WIDTH - 1);
     }
 }
 
+static void notifyOLED(uint32_t event) {
+    extern TaskHandle_t oledTaskHandle;
+    if (oledTaskHandle != NULL) {
+        xTaskNotify(oledTaskHandle, event, eSetBits);
+    }
+}
+
+// Участок кадра передан (задача шины): после последнего задача OLED может передавать следующий
+static void txDone(const I2CTransaction* t, HAL_StatusTypeDef status) {
+    if (status != HAL_OK) {
+        stats.errors++;
+        txFailed = true;
+    }
+    if (t->context != NULL) {
+        txActive = false;
+        notifyOLED(OLED_EVENT_FLUSHED);
+    }
+}
+
+// Участок для очереди шины: control - управляющий байт SSD1306 (0x00 команды, 0x40 данные)
+static bool txSubmit(uint8_t control, uint8_t* data, uint16_t length, uint8_t flags, bool last) {
+    I2CTransaction t = {
+        .devAddress = OLED_I2C_ADDR,
+        .memAddress = control,
+        .memAddSize = I2C_MEMADD_SIZE_8BIT,
+        .length = length,
+        .flags = flags,
+        .client = I2C_CLIENT_OLED,
+        .readyTimeoutMs = OLED_POWER_UP_MS,
+        .data = data,
+        .done = txDone,
+        .context = last ? txFrame : NULL   // Отметка последнего участка кадра
+    };
+    stats.bytes += length;
+    return i2cBusSubmit(&t, I2C_BUS_LOW);
+}
+
+static uint16_t windowCost(const OLEDWindow* window) {
+    return (window->end - window->start + 1) * (window->lastPage - window->firstPage + 1) + OLED_WINDOW_OVERHEAD;
+}
+
+// Передача изменённых участков кадра через задачу шины. Не ждёт: пока предыдущий кадр ещё
+// в очереди шины, изменения копятся в Buffer и уходят следующим кадром после OLED_EVENT_FLUSHED
+bool ssd1306_UpdateScreen(void) {
+    if (txActive) {
+        if (dirtyPages != 0) stats.deferred++;
+        return false;
+    }
+    if (txFailed) {
+        txFailed = false;
+        markAllDirty();
+    }
+    if (dirtyPages == 0) return true;
+
+    // Изменённые страницы объединяются в окна: следующая страница присоединяется к окну,
+    // если общее окно (объединение столбцов, все страницы между ними) короче на шине, чем
+    // два отдельных. Так полная перерисовка - одно окно, а цифры высотой в две страницы -
+    // одно окно на строку
+    txWindowCount = 0;
+    for (uint8_t page = 0; page < SSD1306_PAGES; page++) {
+        if (!(dirtyPages & (1 << page))) continue;
+        OLEDWindow next = { dirtyStart[page], dirtyEnd[page], page, page, 0 };
+        if (txWindowCount > 0) {
+            OLEDWindow* last = &txWindows[txWindowCount - 1];
+            OLEDWindow merged = {
+                next.start < last->start ? next.start : last->start,
+                next.end > last->end ? next.end : last->end,
+                last->firstPage, page, 0
+            };
+            if (windowCost(&merged) <= windowCost(last) + windowCost(&next)) {
+                *last = merged;
+                continue;
+            }
+        }
+        txWindows[txWindowCount++] = next;
+    }
+
+    // Окна укладываются в txFrame подряд, строка страницы за строкой, как их заполняет дисплей
+    uint16_t offset = 0;
+    for (uint8_t i = 0; i < txWindowCount; i++) {
+        OLEDWindow* window = &txWindows[i];
+        uint16_t width = window->end - window->start + 1;
+        window->offset = offset;
+        for (uint8_t page = window->firstPage; page <= window->lastPage; page++) {
+            memcpy(&txFrame[offset], &Buffer[SSD1306_WIDTH * page + window->start], width);
+            offset += width;
+        }
+    }
+    dirtyPages = 0;
+
+    // Кадры в секунду: наибольшее число кадров за секундное окно
+    uint32_t now = xTaskGetTickCount();
+    if (now - fpsWindowStart >= pdMS_TO_TICKS(1000)) {
+        fpsWindowStart = now;
+        fpsWindowFrames = 0;
+    }
+    if (++fpsWindowFrames > stats.peakFps) stats.peakFps = fpsWindowFrames;
+    stats.frames++;
+
+    // Кадр ставится в очередь целиком: место в ней проверено заранее, других участков
+    // дисплея в очереди нет, пока txActive
+    extern QueueHandle_t i2cLowQueue;
+    if (uxQueueSpacesAvailable(i2cLowQueue) < 2 * txWindowCount) {
+        txFailed = true;
+        return false;
+    }
+    txActive = true;
+    for (uint8_t i = 0; i < txWindowCount; i++) {
+        const OLEDWindow* window = &txWindows[i];
+        uint8_t* command = txCommands[i];
+        command[0] = 0x21;
+        command[1] = window->start;
+        command[2] = window->end;
+        command[3] = 0x22;
+        command[4] = window->firstPage;
+        command[5] = window->lastPage;
+        uint16_t length = (window->end - window->start + 1) * (window->lastPage - window->firstPage + 1);
+        txSubmit(0x00, command, sizeof(txCommands[i]), 0, false);
+        txSubmit(0x40, &txFrame[window->offset], length, 0, i == txWindowCount - 1);
+    }
+    return true;
+}
+
+bool ssd1306_UpdatePending(void) {
+    return dirtyPages != 0 || txFailed;
+}
+
+const OLEDStats* oledGetStats(void) {
+    return &stats;
+}
+
 void ssd1306_Fill(SSD1306_COLOR color) {
-    memset(Buffer, color ? 0xFF : 0x00, sizeof(Buffer));
+    uint8_t value = color ? 0xFF : 0x00;
+    for (uint8_t page = 0; page < SSD1306_PAGES; page++) {
+        for (uint8_t col = 0; col < SSD1306_WIDTH; col++) {
+            putByte(page, col, value);
+        }
+    }
 }
 
 void ssd1306_SetCursor(uint8_t x, uint8_t y) {
@@ -137,25 +332,61 @@ void ssd1306_SetCursor(uint8_t x, uint8_t y) {
     CurrentY = y;
 }
 
+// Столбец байта буфера - 8 строк экрана, поэтому глиф 5×7 выводится столбцами целиком:
+// при y, кратном 8, столбец глифа записывается в байт страницы как есть, иначе сдвигается
+// и делится между двумя соседними страницами. Строка 8 под глифом не изменяется
 void ssd1306_WriteChar(char ch, SSD1306_COLOR color) {
+    if (CurrentX + 6 > SSD1306_WIDTH || CurrentY + 7 > SSD1306_HEIGHT) return;
     if (ch < 32 || ch > 126) ch = '?';
     const uint8_t* glyph = &Font5x7[(ch - 32) * 5];
+    uint8_t page = CurrentY / 8;
+    uint8_t shift = CurrentY % 8;
+    uint8_t* column = &Buffer[SSD1306_WIDTH * page + CurrentX];
 
-    for (uint8_t col = 0; col < 5; col++) {
-        uint8_t line = glyph[col];
-        for (uint8_t row = 0; row < 7; row++) {
-            uint32_t idx = CurrentX + ((CurrentY + row) / 8) * SSD1306_WIDTH;
-            uint8_t bit = 1 << ((CurrentY + row) % 8);
-
-            if (line & 0x01)
-                Buffer[idx] |= bit;
-            else
-                Buffer[idx] &= ~bit;
-            line >>= 1;
+    // Пять столбцов глифа и столбец пробела
+    for (uint8_t col = 0; col < 6; col++) {
+        uint8_t line = (col < 5) ? glyph[col] : 0x00;
+        if (color == SSD1306_COLOR_BLACK) line = ~line & 0x7F;
+        if (shift == 0) {
+            putByte(page, CurrentX, (column[col] & 0x80) | line);
+        } else {
+            uint16_t mask = 0x7F << shift;
+            uint16_t bits = (uint16_t)line << shift;
+            putByte(page, CurrentX, (column[col] & ~mask) | bits);
+            if (mask >> 8) {
+                uint8_t next = column[col + SSD1306_WIDTH];
+                putByte(page + 1, CurrentX, (next & ~(mask >> 8)) | (bits >> 8));
+            }
         }
         CurrentX++;
     }
-    CurrentX++; // Один столбец пробела
+}
+
+// Растяжение 4 бит столбца глифа вдвое по вертикали: бит n переходит в биты 2n и 2n+1
+static const uint8_t Spread2[16] = {
+    0x00, 0x03, 0x0C, 0x0F, 0x30, 0x33, 0x3C, 0x3F,
+    0xC0, 0xC3, 0xCC, 0xCF, 0xF0, 0xF3, 0xFC, 0xFF
+};
+
+// Символ шрифта 5×7, увеличенный вдвое (10×14 в ячейке 12×16): y должно быть кратно 8,
+// ячейка занимает две страницы и перезаписывается целиком
+void ssd1306_WriteBigChar(char ch, SSD1306_COLOR color) {
+    if (CurrentX + OLED_BIG_CHAR_WIDTH > SSD1306_WIDTH || CurrentY % 8 != 0 || CurrentY + 16 > SSD1306_HEIGHT) return;
+    if (ch < 32 || ch > 126) ch = '?';
+    const uint8_t* glyph = &Font5x7[(ch - 32) * 5];
+    uint8_t page = CurrentY / 8;
+
+    for (uint8_t col = 0; col < OLED_BIG_CHAR_WIDTH / 2; col++) {
+        uint8_t line = (col < 5) ? glyph[col] : 0x00;
+        if (color == SSD1306_COLOR_BLACK) line = ~line & 0x7F;
+        uint8_t low = Spread2[line & 0x0F];
+        uint8_t high = Spread2[line >> 4];
+        putByte(page, CurrentX, low);
+        putByte(page + 1, CurrentX, high);
+        putByte(page, CurrentX + 1, low);
+        putByte(page + 1, CurrentX + 1, high);
+        CurrentX += 2;
+    }
 }
 
 void ssd1306_WriteString(const char* str, SSD1306_COLOR color) {
@@ -165,23 +396,203 @@ void ssd1306_WriteString(const char* str, SSD1306_COLOR color) {
 
 // Инициализация дисплея
 void initOLED(void) {
-    vTaskDelay(100 / portTICK_PERIOD_MS); // Задержка для стабилизации
-    CMD(0xAE); CMD(0x20); CMD(0x00); CMD(0xB0); CMD(0xC8);
-    CMD(0x00); CMD(0x10); CMD(0x40); CMD(0x81); CMD(0x7F);
-    CMD(0xA1); CMD(0xA6); CMD(0xA8); CMD(0x3F); CMD(0xA4);
-    CMD(0xD3); CMD(0x00); CMD(0xD5); CMD(0xF0); CMD(0xD9);
-    CMD(0x22); CMD(0xDA); CMD(0x12); CMD(0xDB); CMD(0x20);
-    CMD(0x8D); CMD(0x14); CMD(0xAF);
+    // Команды инициализации передаются, когда дисплей ответит после включения питания
+    // (не дольше OLED_POWER_UP_MS): ожидает задача шины, а не задача OLED
+    txSubmit(0x00, (uint8_t*)InitCommands, sizeof(InitCommands), I2C_FLAG_WAIT_READY, false);
 
+    // Содержимое памяти дисплея после включения не определено: первый кадр передаётся целиком
+    markAllDirty();
     ssd1306_Fill(SSD1306_COLOR_BLACK);
     ssd1306_UpdateScreen();
 }
 
-// Отображение сообщения (адаптировано для FreeRTOS)
-bool displayMessage(const char* msg) {
-    extern QueueHandle_t oledQueue;
-    char buffer[128];
-    strncpy(buffer, msg, sizeof(buffer) - 1);
-    buffer[sizeof(buffer) - 1] = '\0';
-    return xQueueSend(oledQueue, buffer, portMAX_DELAY) == pdTRUE;
+// Одна строка экрана до '\n' или OLED_LINE_CHARS символов, остаток строки очищается.
+// Возвращает начало следующей строки текста
+static const char* renderLine(uint8_t line, const char* text) {
+    ssd1306_SetCursor(0, line * 8);
+    uint8_t count = 0;
+    while (*text != '\0' && *text != '\n' && count < OLED_LINE_CHARS) {
+        ssd1306_WriteChar(*text++, SSD1306_COLOR_WHITE);
+        count++;
+    }
+    if (*text == '\n') text++;
+    for (uint8_t col = CurrentX; col < SSD1306_WIDTH; col++) {
+        putByte(line, col, 0x00);
+    }
+    return text;
+}
+
+// Крупная строка на страницах page и page + 1: подпись мелким шрифтом и значение ("L 12.34")
+static void renderBigLine(uint8_t page, char label, const char* text) {
+    ssd1306_SetCursor(0, page * 8);
+    ssd1306_WriteChar(label, SSD1306_COLOR_WHITE);
+    for (uint8_t col = 0; col < OLED_BIG_TEXT_X; col++) {
+        if (col >= CurrentX) putByte(page, col, 0x00);
+        putByte(page + 1, col, 0x00);
+    }
+    ssd1306_SetCursor(OLED_BIG_TEXT_X, page * 8);
+    while (*text != '\0') {
+        ssd1306_WriteBigChar(*text++, SSD1306_COLOR_WHITE);
+    }
+    for (uint8_t col = CurrentX; col < SSD1306_WIDTH; col++) {
+        putByte(page, col, 0x00);
+        putByte(page + 1, col, 0x00);
+    }
+}
+
+// Раскладка сообщения по строкам экрана начиная с firstLine: строки разделяются '\n',
+// длинные переносятся. Остаток экрана очищается
+static void renderMessage(uint8_t firstLine, const char* msg) {
+    for (uint8_t line = firstLine; line < SSD1306_PAGES; line++) {
+        msg = renderLine(line, msg);
+    }
+}
+
+// Форматирование без snprintf: стек задачи OLED невелик
+static char* appendText(char* dst, const char* text) {
+    while (*text != '\0') *dst++ = *text++;
+    *dst = '\0';
+    return dst;
+}
+
+static char* appendNumber(char* dst, uint32_t value, uint8_t minDigits) {
+    char digits[10];
+    uint8_t count = 0;
+    do {
+        digits[count++] = '0' + value % 10;
+        value /= 10;
+    } while (value != 0 || count < minDigits);
+    while (count > 0) *dst++ = digits[--count];
+    *dst = '\0';
+    return dst;
+}
+
+// Объём в сотых долях литра: "12.34"
+static char* appendLiters(char* dst, uint32_t liters_dL) {
+    dst = appendNumber(dst, liters_dL / 100, 1);
+    *dst++ = '.';
+    return appendNumber(dst, liters_dL % 100, 2);
+}
+
+// Сумма на экране транзакции: при цене выше 9999 пост передаёт сумму в десятках
+static uint32_t displayAmount(const DisplayState* state) {
+    return state->price > 9999 ? state->amount * 10 : state->amount;
+}
+
+static const char* statusText(uint8_t status) {
+    switch (status) {
+        case DISPLAY_STATUS_DISPENSING: return "Dispensing...";
+        case DISPLAY_STATUS_PAUSED:     return "Paused";
+        case DISPLAY_STATUS_RESTORING:  return "Restoring trans...";
+        case DISPLAY_STATUS_STOPPED:    return "Trans stopped";
+        case DISPLAY_STATUS_END:        return "Filling end";
+        default:                        return "";
+    }
+}
+
+static const char* fuelModeText(uint8_t mode) {
+    switch (mode) {
+        case FUEL_BY_VOLUME:    return "Mode: Volume";
+        case FUEL_BY_PRICE:     return "Mode: Price";
+        case FUEL_BY_FULL_TANK: return "Mode: Full Tank";
+        default:                return "";
+    }
+}
+
+// Последнее отрисованное состояние
+static DisplayState shown;
+static bool shownValid = false;
+
+static bool sameState(const DisplayState* a, const DisplayState* b) {
+    return a->screen == b->screen && a->status == b->status && a->mode == b->mode &&
+           a->post == b->post && a->nozzle == b->nozzle && a->text == b->text &&
+           a->liters_dL == b->liters_dL && a->amount == b->amount && a->price == b->price &&
+           strcmp(a->input, b->input) == 0;
+}
+
+void renderState(const DisplayState* state) {
+    bool full = !shownValid || state->screen != shown.screen;
+    if (!full && sameState(state, &shown)) return;
+
+    char text[32];
+    char* p = text;
+    switch (state->screen) {
+        case DISPLAY_SCREEN_TRANSACTION:
+            // Статус мелким шрифтом, объём и сумма крупными цифрами (страницы 2-3 и 5-6).
+            // Во время налива меняются только объём и сумма: перерисовываются их строки
+            if (full || state->status != shown.status) {
+                renderLine(0, statusText(state->status));
+            }
+            if (full) {
+                renderLine(1, "");
+                renderLine(4, "");
+                renderLine(7, "");
+            }
+            if (full || state->liters_dL != shown.liters_dL) {
+                appendLiters(text, state->liters_dL);
+                renderBigLine(2, 'L', text);
+            }
+            if (full || displayAmount(state) != displayAmount(&shown)) {
+                appendNumber(text, displayAmount(state), 1);
+                renderBigLine(5, 'P', text);
+            }
+            break;
+        case DISPLAY_SCREEN_FUEL_MODE:
+            renderMessage(0, fuelModeText(state->mode));
+            break;
+        case DISPLAY_SCREEN_INPUT:
+            p = appendText(p, state->text);
+            p = appendText(p, ": ");
+            appendText(p, state->input);
+            renderMessage(0, text);
+            break;
+        case DISPLAY_SCREEN_PRICE:
+            p = appendText(p, "Price: ");
+            appendNumber(p, state->price, 1);
+            renderMessage(0, text);
+            break;
+        case DISPLAY_SCREEN_TOTAL:
+            p = appendText(p, "TOTAL:\n");
+            appendLiters(p, state->liters_dL);
+            renderMessage(0, text);
+            break;
+        case DISPLAY_SCREEN_NOZZLE:
+            p = appendText(p, "Post ");
+            p = appendNumber(p, state->post, 1);
+            p = appendText(p, " Nozzle ");
+            appendNumber(p, state->nozzle, 1);
+            renderMessage(0, text);
+            break;
+        default:
+            renderMessage(0, state->text != NULL ? state->text : "");
+            break;
+    }
+    shown = *state;
+    shownValid = true;
+}
+
+// Отображение состояния (адаптировано для FreeRTOS): почтовый ящик на одно состояние,
+// дисплей всегда рисует самое свежее
+void displayState(const DisplayState* state) {
+    extern QueueHandle_t oledStateMailbox;
+    if (uxQueueMessagesWaiting(oledStateMailbox) != 0) {
+        stats.superseded++;
+    }
+    xQueueOverwrite(oledStateMailbox, state);
+    notifyOLED(OLED_EVENT_STATE);
+}
+
+void displayMessage(const char* text) {
+    DisplayState state = { .screen = DISPLAY_SCREEN_TEXT, .text = text };
+    displayState(&state);
+}
+
+bool displayAlert(const DisplayState* state) {
+    extern QueueHandle_t oledAlertQueue;
+    if (xQueueSend(oledAlertQueue, state, 0) != pdTRUE) {
+        stats.alertsDropped++;
+        return false;
+    }
+    notifyOLED(OLED_EVENT_ALERT);
+    return true;
 }
@@ -3,187 +3,434 @@
 #include "rs422.h"
 #include "frame.h"
 #include "config.h"
+#include "settings.h"
 #include "crc.h"
-#include "oled.h"
+#include "log.h"
 #include <stdio.h>
 #include <string.h>
-#include <cmsis_os.h>
 #include <stdbool.h>
+#include "task.h"
 
 extern UART_HandleTypeDef huart2;
 extern QueueHandle_t rs422TxQueue;
 extern QueueHandle_t rs422RxQueue;
+extern QueueHandle_t rs422EventQueue;
+extern TaskHandle_t fsmTaskHandle;
 
-static const uint8_t slaveAddress[2] = {0x00, POST_ADDRESS};
-static bool isSending = false;
-static bool isReceiving = false;
+static uint16_t nextSeq = 1;       // Номер следующего запроса (0 не выдаётся)
 
-static uint8_t rxBuffer[32]; // Буфер для приёма данных
+// Статистика и адаптивный таймаут по каждому адресу шины (изменяются только задачей RS-422)
+static RS422PumpStats pumpStats[BUS_MAX_POSTS];
+
+// Кольцевой буфер приёма: DMA работает в циклическом режиме, а события
+// половины/конца буфера и паузы на линии (IDLE) отдают новые байты сборщику кадров
+static uint8_t rxRing[RS422_RX_RING_SIZE];
+static uint16_t rxRingPos = 0;     // Позиция, до которой байты уже обработаны
+static FrameAssembler rxAssembler;
+
+// Пул кадров передачи. Кадры собираются прямо в статических буферах (в .bss, доступной DMA1),
+// поэтому DMA читает живые данные и после возврата из sendRS422Command.
+// Кадры передаются строго по порядку: txTail - передаваемый кадр, txHead - следующий свободный
+typedef struct {
+    uint8_t data[MAX_FRAME_PAYLOAD + FRAME_MIN_LENGTH];
+    uint16_t length;
+    uint16_t seq;                        // Запрос, которому сообщается, если кадр не передан
+} RS422TxFrame;
+
+static RS422TxFrame txPool[RS422_TX_POOL_SIZE];
+static uint8_t txHead = 0;
+static volatile uint8_t txTail = 0;
+static volatile uint8_t txCount = 0;     // Кадры в очереди на передачу, включая текущий
+static volatile bool txActive = false;   // DMA принял кадр txTail и передаёт его
+static TaskHandle_t rs422TaskHandle = NULL;
+
+static void startReception(void) {
+    rxRingPos = 0;
+    frameAssemblerReset(&rxAssembler);
+    HAL_UARTEx_ReceiveToIdle_DMA(&huart2, rxRing, sizeof(rxRing));
+    // Прерывание на половине буфера не нужно: IDLE и конец буфера покрывают все случаи
+    __HAL_DMA_DISABLE_IT(huart2.hdmarx, DMA_IT_HT);
+}
 
 // Инициализация RS-422
 void initRS422(void) {
+    // Вызывается из задачи RS-422: ей адресуются уведомления о завершении передачи
+    rs422TaskHandle = xTaskGetCurrentTaskHandle();
+
     // UART2 уже инициализирован в main.c
-    // Запускаем приём через DMA
-    HAL_UART_Receive_DMA(&huart2, rxBuffer, sizeof(rxBuffer));
+    // Запускаем циклический приём через DMA с детектированием паузы на линии
+    startReception();
 }
 
-// Отправка команды через очередь
-void sendRS422Command(RS422Command* cmd) {
-    uint8_t frameBuffer[32];
+// Отправка кадра: кадр собирается в свободном буфере пула и ставится в очередь DMA.
+// RS422_FORMAT_ERROR - кадр не собран, RS422_TX_ERROR - DMA не принял кадр
+static RS422Status sendRS422Command(const RS422Request* req) {
+    // Пул заполнен - ждём уведомления от rs422TxCpltCallback
+    while (txCount >= RS422_TX_POOL_SIZE) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+
+    RS422TxFrame* frame = &txPool[txHead];
+    const uint8_t slaveAddress[2] = {0x00, req->address};
     int frameLength = 0;
-    assembleFrame(slaveAddress, cmd->command, cmd->payload, cmd->payloadLength, frameBuffer, &frameLength);
-    HAL_UART_Transmit_DMA(&huart2, frameBuffer, frameLength);
+    assembleFrame(slaveAddress, req->command, req->payload, req->payloadLength, frame->data, &frameLength);
+    if (frameLength == 0) {
+        LOG_EVENT(LOG_LEVEL_ERROR, LOG_MSG_RS422_TOO_LONG);
+        return RS422_FORMAT_ERROR;
+    }
+    frame->length = (uint16_t)frameLength;
+    frame->seq = req->seq;
+    txHead = (txHead + 1) % RS422_TX_POOL_SIZE;
+
+    // Если DMA простаивает, запускаем передачу сами, иначе кадр стартует из прерывания.
+    // Запуск - в той же критической секции, чтобы прерывания UART видели txActive согласованным с txCount
+    RS422Status status = RS422_OK;
+    taskENTER_CRITICAL();
+    if (txCount++ == 0) {
+        if (HAL_UART_Transmit_DMA(&huart2, frame->data, frame->length) == HAL_OK) {
+            txActive = true;
+        } else {
+            // TxCplt по кадру не придёт: освобождаем его сразу
+            txTail = (txTail + 1) % RS422_TX_POOL_SIZE;
+            txCount--;
+            status = RS422_TX_ERROR;
+        }
+    }
+    taskEXIT_CRITICAL();
+    return status;
 }
 
-// Функции отправки команд
-void rs422SendStatus(void) {
-    if (isSending || isReceiving) return;
-    isSending = true;
+// Передача завершения запроса задаче FSM
+static void completeRequest(const RS422Reply* reply) {
+    xQueueSend(rs422EventQueue, reply, portMAX_DELAY);
+    if (fsmTaskHandle != NULL) {
+        xTaskNotify(fsmTaskHandle, FSM_EVENT_REPLY, eSetBits);
+    }
+}
+
+const RS422PumpStats* rs422GetPumpStats(uint8_t address) {
+    return (address >= 1 && address <= BUS_MAX_POSTS) ? &pumpStats[address - 1] : NULL;
+}
+
+// Время передачи кадра длиной bytes на скорости settings->baudRate (мс, с округлением вверх)
+static uint32_t airTime(uint32_t bytes) {
+    return (bytes * 10 * 1000 + settings->baudRate - 1) / settings->baudRate;
+}
+
+// Таймаут по Якобсону: srtt + 4 * rttvar в пределах RS422_TIMEOUT_MIN..settings->responseTimeout.
+// До первого ответа используется верхняя граница
+static void updateTimeout(RS422PumpStats* stats) {
+    uint32_t timeout = settings->responseTimeout;
+    if (stats->replies > 0) {
+        timeout = stats->srtt8 / 8 + stats->rttvar4;
+        if (timeout < RS422_TIMEOUT_MIN) timeout = RS422_TIMEOUT_MIN;
+        if (timeout > settings->responseTimeout) timeout = settings->responseTimeout;
+    }
+    stats->timeout = (uint16_t)timeout;
+}
 
-    RS422Command cmd = {.command = 'S', .payloadLength = 0};
-    xQueueSend(rs422TxQueue, &cmd, portMAX_DELAY);
-    isSending = false;
+// Новое измерение времени оборота (сглаживание как в TCP: 1/8 для srtt, 1/4 для rttvar)
+static void recordRtt(RS422PumpStats* stats, uint32_t rtt) {
+    if (rtt > 0xFFFF) rtt = 0xFFFF;
+    if (stats->replies == 0) {
+        stats->srtt8 = rtt * 8;
+        stats->rttvar4 = rtt * 2;
+    } else {
+        int32_t delta = (int32_t)rtt - (int32_t)(stats->srtt8 / 8);
+        stats->srtt8 += delta;
+        if (delta < 0) delta = -delta;
+        stats->rttvar4 = stats->rttvar4 + delta - stats->rttvar4 / 4;
+    }
+    stats->lastRtt = (uint16_t)rtt;
+    if (rtt > stats->maxRtt) stats->maxRtt = (uint16_t)rtt;
+    stats->replies++;
+    stats->failures = 0;
+    stats->backoff = 0;
+    updateTimeout(stats);
+}
+
+// Неответ: после RS422_OFFLINE_FAILURES подряд пост опрашивается только пробными запросами
+// с экспоненциально растущим интервалом, чтобы не занимать шину на полный таймаут
+static void recordFailure(RS422PumpStats* stats) {
+    stats->timeouts++;
+    if (stats->failures < 0xFF) stats->failures++;
+    if (stats->failures >= RS422_OFFLINE_FAILURES) {
+        uint32_t backoff = stats->backoff ? stats->backoff * 2 : RS422_BACKOFF_MIN;
+        if (backoff > RS422_BACKOFF_MAX) backoff = RS422_BACKOFF_MAX;
+        stats->backoff = (uint16_t)backoff;
+        stats->backoffUntil = getCurrentMillis() + backoff;
+    }
 }
 
-void rs422SendTransaction(FuelMode mode, uint32_t volume, uint32_t amount, uint16_t price) {
-    if (isSending || isReceiving) return;
-    if (price > 9999) {
-        logMessage(LOG_LEVEL_ERROR, "Invalid price");
-        displayMessage("Invalid price");
+// Выполнение запроса: шина полудуплексная, поэтому запросы идут строго по одному.
+// Задача RS-422 ждёт ответа сама, FSM в это время не блокируется
+void processRS422Request(RS422Request* req) {
+    RS422Reply reply = {.seq = req->seq, .address = req->address, .status = RS422_TIMEOUT, .length = 0};
+    RS422PumpStats* stats = (RS422PumpStats*)rs422GetPumpStats(req->address);
+    if (stats == NULL) {
+        reply.status = RS422_FORMAT_ERROR;
+        completeRequest(&reply);
         return;
     }
-    isSending = true;
 
-    RS422Command cmd;
-    cmd.command = (mode == FUEL_BY_VOLUME) ? 'V' : 'M';
-    switch (mode) {
-        case FUEL_BY_VOLUME:
-            snprintf((char*)cmd.payload, sizeof(cmd.payload), "1;%06lu;%04u", volume, price);
+    // Недоступный пост в паузе между пробными запросами: шину не занимаем
+    if (stats->backoff != 0 && (int32_t)(stats->backoffUntil - getCurrentMillis()) > 0) {
+        stats->skipped++;
+        completeRequest(&reply);
+        return;
+    }
+    if (stats->timeout == 0) {
+        updateTimeout(stats);
+    }
+    stats->requests++;
+
+    // Таймаут - время реакции ТРК плюс передача запроса и ожидаемого ответа
+    uint32_t replyLength = req->expectedReply == 'T' ? TRANSACTION_END_RESPONSE_LENGTH : req->expectedLength;
+    uint32_t frameTime = airTime(FRAME_MIN_LENGTH + req->payloadLength) + airTime(replyLength);
+    uint32_t timeoutMs = stats->timeout + frameTime;
+    if (timeoutMs > req->timeout) timeoutMs = req->timeout;
+
+    // Кадры, оставшиеся от прошлых запросов, к этому запросу не относятся
+    xQueueReset(rs422RxQueue);
+    uint32_t startCycles = getCycleCount();
+    reply.status = sendRS422Command(req);
+    if (reply.status != RS422_OK) {
+        stats->errors++;
+        LOG_EVENT(LOG_LEVEL_ERROR, LOG_MSG_RS422_FAILED, req->command, req->address, reply.status);
+        completeRequest(&reply);
+        return;
+    }
+    reply.status = RS422_TIMEOUT;
+
+    TickType_t start = xTaskGetTickCount();
+    TickType_t timeout = pdMS_TO_TICKS(timeoutMs);
+    RS422Frame frame;
+    for (;;) {
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        if (elapsed >= timeout || xQueueReceive(rs422RxQueue, &frame, timeout - elapsed) != pdTRUE) {
             break;
-        case FUEL_BY_PRICE:
-            snprintf((char*)cmd.payload, sizeof(cmd.payload), "1;%06lu;%04u", amount, price);
-            logMessage(LOG_LEVEL_DEBUG, "Sending transaction amount");
+        }
+        if (frame.status == RS422_TX_ERROR) {
+            // Сообщение о кадре прежнего запроса, уже завершённого по таймауту
+            if (frame.seq != req->seq) {
+                continue;
+            }
+            reply.status = RS422_TX_ERROR;
             break;
-        case FUEL_BY_FULL_TANK:
-            snprintf((char*)cmd.payload, sizeof(cmd.payload), "1;999999;%04u", price);
+        }
+        if (frame.status == RS422_CRC_ERROR) {
+            reply.status = RS422_CRC_ERROR;
             break;
+        }
+        // Запоздавший ответ другого поста на общей шине пропускаем
+        if (frame.data[2] != req->address) {
+            continue;
+        }
+
+        // CRC и границы кадра уже проверены сборщиком кадров
+        memcpy(reply.data, frame.data, frame.length);
+        reply.length = frame.length;
+        reply.time = frame.time;
+        reply.status = (frame.data[3] == req->expectedReply && frame.length >= req->expectedLength)
+                       ? RS422_OK : RS422_FORMAT_ERROR;
+        break;
     }
-    cmd.payloadLength = strlen((char*)cmd.payload);
-    xQueueSend(rs422TxQueue, &cmd, portMAX_DELAY);
-    isSending = false;
-}
 
-void rs422SendTransactionUpdate(void) {
-    if (isSending || isReceiving) return;
-    isSending = true;
+    if (reply.status == RS422_OK) {
+        // Время оборота без передачи кадров: по нему считается следующий таймаут
+        uint32_t rtt = (frame.time - startCycles) / (SystemCoreClock / 1000);
+        uint32_t frames = airTime(FRAME_MIN_LENGTH + req->payloadLength) + airTime(frame.length);
+        recordRtt(stats, rtt > frames ? rtt - frames : 0);
+    } else if (reply.status == RS422_TIMEOUT) {
+        recordFailure(stats);
+    } else {
+        stats->errors++;
+    }
 
-    RS422Command cmd = {.command = 'T', .payloadLength = 0};
-    xQueueSend(rs422TxQueue, &cmd, portMAX_DELAY);
-    osDelay(1); // Задержка 500 мкс заменена на 1 мс в FreeRTOS
-    isSending = false;
+    if (reply.status != RS422_OK) {
+        LOG_EVENT(LOG_LEVEL_ERROR, LOG_MSG_RS422_FAILED, req->command, req->address, reply.status);
+    }
+    completeRequest(&reply);
 }
 
-void rs422SendNozzleOff(void) {
-    if (isSending || isReceiving) return;
-    isSending = true;
+// Постановка запроса в очередь задачи RS-422. Команды опроса возвращают одноимённый кадр,
+// на управляющие команды (N, B, G, V, M) FSM ждёт кадр статуса
+static uint16_t submitRequest(RS422Request* req) {
+    switch (req->command) {
+        case 'L':
+        case 'R':
+        case 'C':
+        case 'T':
+            req->expectedReply = req->command;
+            break;
+        default:
+            req->expectedReply = 'S';
+            break;
+    }
+    req->expectedLength = (req->expectedReply == 'T') ? TRANSACTION_END_MIN_LENGTH
+                                                      : frameExpectedLength(req->expectedReply);
+    req->timeout = settings->responseTimeout;
 
-    RS422Command cmd = {.command = 'N', .payloadLength = 0};
-    xQueueSend(rs422TxQueue, &cmd, portMAX_DELAY);
-    isSending = false;
-}
+    taskENTER_CRITICAL();
+    req->seq = nextSeq++;
+    if (nextSeq == 0) nextSeq = 1;
+    taskEXIT_CRITICAL();
 
-void rs422SendLitersMonitor(void) {
-    if (isSending || isReceiving) return;
-    isSending = true;
+    xQueueSend(rs422TxQueue, req, portMAX_DELAY);
+    return req->seq;
+}
 
-    RS422Command cmd = {.command = 'L', .payloadLength = 0};
-    xQueueSend(rs422TxQueue, &cmd, portMAX_DELAY);
-    isSending = false;
+// Функции отправки команд
+uint16_t rs422SendStatus(uint8_t address) {
+    RS422Request req = {.address = address, .command = 'S', .payloadLength = 0};
+    return submitRequest(&req);
 }
 
-void rs422SendRevenueStatus(void) {
-    if (isSending || isReceiving) return;
-    isSending = true;
+// Цена передаётся 4 знаками: FSM приводит её к диапазону 0..9999 до вызова (updateTransaction)
+uint16_t rs422SendTransaction(uint8_t address, uint8_t nozzle, FuelMode mode, uint32_t volume, uint32_t amount, uint16_t price) {
+    RS422Request req = {.address = address};
+    req.command = (mode == FUEL_BY_VOLUME) ? 'V' : 'M';
+    switch (mode) {
+        case FUEL_BY_VOLUME:
+            snprintf((char*)req.payload, sizeof(req.payload), "%u;%06lu;%04u", nozzle, volume, price);
+            break;
+        case FUEL_BY_PRICE:
+            snprintf((char*)req.payload, sizeof(req.payload), "%u;%06lu;%04u", nozzle, amount, price);
+            LOG_EVENT(LOG_LEVEL_DEBUG, LOG_MSG_SEND_AMOUNT);
+            break;
+        case FUEL_BY_FULL_TANK:
+            snprintf((char*)req.payload, sizeof(req.payload), "%u;999999;%04u", nozzle, price);
+            break;
+    }
+    req.payloadLength = strlen((char*)req.payload);
+    return submitRequest(&req);
+}
 
-    RS422Command cmd = {.command = 'R', .payloadLength = 0};
-    xQueueSend(rs422TxQueue, &cmd, portMAX_DELAY);
-    isSending = false;
+uint16_t rs422SendTransactionUpdate(uint8_t address) {
+    RS422Request req = {.address = address, .command = 'T', .payloadLength = 0};
+    return submitRequest(&req);
 }
 
-void rs422SendTotalCounter(void) {
-    if (isSending || isReceiving) return;
-    isSending = true;
+uint16_t rs422SendNozzleOff(uint8_t address) {
+    RS422Request req = {.address = address, .command = 'N', .payloadLength = 0};
+    return submitRequest(&req);
+}
 
-    RS422Command cmd = {.command = 'C', .payloadLength = 1};
-    cmd.payload[0] = '1';
-    xQueueSend(rs422TxQueue, &cmd, portMAX_DELAY);
-    logMessage(LOG_LEVEL_DEBUG, "Sending C1 command");
-    isSending = false;
+uint16_t rs422SendLitersMonitor(uint8_t address) {
+    RS422Request req = {.address = address, .command = 'L', .payloadLength = 0};
+    return submitRequest(&req);
 }
 
-void rs422SendPause(void) {
-    if (isSending || isReceiving) return;
-    isSending = true;
+uint16_t rs422SendRevenueStatus(uint8_t address) {
+    RS422Request req = {.address = address, .command = 'R', .payloadLength = 0};
+    return submitRequest(&req);
+}
 
-    RS422Command cmd = {.command = 'B', .payloadLength = 0};
-    xQueueSend(rs422TxQueue, &cmd, portMAX_DELAY);
-    logMessage(LOG_LEVEL_DEBUG, "Sending pause command");
-    isSending = false;
+uint16_t rs422SendTotalCounter(uint8_t address, uint8_t nozzle) {
+    RS422Request req = {.address = address, .command = 'C', .payloadLength = 1};
+    req.payload[0] = '0' + nozzle;
+    LOG_EVENT(LOG_LEVEL_DEBUG, LOG_MSG_SEND_TOTAL);
+    return submitRequest(&req);
 }
 
-void rs422SendResume(void) {
-    if (isSending || isReceiving) return;
-    isSending = true;
+uint16_t rs422SendPause(uint8_t address) {
+    RS422Request req = {.address = address, .command = 'B', .payloadLength = 0};
+    LOG_EVENT(LOG_LEVEL_DEBUG, LOG_MSG_SEND_PAUSE);
+    return submitRequest(&req);
+}
 
-    RS422Command cmd = {.command = 'G', .payloadLength = 0};
-    xQueueSend(rs422TxQueue, &cmd, portMAX_DELAY);
-    logMessage(LOG_LEVEL_DEBUG, "Sending resume command");
-    isSending = false;
+uint16_t rs422SendResume(uint8_t address) {
+    RS422Request req = {.address = address, .command = 'G', .payloadLength = 0};
+    LOG_EVENT(LOG_LEVEL_DEBUG, LOG_MSG_SEND_RESUME);
+    return submitRequest(&req);
 }
 
-// Ожидание ответа (асинхронно через очередь)
-int rs422WaitForResponse(uint8_t* buffer, int expectedLength, char expectedCommand) {
-    if (isReceiving) return 0;
-    isReceiving = true;
+// Передача собранного кадра задаче RS-422 (контекст прерывания).
+// length == 0 - сборщик отбросил кадр с неверной CRC
+static void deliverFrame(int length, BaseType_t* xHigherPriorityTaskWoken) {
+    RS422Frame frame;
+    frame.length = (uint8_t)length;
+    frame.status = (length > 0) ? RS422_OK : RS422_CRC_ERROR;
+    frame.seq = 0;
+    frame.time = getCycleCount();
+    memcpy(frame.data, rxAssembler.frame, length);
+    xQueueSendFromISR(rs422RxQueue, &frame, xHigherPriorityTaskWoken);
+}
 
-    int count = 0;
-    uint8_t rxData[32];
-    TickType_t startTime = xTaskGetTickCount();
+// Передача новых байтов кольцевого буфера сборщику кадров (контекст прерывания)
+static void processRxBytes(uint16_t end, bool lineIdle, BaseType_t* xHigherPriorityTaskWoken) {
+    while (rxRingPos < end) {
+        uint32_t crcErrors = rxAssembler.crcErrors;
+        int length = frameAssemblerPush(&rxAssembler, rxRing[rxRingPos++]);
+        if (length > 0 || rxAssembler.crcErrors != crcErrors) {
+            deliverFrame(length, xHigherPriorityTaskWoken);
+        }
+    }
+    if (rxRingPos >= RS422_RX_RING_SIZE) {
+        rxRingPos = 0;
+    }
+    if (lineIdle) {
+        int length = frameAssemblerIdle(&rxAssembler);
+        if (length > 0) {
+            deliverFrame(length, xHigherPriorityTaskWoken);
+        }
+    }
+}
 
-    while ((xTaskGetTickCount() - startTime) * portTICK_PERIOD_MS < RESPONSE_TIMEOUT) {
-        if (xQueueReceive(rs422RxQueue, rxData, 10 / portTICK_PERIOD_MS) == pdTRUE) {
-            memcpy(buffer, rxData, expectedLength);
-            count = expectedLength;
+// Callback приёма: Size - позиция записи DMA в кольцевом буфере
+void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size) {
+    if (huart == &huart2) {
+        BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+        bool lineIdle = HAL_UARTEx_GetRxEventType(huart) == HAL_UART_RXEVENT_IDLE;
+        processRxBytes(Size, lineIdle, &xHigherPriorityTaskWoken);
+        portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+    }
+}
 
-            // Проверка формата ответа
-            if (buffer[0] != 0x02 || buffer[1] != slaveAddress[0] || buffer[2] != slaveAddress[1] || buffer[3] != expectedCommand) {
-                logMessage(LOG_LEVEL_ERROR, "Invalid response format or command");
-                displayMessage("Invalid response from pump");
-                count = -1;
-                break;
-            }
+// Кадр txTail не передан (контекст прерывания): TxCplt по нему не придёт, поэтому кадр
+// освобождается здесь, а запрос, которому он принадлежит, завершается ошибкой передачи
+static void failTxFrame(BaseType_t* xHigherPriorityTaskWoken) {
+    RS422Frame frame = {.length = 0, .status = RS422_TX_ERROR, .seq = txPool[txTail].seq, .time = getCycleCount()};
+    xQueueSendFromISR(rs422RxQueue, &frame, xHigherPriorityTaskWoken);
+    txTail = (txTail + 1) % RS422_TX_POOL_SIZE;
+    txCount--;
+}
 
-            // Проверка CRC
-            uint8_t calcCRC = calculateCRC(buffer, expectedLength - 1);
-            if (calcCRC != buffer[expectedLength - 1]) {
-                logMessage(LOG_LEVEL_ERROR, "CRC mismatch");
-                displayMessage("Invalid response from pump");
-                count = -1;
-            }
-            break;
+// Запуск следующего кадра пула (контекст прерывания); кадры, которые DMA не принял, освобождаются
+static void startNextFrame(BaseType_t* xHigherPriorityTaskWoken) {
+    txActive = false;
+    while (txCount > 0) {
+        if (HAL_UART_Transmit_DMA(&huart2, txPool[txTail].data, txPool[txTail].length) == HAL_OK) {
+            txActive = true;
+            return;
         }
+        failTxFrame(xHigherPriorityTaskWoken);
     }
+}
 
-    isReceiving = false;
-    return count;
+// Ошибка UART2. При ошибке приёма (переполнение, шум, кадр) HAL останавливает приём - перезапускаем его.
+// Ошибка DMA передачи обрывает её (gState уже не BUSY_TX): кадр освобождается с ошибкой, следующий стартует
+void rs422ErrorCallback(void) {
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    if (txActive && huart2.gState != HAL_UART_STATE_BUSY_TX) {
+        failTxFrame(&xHigherPriorityTaskWoken);
+        startNextFrame(&xHigherPriorityTaskWoken);
+        if (rs422TaskHandle != NULL) {
+            vTaskNotifyGiveFromISR(rs422TaskHandle, &xHigherPriorityTaskWoken);
+        }
+    }
+    startReception();
+    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
 }
 
-// Callback для приёма данных через DMA
-void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart) {
-    if (huart == &huart2) {
-        BaseType_t xHigherPriorityTaskWoken = pdFALSE;
-        xQueueSendFromISR(rs422RxQueue, rxBuffer, &xHigherPriorityTaskWoken);
-        HAL_UART_Receive_DMA(&huart2, rxBuffer, sizeof(rxBuffer));
-        portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+// Завершение передачи кадра: освобождаем его и сразу запускаем следующий из очереди
+void rs422TxCpltCallback(void) {
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    txTail = (txTail + 1) % RS422_TX_POOL_SIZE;
+    txCount--;
+    startNextFrame(&xHigherPriorityTaskWoken);
+    if (rs422TaskHandle != NULL) {
+        vTaskNotifyGiveFromISR(rs422TaskHandle, &xHigherPriorityTaskWoken);
     }
+    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
 }
@@ -0,0 +1,158 @@
+/* settings.c - Настройки поста: версия схемы, CRC и две копии записи в EEPROM */
+
+#include "settings.h"
+#include "config.h"
+#include "eeprom.h"
+#include "crc.h"
+#include "log.h"
+#include <stddef.h>
+#include <string.h>
+
+// Запись настроек (EEPROM_SETTINGS_RECORD_SIZE байт):
+//  0      SETTINGS_MAGIC
+//  1      версия схемы записи
+//  2..3   поколение: действует целая копия с большим поколением, а новая запись пишется
+//         в другую копию, и отключение питания посреди записи оставляет прежние настройки
+//  4..25  поля по таблице fields, незанятые байты - нули
+//  26..27 CRC-16 байтов 0..25
+// Поля только добавляются, каждое - со своей версией схемы. У записи старой версии новых
+// полей нет, и они берутся по умолчанию (перевод на новую схему); запись более новой версии
+// (после возврата прежней прошивки) читается по известным полям
+#define SETTINGS_MAGIC 0x53
+#define SETTINGS_VERSION 2
+#define SETTINGS_CRC_OFFSET 26
+
+#if POST_ADDRESS < 1 || POST_ADDRESS + BUS_POST_COUNT - 1 > BUS_MAX_POSTS
+#error "POST_ADDRESS out of range for BUS_POST_COUNT"
+#endif
+
+typedef struct {
+    uint8_t member;             // Смещение в Settings
+    uint8_t size;               // Байт в Settings и в записи
+    uint8_t offset;             // Смещение в записи
+    uint8_t version;            // Версия схемы, в которой поле появилось
+    uint32_t min;
+    uint32_t max;
+    uint32_t defaultValue;
+} SettingsField;
+
+#define SETTINGS_FIELD(name, offset, version, min, max, defaultValue) \
+    { offsetof(Settings, name), sizeof(((Settings*)0)->name), offset, version, min, max, defaultValue }
+
+static const SettingsField fields[] = {
+    SETTINGS_FIELD(postAddress,        4,  1, 1, BUS_MAX_POSTS - BUS_POST_COUNT + 1, POST_ADDRESS),
+    SETTINGS_FIELD(maxErrorCount,      5,  1, 1, 50, MAX_ERROR_COUNT),
+    SETTINGS_FIELD(delayAfterResponse, 6,  1, 0, 100, DELAY_AFTER_RESPONSE),
+    SETTINGS_FIELD(keyDebounceMs,      7,  1, 1, 100, KEY_DEBOUNCE_MS),
+    SETTINGS_FIELD(baudRate,           8,  1, 1200, 115200, RS422_BAUD_RATE),
+    SETTINGS_FIELD(responseTimeout,    12, 1, RS422_TIMEOUT_MIN, 60000, RESPONSE_TIMEOUT),
+    SETTINGS_FIELD(editTimeout,        14, 1, 1000, 60000, EDIT_TIMEOUT),
+    SETTINGS_FIELD(keyScanMs,          16, 2, 5, 200, KEY_SCAN_PERIOD_MS),
+};
+#define SETTINGS_FIELD_COUNT (sizeof(fields) / sizeof(fields[0]))
+
+Settings settingsStorage;
+
+// Копия с действующей записью (-1 - записи нет) и её поколение: saveSettings пишет в другую
+static int8_t storedCopy = -1;
+static uint16_t storedGeneration;
+
+static uint32_t getBytes(const uint8_t* p, uint8_t size) {
+    uint32_t value = 0;
+    for (uint8_t i = size; i > 0; i--) {
+        value = (value << 8) | p[i - 1];
+    }
+    return value;
+}
+
+static void putBytes(uint8_t* p, uint8_t size, uint32_t value) {
+    for (uint8_t i = 0; i < size; i++) {
+        p[i] = value & 0xFF;
+        value >>= 8;
+    }
+}
+
+static uint32_t getField(const Settings* s, const SettingsField* f) {
+    return getBytes((const uint8_t*)s + f->member, f->size);
+}
+
+static void setField(Settings* s, const SettingsField* f, uint32_t value) {
+    putBytes((uint8_t*)s + f->member, f->size, value);
+}
+
+// Целая запись: признак, известная или более новая версия и CRC
+static bool validRecord(const uint8_t* record) {
+    uint16_t crc = record[SETTINGS_CRC_OFFSET] | (record[SETTINGS_CRC_OFFSET + 1] << 8);
+    return record[0] == SETTINGS_MAGIC && record[1] != 0 && record[1] != 0xFF &&
+           calculateCRC16(record, SETTINGS_CRC_OFFSET) == crc;
+}
+
+static uint16_t recordGeneration(const uint8_t* record) {
+    return (uint16_t)getBytes(record + 2, 2);
+}
+
+// Настройки из записи (NULL - записи нет); возвращает число полей, взятых по умолчанию
+static uint8_t decodeSettings(const uint8_t* record, Settings* s) {
+    uint8_t version = (record != NULL) ? record[1] : 0;
+    uint8_t defaulted = 0;
+    for (uint8_t i = 0; i < SETTINGS_FIELD_COUNT; i++) {
+        const SettingsField* f = &fields[i];
+        uint32_t value = f->defaultValue;
+        if (version >= f->version) {
+            uint32_t stored = getBytes(record + f->offset, f->size);
+            if (stored >= f->min && stored <= f->max) {
+                value = stored;
+            } else {
+                defaulted++;
+            }
+        } else {
+            defaulted++;
+        }
+        setField(s, f, value);
+    }
+    return defaulted;
+}
+
+void initSettings(void) {
+    uint8_t records[EEPROM_SETTINGS_COPIES][EEPROM_SETTINGS_RECORD_SIZE];
+    storedCopy = -1;
+    if (readSettingsRecords(records)) {
+        for (uint8_t i = 0; i < EEPROM_SETTINGS_COPIES; i++) {
+            if (!validRecord(records[i])) continue;
+            // Поколение считается по кругу: новее копия, опережающая другую меньше чем на полкруга
+            if (storedCopy < 0 || (int16_t)(recordGeneration(records[i]) - recordGeneration(records[storedCopy])) > 0) {
+                storedCopy = i;
+            }
+        }
+    }
+
+    const uint8_t* record = (storedCopy >= 0) ? records[storedCopy] : NULL;
+    storedGeneration = (record != NULL) ? recordGeneration(record) : 0;
+    uint8_t defaulted = decodeSettings(record, &settingsStorage);
+    LOG_EVENT(LOG_LEVEL_DEBUG, LOG_MSG_SETTINGS, storedGeneration, (record != NULL) ? record[1] : 0, defaulted,
+              settings->postAddress, settings->baudRate, settings->responseTimeout, settings->delayAfterResponse,
+              settings->editTimeout, settings->maxErrorCount, settings->keyDebounceMs, settings->keyScanMs);
+}
+
+bool saveSettings(const Settings* s) {
+    uint8_t record[EEPROM_SETTINGS_RECORD_SIZE];
+    memset(record, 0, sizeof(record));
+    record[0] = SETTINGS_MAGIC;
+    record[1] = SETTINGS_VERSION;
+    putBytes(record + 2, 2, (uint16_t)(storedGeneration + 1));
+    for (uint8_t i = 0; i < SETTINGS_FIELD_COUNT; i++) {
+        const SettingsField* f = &fields[i];
+        uint32_t value = getField(s, f);
+        if (value < f->min || value > f->max) return false;
+        putBytes(record + f->offset, f->size, value);
+    }
+    uint16_t crc = calculateCRC16(record, SETTINGS_CRC_OFFSET);
+    record[SETTINGS_CRC_OFFSET] = crc & 0xFF;
+    record[SETTINGS_CRC_OFFSET + 1] = crc >> 8;
+
+    uint8_t copy = (storedCopy < 0) ? 0 : (uint8_t)(storedCopy ^ 1);
+    if (!writeSettingsRecord(copy, record)) return false;
+    storedCopy = copy;
+    storedGeneration++;
+    return true;
+}
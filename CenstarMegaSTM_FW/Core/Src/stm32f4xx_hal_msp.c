@@ -3,11 +3,12 @@
 #include "main.h" // Включаем main.h для Error_Handler
 #include "stm32f4xx_hal.h"
 
-// Дескрипторы DMA для UART2 и UART3
+// Дескрипторы DMA для UART2, UART3 и I2C1
 DMA_HandleTypeDef hdma_usart2_rx;
 DMA_HandleTypeDef hdma_usart2_tx;
 DMA_HandleTypeDef hdma_usart3_rx;
 DMA_HandleTypeDef hdma_usart3_tx;
+DMA_HandleTypeDef hdma_i2c1_tx;
 
 void HAL_MspInit(void)
 {
@@ -29,6 +30,32 @@ void HAL_I2C_MspInit(I2C_HandleTypeDef* hi2c)
         HAL_GPIO_Init(GPIOB, &GPIO_InitStruct);
 
         __HAL_RCC_I2C1_CLK_ENABLE();
+
+        // DMA для I2C1 TX (DMA1 Stream 7, Channel 1): кадры дисплея
+        __HAL_RCC_DMA1_CLK_ENABLE();
+        hdma_i2c1_tx.Instance = DMA1_Stream7;
+        hdma_i2c1_tx.Init.Channel = DMA_CHANNEL_1;
+        hdma_i2c1_tx.Init.Direction = DMA_MEMORY_TO_PERIPH;
+        hdma_i2c1_tx.Init.PeriphInc = DMA_PINC_DISABLE;
+        hdma_i2c1_tx.Init.MemInc = DMA_MINC_ENABLE;
+        hdma_i2c1_tx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+        hdma_i2c1_tx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+        hdma_i2c1_tx.Init.Mode = DMA_NORMAL;
+        hdma_i2c1_tx.Init.Priority = DMA_PRIORITY_LOW;
+        hdma_i2c1_tx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+        if (HAL_DMA_Init(&hdma_i2c1_tx) != HAL_OK)
+        {
+            Error_Handler();
+        }
+        __HAL_LINKDMA(hi2c, hdmatx, hdma_i2c1_tx);
+
+        // Прерывания DMA и I2C1: фаза адреса и завершение передачи идут через события I2C
+        HAL_NVIC_SetPriority(DMA1_Stream7_IRQn, 5, 0);
+        HAL_NVIC_EnableIRQ(DMA1_Stream7_IRQn);
+        HAL_NVIC_SetPriority(I2C1_EV_IRQn, 5, 0);
+        HAL_NVIC_EnableIRQ(I2C1_EV_IRQn);
+        HAL_NVIC_SetPriority(I2C1_ER_IRQn, 5, 0);
+        HAL_NVIC_EnableIRQ(I2C1_ER_IRQn);
     }
 }
 
@@ -38,6 +65,10 @@ void HAL_I2C_MspDeInit(I2C_HandleTypeDef* hi2c)
     {
         __HAL_RCC_I2C1_CLK_DISABLE();
         HAL_GPIO_DeInit(GPIOB, GPIO_PIN_6 | GPIO_PIN_7);
+        HAL_DMA_DeInit(hi2c->hdmatx);
+        HAL_NVIC_DisableIRQ(DMA1_Stream7_IRQn);
+        HAL_NVIC_DisableIRQ(I2C1_EV_IRQn);
+        HAL_NVIC_DisableIRQ(I2C1_ER_IRQn);
     }
 }
 
@@ -68,7 +99,7 @@ void HAL_UART_MspInit(UART_HandleTypeDef* huart)
         hdma_usart2_rx.Init.MemInc = DMA_MINC_ENABLE;
         hdma_usart2_rx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
         hdma_usart2_rx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
-        hdma_usart2_rx.Init.Mode = DMA_NORMAL;
+        hdma_usart2_rx.Init.Mode = DMA_CIRCULAR; // Кольцевой буфер приёма
         hdma_usart2_rx.Init.Priority = DMA_PRIORITY_LOW;
         hdma_usart2_rx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
         if (HAL_DMA_Init(&hdma_usart2_rx) != HAL_OK)
@@ -99,6 +130,10 @@ void HAL_UART_MspInit(UART_HandleTypeDef* huart)
         HAL_NVIC_EnableIRQ(DMA1_Stream5_IRQn);
         HAL_NVIC_SetPriority(DMA1_Stream6_IRQn, 5, 0);
         HAL_NVIC_EnableIRQ(DMA1_Stream6_IRQn);
+
+        // Прерывание UART2 для события паузы на линии (IDLE) и ошибок приёма
+        HAL_NVIC_SetPriority(USART2_IRQn, 5, 0);
+        HAL_NVIC_EnableIRQ(USART2_IRQn);
     }
     else if (huart->Instance == USART3)
     {
@@ -159,6 +194,10 @@ void HAL_UART_MspInit(UART_HandleTypeDef* huart)
         HAL_NVIC_EnableIRQ(DMA1_Stream1_IRQn);
         HAL_NVIC_SetPriority(DMA1_Stream3_IRQn, 5, 0);
         HAL_NVIC_EnableIRQ(DMA1_Stream3_IRQn);
+
+        // Прерывание UART3: окончание передачи DMA-участка лога (флаг TC)
+        HAL_NVIC_SetPriority(USART3_IRQn, 5, 0);
+        HAL_NVIC_EnableIRQ(USART3_IRQn);
     }
 }
 
@@ -172,6 +211,7 @@ void HAL_UART_MspDeInit(UART_HandleTypeDef* huart)
         HAL_DMA_DeInit(huart->hdmatx);
         HAL_NVIC_DisableIRQ(DMA1_Stream5_IRQn);
         HAL_NVIC_DisableIRQ(DMA1_Stream6_IRQn);
+        HAL_NVIC_DisableIRQ(USART2_IRQn);
     }
     else if (huart->Instance == USART3)
     {
@@ -182,5 +222,6 @@ void HAL_UART_MspDeInit(UART_HandleTypeDef* huart)
         HAL_DMA_DeInit(huart->hdmatx);
         HAL_NVIC_DisableIRQ(DMA1_Stream1_IRQn);
         HAL_NVIC_DisableIRQ(DMA1_Stream3_IRQn);
+        HAL_NVIC_DisableIRQ(USART3_IRQn);
     }
 }
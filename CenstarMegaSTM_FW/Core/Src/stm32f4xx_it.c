@@ -8,6 +8,8 @@ extern DMA_HandleTypeDef hdma_usart2_rx;
 extern DMA_HandleTypeDef hdma_usart2_tx;
 extern DMA_HandleTypeDef hdma_usart3_rx;
 extern DMA_HandleTypeDef hdma_usart3_tx;
+extern DMA_HandleTypeDef hdma_i2c1_tx;
+extern I2C_HandleTypeDef hi2c1;
 extern UART_HandleTypeDef huart2;
 extern UART_HandleTypeDef huart3;
 
@@ -43,6 +45,11 @@ void DebugMon_Handler(void)
 // SysTick_Handler, SVC_Handler, PendSV_Handler
 // Поэтому мы их не переопределяем здесь.
 
+void PVD_IRQHandler(void)
+{
+    HAL_PWR_PVD_IRQHandler();
+}
+
 void TIM2_IRQHandler(void)
 {
     HAL_TIM_IRQHandler(&htim2);
@@ -68,6 +75,21 @@ void DMA1_Stream6_IRQHandler(void)
     HAL_DMA_IRQHandler(&hdma_usart2_tx);
 }
 
+void DMA1_Stream7_IRQHandler(void)
+{
+    HAL_DMA_IRQHandler(&hdma_i2c1_tx);
+}
+
+void I2C1_EV_IRQHandler(void)
+{
+    HAL_I2C_EV_IRQHandler(&hi2c1);
+}
+
+void I2C1_ER_IRQHandler(void)
+{
+    HAL_I2C_ER_IRQHandler(&hi2c1);
+}
+
 void USART2_IRQHandler(void)
 {
     HAL_UART_IRQHandler(&huart2);
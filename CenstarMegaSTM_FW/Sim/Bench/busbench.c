@@ -0,0 +1,128 @@
+/* busbench.c - Хостовый замер планировщика опроса шины RS-422 (bus.c)
+ *
+ * Цикл задачи FSM воспроизводится на модельном времени: пост, получивший слот, передаёт
+ * запрос статуса, если подошёл его срок (пост в ожидании - раз в FSM_IDLE_POLL_PERIOD после
+ * ответа, пост, ведущий отпуск, - через DELAY_AFTER_RESPONSE), и шина занята на время
+ * передачи запроса, реакции ТРК и ответа. Если срок не подошёл ни у одного поста, FSM спит
+ * до ближайшего. Для N постов выводятся опросы в секунду и выданные слоты, для постов в
+ * ожидании - наименьшее и наибольшее по постам число опросов и наибольший интервал между
+ * запросами, для поста, ведущего отпуск (первого), - те же величины и его доля слотов.
+ * С -v выводятся опросы и наибольший интервал каждого поста. Если при BUS_MAX_POSTS постах
+ * доля слотов поста, ведущего отпуск, меньше половины, замер завершается с ошибкой.
+ *
+ *   make busbench && ./build/busbench [-v] [время реакции ТРК, мс]
+ */
+
+#include "bus.h"
+#include "frame.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_DURATION_MS 60000
+
+static uint32_t now;
+static bool verbose = false;
+
+uint32_t getCurrentMillis(void) {
+    return now;
+}
+
+// Время передачи кадра длиной bytes на RS422_BAUD_RATE (мс, с округлением вверх)
+static uint32_t airTime(uint32_t bytes) {
+    return (bytes * 10 * 1000 + RS422_BAUD_RATE - 1) / RS422_BAUD_RATE;
+}
+
+// Возвращает долю слотов, выданных первому посту
+static double run(uint8_t count, bool active, uint32_t reaction) {
+    uint8_t addresses[BUS_MAX_POSTS];
+    uint32_t due[BUS_MAX_POSTS];
+    now = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        addresses[i] = 1 + i;
+        due[i] = 0;
+    }
+    busInit(addresses, count);
+    if (active) busSetPostClass(0, BUS_POST_ACTIVE);
+
+    uint32_t requestTime = airTime(FRAME_MIN_LENGTH) + reaction + airTime(STATUS_RESPONSE_LENGTH);
+    uint32_t grants = 0;
+    uint32_t firstGrants = 0;
+    uint8_t post = busNextPost();
+    while (now < BENCH_DURATION_MS) {
+        if ((int32_t)(now - due[post]) >= 0) {
+            busRecordPoll(post);
+            now += requestTime;
+            bool postActive = active && post == 0;
+            due[post] = now + (postActive ? DELAY_AFTER_RESPONSE : FSM_IDLE_POLL_PERIOD);
+        }
+        post = busNextPost();
+        grants++;
+        if (post == 0) firstGrants++;
+
+        // Срок не подошёл ни у одного поста: FSM спит до ближайшего
+        uint32_t wait = FSM_IDLE_POLL_PERIOD;
+        for (uint8_t i = 0; i < count; i++) {
+            int32_t remaining = (int32_t)(due[i] - now);
+            if (remaining <= 0) {
+                wait = 0;
+                break;
+            }
+            if ((uint32_t)remaining < wait) wait = remaining;
+        }
+        now += wait;
+    }
+
+    uint32_t minPolls = UINT32_MAX, maxPolls = 0, minStale = UINT32_MAX, maxStale = 0;
+    for (uint8_t i = active ? 1 : 0; i < count; i++) {
+        const BusPost* p = busGetPost(i);
+        if (p->polls < minPolls) minPolls = p->polls;
+        if (p->polls > maxPolls) maxPolls = p->polls;
+        if (p->maxStaleness < minStale) minStale = p->maxStaleness;
+        if (p->maxStaleness > maxStale) maxStale = p->maxStaleness;
+    }
+    printf("%2u posts%s: %6.1f polls/s, %7.1f slots/s, idle polls %5lu..%-5lu staleness %4lu..%-4lu ms",
+           count, active ? " (1 active)" : "           ", busGetTotalPolls() * 1000.0 / now,
+           grants * 1000.0 / now, (unsigned long)minPolls, (unsigned long)maxPolls,
+           (unsigned long)minStale, (unsigned long)maxStale);
+    if (active) {
+        const BusPost* p = busGetPost(0);
+        printf(", active polls %lu staleness %lu ms, %4.1f%% of slots", (unsigned long)p->polls,
+               (unsigned long)p->maxStaleness, firstGrants * 100.0 / grants);
+    }
+    printf("\n");
+    if (verbose) {
+        for (uint8_t i = 0; i < count; i++) {
+            const BusPost* p = busGetPost(i);
+            printf("    post %2u: %5lu polls, staleness %4lu ms\n", p->address,
+                   (unsigned long)p->polls, (unsigned long)p->maxStaleness);
+        }
+    }
+    return (double)firstGrants / grants;
+}
+
+int main(int argc, char** argv) {
+    uint32_t reaction = 5;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-v") == 0) {
+            verbose = true;
+        } else {
+            reaction = (uint32_t)atoi(argv[i]);
+        }
+    }
+    static const uint8_t counts[] = {1, 2, 4, 8, 16, BUS_MAX_POSTS};
+    printf("RS-422 %u baud, pump reaction %lu ms, idle poll period %u ms\n",
+           RS422_BAUD_RATE, (unsigned long)reaction, FSM_IDLE_POLL_PERIOD);
+    for (unsigned i = 0; i < sizeof(counts); i++) {
+        run(counts[i], false, reaction);
+        if (counts[i] > 1) {
+            double activeShare = run(counts[i], true, reaction);
+            if (counts[i] == BUS_MAX_POSTS && activeShare < 0.5) {
+                printf("FAIL: active post gets %.1f%% of slots at %u posts\n",
+                       activeShare * 100.0, BUS_MAX_POSTS);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
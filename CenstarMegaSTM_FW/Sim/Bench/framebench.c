@@ -0,0 +1,162 @@
+/* framebench.c - Хостовая проверка сборки кадров RS-422 из потока байт (frame.c)
+ *
+ * Поток, принятый через кольцевой DMA, приходит участками произвольной длины: кадр может
+ * быть разрезан паузами на линии (IDLE), несколько кадров - слиты в один участок, перед
+ * кадром - мусор или обрывок прежнего. Для каждого сценария байты подаются в
+ * frameAssemblerPush, на границах участков - frameAssemblerIdle, и собранные кадры
+ * сравниваются с ожидаемыми, как и счётчики отброшенных байт и ошибок CRC.
+ *
+ *   make framebench && ./build/framebench
+ */
+
+#include "frame.h"
+#include "crc.h"
+#include <stdio.h>
+#include <string.h>
+
+#define MAX_FRAMES 8
+
+typedef struct {
+    uint8_t data[MAX_FRAME_LENGTH];
+    int length;
+} Frame;
+
+// Собранные кадры сценария
+static Frame out[MAX_FRAMES];
+static int outCount;
+static unsigned failures;
+
+// Кадр ответа ТРК. Ответ T длиннее MAX_FRAME_PAYLOAD (предел для передаваемых кадров),
+// поэтому кадр собирается здесь так же, как в assembleFrame
+static Frame makeFrame(uint8_t address, char command, const uint8_t* payload, int payloadLength) {
+    Frame f;
+    f.data[0] = FRAME_STX;
+    f.data[1] = 0x00;
+    f.data[2] = address;
+    f.data[3] = (uint8_t)command;
+    memcpy(f.data + 4, payload, payloadLength);
+    f.length = 4 + payloadLength;
+    f.data[f.length] = calculateCRC(f.data, f.length);
+    f.length++;
+    return f;
+}
+
+static void collect(const FrameAssembler* fa, int length) {
+    if (length == 0) return;
+    if (outCount < MAX_FRAMES) {
+        memcpy(out[outCount].data, fa->frame, length);
+        out[outCount].length = length;
+    }
+    outCount++;
+}
+
+// Подача участков: chunks - длины участков подряд из stream, после каждого - пауза на линии
+static void feed(FrameAssembler* fa, const uint8_t* stream, const int* chunks, int chunkCount) {
+    int pos = 0;
+    for (int c = 0; c < chunkCount; c++) {
+        for (int i = 0; i < chunks[c]; i++) {
+            collect(fa, frameAssemblerPush(fa, stream[pos++]));
+        }
+        collect(fa, frameAssemblerIdle(fa));
+    }
+}
+
+static void expect(const char* name, const FrameAssembler* fa, const Frame* frames, int count,
+                   uint32_t dropped, uint32_t crcErrors) {
+    bool ok = outCount == count && fa->droppedBytes == dropped && fa->crcErrors == crcErrors;
+    for (int i = 0; ok && i < count; i++) {
+        ok = out[i].length == frames[i].length && memcmp(out[i].data, frames[i].data, frames[i].length) == 0;
+    }
+    printf("%-28s %d frames, %lu dropped B, %lu CRC errors: %s\n", name, outCount,
+           (unsigned long)fa->droppedBytes, (unsigned long)fa->crcErrors, ok ? "ok" : "FAILED");
+    if (!ok) failures++;
+}
+
+// Склейка кадров и вставок в один поток
+static int append(uint8_t* stream, int pos, const uint8_t* data, int length) {
+    memcpy(stream + pos, data, length);
+    return pos + length;
+}
+
+int main(void) {
+    static const uint8_t statusPayload[] = {'1', '0'};
+    static const uint8_t monitorPayload[] = {'0', '0', '0', '1', '2', '3', '0', '0', '4', '5'};
+    static const uint8_t counterPayload[] = {'0', '0', '0', '0', '1', '2', '3', '4', '5', '6', '7'};
+    static const uint8_t endPayload[] = {'1', '0', '0', '0', '5', '0', '0', '0', '0', '5', '0', '0', '0',
+                                         '0', '1', '0', '0', '0', '1', '2', '3', '4'};
+    Frame status = makeFrame(1, 'S', statusPayload, sizeof(statusPayload));
+    Frame monitor = makeFrame(1, 'L', monitorPayload, sizeof(monitorPayload));
+    Frame counter = makeFrame(2, 'C', counterPayload, sizeof(counterPayload));
+    Frame end = makeFrame(1, 'T', endPayload, sizeof(endPayload));
+    if (status.length != STATUS_RESPONSE_LENGTH || monitor.length != MONITOR_RESPONSE_LENGTH ||
+        counter.length != TOTAL_COUNTER_RESPONSE_LENGTH || end.length != TRANSACTION_END_RESPONSE_LENGTH) {
+        fprintf(stderr, "framebench: reply lengths do not match config.h\n");
+        return 2;
+    }
+
+    FrameAssembler fa;
+    uint8_t stream[128];
+    int len;
+
+    // Кадр, разрезанный паузами на каждом байте, и кадр из двух участков
+    frameAssemblerReset(&fa);
+    outCount = 0;
+    len = append(stream, 0, status.data, status.length);
+    len = append(stream, len, monitor.data, monitor.length);
+    int splitChunks[STATUS_RESPONSE_LENGTH + 2];
+    for (int i = 0; i < STATUS_RESPONSE_LENGTH; i++) splitChunks[i] = 1;
+    splitChunks[STATUS_RESPONSE_LENGTH] = 6;
+    splitChunks[STATUS_RESPONSE_LENGTH + 1] = MONITOR_RESPONSE_LENGTH - 6;
+    feed(&fa, stream, splitChunks, STATUS_RESPONSE_LENGTH + 2);
+    Frame split[] = {status, monitor};
+    expect("split", &fa, split, 2, 0, 0);
+
+    // Три кадра разных постов в одном участке
+    frameAssemblerReset(&fa);
+    outCount = 0;
+    len = append(stream, 0, monitor.data, monitor.length);
+    len = append(stream, len, counter.data, counter.length);
+    len = append(stream, len, status.data, status.length);
+    int mergedChunks[] = {len};
+    feed(&fa, stream, mergedChunks, 1);
+    Frame merged[] = {monitor, counter, status};
+    expect("merged", &fa, merged, 3, 0, 0);
+
+    // Мусор перед кадром: шум, STX с неверным вторым байтом, STX с адресом вне 1..32
+    // и хвост прежнего кадра
+    static const uint8_t garbage[] = {0xFF, 0x13, 0x02, 0x05, 0x00, 0x02, 0x00, 0x40, '3', '4', 0x7A};
+    frameAssemblerReset(&fa);
+    outCount = 0;
+    len = append(stream, 0, garbage, sizeof(garbage));
+    len = append(stream, len, status.data, status.length);
+    int garbageChunks[] = {4, len - 4};
+    feed(&fa, stream, garbageChunks, 2);
+    Frame afterGarbage[] = {status};
+    expect("garbage prefix", &fa, afterGarbage, 1, sizeof(garbage), 0);
+
+    // Кадр с неверной CRC и за ним целый: битый кадр отбрасывается до следующего STX
+    Frame corrupt = status;
+    corrupt.data[4] ^= 0x01;
+    frameAssemblerReset(&fa);
+    outCount = 0;
+    len = append(stream, 0, corrupt.data, corrupt.length);
+    len = append(stream, len, status.data, status.length);
+    int corruptChunks[] = {len};
+    feed(&fa, stream, corruptChunks, 1);
+    Frame afterCorrupt[] = {status};
+    expect("CRC error", &fa, afterCorrupt, 1, STATUS_RESPONSE_LENGTH, 1);
+
+    // Ответ T переменной длины: пауза посреди кадра (CRC не сходится) его не закрывает,
+    // пауза после последнего байта - закрывает, следующий кадр собирается как обычно
+    frameAssemblerReset(&fa);
+    outCount = 0;
+    len = append(stream, 0, end.data, end.length);
+    len = append(stream, len, status.data, status.length);
+    int endChunks[] = {10, end.length - 10, status.length};
+    feed(&fa, stream, endChunks, 3);
+    Frame variable[] = {end, status};
+    expect("variable length T on IDLE", &fa, variable, 2, 0, 0);
+
+    printf("frames: %u failures\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,427 @@
+/* journalbench.c - Хостовая проверка журнала EEPROM (eeprom.c) при отключении питания
+ *
+ * eeprom.c включается целиком, шина I2C заменена заглушкой: EEPROM - массив в памяти.
+ * Для каждого сохранения цены или транзакции из сценария питание отключается после каждого
+ * байта записи (включая перенос отставших записей к голове журнала). После перезапуска
+ * (initEEPROM) снимок каждого рукава должен совпасть с состоянием до сохранения или после
+ * него, а повторное сохранение после перезапуска - пройти. Каждое сохранение здесь сразу
+ * сбрасывается в журнал (барьер EEPROM_ITEM_FLUSH). Сценарий проходит кольцо журнала
+ * больше двух раз. Затем - число чтений при запуске, износ страниц в сравнении с прежней
+ * раскладкой, где каждое сохранение перезаписывало одну и ту же страницу, и те же
+ * сохранения сериями со сбросом после каждой серии, как при отложенной записи.
+ * Переход журнала прежней прошивки (на всю EEPROM) в свой раздел проверяется отключением
+ * питания после каждого байта перехода, история продаж - отключением посреди каждой записи
+ * на протяжении больше оборота кольца и поиском каждой продажи по номеру, настройки
+ * (settings.c) - отключением питания после каждого байта их записи.
+ *
+ *   make journalbench && ./build/journalbench [сохранений]
+ */
+
+#include "config.h"
+#undef BUS_POST_COUNT
+#define BUS_POST_COUNT 4        // Четыре рукава: без этого отставших записей не бывает
+#include "../../Core/Src/eeprom.c"
+#include "../../Core/Src/settings.c"
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define PAGES (EEPROM_SIZE / EEPROM_PAGE_SIZE)
+
+static uint8_t image[EEPROM_SIZE];
+static long powerBudget = -1;   // Байт записи до отключения питания, -1 - не отключать
+static jmp_buf powerLost;
+static uint32_t reads;
+static uint32_t readBytes;
+static uint32_t pageWrites[PAGES];
+static uint32_t writeBytes;
+
+// Заглушки окружения eeprom.c
+HAL_StatusTypeDef i2cBusTransfer(const I2CTransaction* t, I2CBusPriority priority) {
+    (void)priority;
+    if (t->memAddress + t->length > EEPROM_SIZE) {
+        fprintf(stderr, "journalbench: access beyond EEPROM at %u\n", t->memAddress);
+        exit(2);
+    }
+    if (t->flags & I2C_FLAG_READ) {
+        memcpy(t->data, &image[t->memAddress], t->length);
+        reads++;
+        readBytes += t->length;
+        return HAL_OK;
+    }
+    // Отключение питания посреди записи: дописано только начало
+    if (powerBudget >= 0 && powerBudget < t->length) {
+        memcpy(&image[t->memAddress], t->data, powerBudget);
+        longjmp(powerLost, 1);
+    }
+    if (powerBudget >= 0) powerBudget -= t->length;
+    memcpy(&image[t->memAddress], t->data, t->length);
+    pageWrites[t->memAddress / EEPROM_PAGE_SIZE]++;
+    writeBytes += t->length;
+    return HAL_OK;
+}
+// Копии настроек читаются до запуска планировщика напрямую через HAL
+I2C_HandleTypeDef hi2c1;
+HAL_StatusTypeDef HAL_I2C_IsDeviceReady(I2C_HandleTypeDef* hi2c, uint16_t DevAddress, uint32_t Trials, uint32_t Timeout) {
+    (void)hi2c; (void)DevAddress; (void)Trials; (void)Timeout;
+    return HAL_OK;
+}
+HAL_StatusTypeDef HAL_I2C_Mem_Read(I2C_HandleTypeDef* hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t* pData, uint16_t Size, uint32_t Timeout) {
+    (void)hi2c; (void)DevAddress; (void)MemAddSize; (void)Timeout;
+    memcpy(pData, &image[MemAddress], Size);
+    return HAL_OK;
+}
+void logEvent(int level, LogMessageId id, const uint32_t* args, uint8_t count) {
+    (void)level; (void)id; (void)args; (void)count;
+}
+// Запрос в очереди выполняется сразу, как задачей EEPROM: запись с ожиданием (saveSettings)
+// завершается до возврата
+BaseType_t xQueueGenericSend(QueueHandle_t queue, const void* item, TickType_t ticks, const BaseType_t position) {
+    (void)queue; (void)ticks; (void)position;
+    handleEEPROMRequest((EEPROMRequest*)item);
+    return pdTRUE;
+}
+// Backup SRAM не участвует: проверяется только журнал
+bool backupRead(uint8_t slot, BackupTransaction* t) { (void)slot; (void)t; return false; }
+void backupWrite(uint8_t slot, const BackupTransaction* t) { (void)slot; (void)t; }
+// Остальные запросы выполняются прямо через handleEEPROMRequest
+TaskHandle_t xTaskGetCurrentTaskHandle(void) { return NULL; }
+TickType_t xTaskGetTickCount(void) { return 0; }
+// С V10.4 уведомления задач - массив, и у xTaskGenericNotify появился индекс
+#if tskKERNEL_VERSION_MAJOR > 10 || (tskKERNEL_VERSION_MAJOR == 10 && tskKERNEL_VERSION_MINOR >= 4)
+BaseType_t xTaskGenericNotify(TaskHandle_t task, UBaseType_t index, uint32_t value, eNotifyAction action, uint32_t* previous) {
+    (void)index;
+#else
+BaseType_t xTaskGenericNotify(TaskHandle_t task, uint32_t value, eNotifyAction action, uint32_t* previous) {
+#endif
+    (void)task; (void)value; (void)action; (void)previous;
+    return pdTRUE;
+}
+#if tskKERNEL_VERSION_MAJOR > 10 || (tskKERNEL_VERSION_MAJOR == 10 && tskKERNEL_VERSION_MINOR >= 4)
+BaseType_t xTaskGenericNotifyWait(UBaseType_t index, uint32_t clearOnEntry, uint32_t clearOnExit, uint32_t* value, TickType_t ticks) {
+    (void)index;
+#else
+BaseType_t xTaskNotifyWait(uint32_t clearOnEntry, uint32_t clearOnExit, uint32_t* value, TickType_t ticks) {
+#endif
+    (void)clearOnEntry; (void)clearOnExit; (void)value; (void)ticks;
+    return pdTRUE;
+}
+
+static JournalSlot model[FSM_CONTEXT_COUNT];
+
+static bool sameSlot(const JournalSlot* a, const JournalSlot* b) {
+    return a->liters == b->liters && a->priceTotal == b->priceTotal && a->price == b->price &&
+           a->state == b->state && a->mode == b->mode && a->modeSelected == b->modeSelected;
+}
+
+static void applyToModel(JournalSlot* slot, const EEPROMRequest* req) {
+    if (req->item == EEPROM_ITEM_PRICE) {
+        slot->price = req->data.price;
+    } else {
+        slot->liters = req->data.transaction.liters;
+        slot->priceTotal = req->data.transaction.price;
+        slot->state = req->data.transaction.state;
+        slot->mode = req->data.transaction.mode;
+        slot->modeSelected = req->data.transaction.modeSelected;
+    }
+}
+
+// Последний рукав сохраняется редко: его запись отстаёт от головы и переносится
+static EEPROMRequest makeRequest(unsigned n) {
+    uint8_t slot = (n % 100 == 0) ? FSM_CONTEXT_COUNT - 1 : (uint8_t)(rand() % (FSM_CONTEXT_COUNT - 1));
+    EEPROMRequest req = { .isWrite = true, .slot = slot };
+    if (rand() % 4 == 0) {
+        req.item = EEPROM_ITEM_PRICE;
+        req.data.price = (uint16_t)(rand() % 10000);
+    } else {
+        req.item = EEPROM_ITEM_TRANSACTION;
+        req.data.transaction.liters = n * 7;
+        req.data.transaction.price = n * 70;
+        req.data.transaction.state = (FSMState)(rand() % 10);
+        req.data.transaction.mode = (FuelMode)(rand() % 3);
+        req.data.transaction.modeSelected = rand() & 1;
+    }
+    return req;
+}
+
+static const EEPROMRequest flushRequest = { .isWrite = true, .item = EEPROM_ITEM_FLUSH };
+
+// Сохранение с барьером: снимок в памяти и сразу в журнал
+static void save(EEPROMRequest* req) {
+    handleEEPROMRequest(req);
+    handleEEPROMRequest((EEPROMRequest*)&flushRequest);
+}
+
+static uint32_t bootReads;
+
+static void reboot(void) {
+    uint32_t before = reads;
+    initEEPROM();
+    bootReads = reads - before;
+}
+
+// Рукава после перезапуска: slot может совпасть с before или after, остальные - с model
+static bool checkSlots(uint8_t slot, const JournalSlot* before, const JournalSlot* after) {
+    for (uint8_t i = 0; i < FSM_CONTEXT_COUNT; i++) {
+        if (i == slot) {
+            if (!sameSlot(&slots[i], after) && (before == NULL || !sameSlot(&slots[i], before))) return false;
+        } else if (!sameSlot(&slots[i], &model[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    unsigned saves = argc > 1 ? (unsigned)atoi(argv[1]) : 2 * JOURNAL_RECORDS + 500;
+    static uint8_t saved[EEPROM_SIZE];
+    // Переменные, изменяемые между setjmp и longjmp, - volatile: иначе после longjmp
+    // значения, оставшиеся в регистрах, могут быть прежними
+    volatile unsigned cuts = 0, failures = 0, torn = 0;
+    volatile uint32_t maxBootReads = 0;
+
+    srand(1);
+    memset(image, 0xFF, sizeof(image));
+    memset(model, 0xFF, sizeof(model));
+    reboot();
+
+    for (unsigned n = 1; n <= saves; n++) {
+        EEPROMRequest req = makeRequest(n);
+        JournalSlot after = model[req.slot];
+        applyToModel(&after, &req);
+        memcpy(saved, image, sizeof(saved));
+
+        for (volatile long cut = 0;; cut++) {
+            memcpy(image, saved, sizeof(image));
+            reboot();
+            volatile bool complete = false;
+            powerBudget = cut;
+            if (setjmp(powerLost) == 0) {
+                save(&req);
+                complete = true;
+            }
+            powerBudget = -1;
+            cuts++;
+
+            reboot();
+            if (bootReads > maxBootReads) maxBootReads = bootReads;
+            if (!checkSlots(req.slot, complete ? NULL : &model[req.slot], &after)) {
+                if (failures++ < 5) fprintf(stderr, "journalbench: save %u, power lost after %ld B: wrong state\n", n, cut);
+            }
+            if (complete) break;
+
+            // Сохранение после перезапуска пишет поверх недописанной записи
+            torn++;
+            save(&req);
+            reboot();
+            if (!checkSlots(req.slot, NULL, &after)) {
+                if (failures++ < 5) fprintf(stderr, "journalbench: save %u, retry after %ld B: wrong state\n", n, cut);
+            }
+        }
+
+        // Сценарий продолжается от полного сохранения
+        memcpy(image, saved, sizeof(image));
+        reboot();
+        save(&req);
+        model[req.slot] = after;
+    }
+    printf("power loss: %u saves, %u cut points (%u torn), %u failures\n", saves, cuts, torn, failures);
+    printf("journal: head %u seq %lu, %u records of %u B, window %u\n",
+           journal.head, (unsigned long)journal.headSeq, JOURNAL_RECORDS, JOURNAL_RECORD_SIZE, EEPROM_JOURNAL_WINDOW);
+
+    // Износ без отключений питания: сохранения по порядку на чистой EEPROM
+    memset(image, 0xFF, sizeof(image));
+    memset(pageWrites, 0, sizeof(pageWrites));
+    reboot();
+    srand(2);
+    for (unsigned n = 1; n <= saves; n++) {
+        EEPROMRequest req = makeRequest(n);
+        save(&req);
+    }
+    uint32_t writes = 0, maxWrites = 0;
+    for (unsigned page = 0; page < PAGES; page++) {
+        writes += pageWrites[page];
+        if (pageWrites[page] > maxWrites) maxWrites = pageWrites[page];
+    }
+    reads = readBytes = 0;
+    reboot();
+    printf("boot scan: %lu reads (%lu B), at most %lu during power loss test\n",
+           (unsigned long)reads, (unsigned long)readBytes, (unsigned long)maxBootReads);
+    printf("wear: %u saves -> %lu page writes (%lu carried), busiest page %lu writes; fixed layout: %u\n",
+           saves, (unsigned long)writes, (unsigned long)(writes - saves), (unsigned long)maxWrites, saves);
+
+    // Те же сохранения сериями по BURST, каждое второе повторяет предыдущее сохранение рукава
+    // (как пауза и конец транзакции или цена без изменений)
+    enum { BURST = 4 };
+    memset(image, 0xFF, sizeof(image));
+    reboot();
+    memset(&stats, 0, sizeof(stats));
+    srand(2);
+    for (unsigned n = 1; n <= saves; n++) {
+        EEPROMRequest req = makeRequest(n);
+        handleEEPROMRequest(&req);
+        handleEEPROMRequest(&req);
+        if (n % BURST == 0) handleEEPROMRequest((EEPROMRequest*)&flushRequest);
+    }
+    printf("write-back: %lu saves (%lu unchanged) in bursts of %d -> %lu records in %lu page writes\n",
+           (unsigned long)stats.writes, (unsigned long)stats.unchanged, BURST * 2,
+           (unsigned long)stats.records, (unsigned long)stats.pageWrites);
+
+    // Перенос прежней раскладки: цена и транзакция по фиксированным адресам рукава
+    memset(image, 0xFF, sizeof(image));
+    for (uint8_t slot = 0; slot < FSM_CONTEXT_COUNT; slot++) {
+        uint8_t* legacy = &image[slot * EEPROM_LEGACY_SLOT_SIZE];
+        JournalSlot* expected = &model[slot];
+        memset(expected, 0xFF, sizeof(*expected));
+        expected->price = 1000 + slot;
+        expected->liters = 500 + slot;
+        expected->priceTotal = 5000 + slot;
+        expected->state = slot;
+        expected->mode = FUEL_BY_PRICE;
+        expected->modeSelected = 1;
+        legacy[0] = expected->price & 0xFF;
+        legacy[1] = expected->price >> 8;
+        putU32(legacy + EEPROM_LEGACY_TRANSACTION_ADDR, expected->liters);
+        putU32(legacy + EEPROM_LEGACY_TRANSACTION_ADDR + 4, expected->priceTotal);
+        legacy[EEPROM_LEGACY_TRANSACTION_ADDR + 8] = expected->state;
+        legacy[EEPROM_LEGACY_TRANSACTION_ADDR + 9] = expected->mode;
+        legacy[EEPROM_LEGACY_TRANSACTION_ADDR + 10] = expected->modeSelected;
+    }
+    reboot();
+    reboot();
+    volatile bool imported = checkSlots(0, NULL, &model[0]) && journal.headSeq == FSM_CONTEXT_COUNT;
+    printf("fixed layout import: %s\n", imported ? "ok" : "FAILED");
+
+    // Журнал прежней прошивки на всю EEPROM, голова дальше позиций, общих с новым кольцом,
+    // страницы раскладки нет (её место занято записью журнала)
+    memset(image, 0xFF, sizeof(image));
+    memset(model, 0xFF, sizeof(model));
+    reboot();
+    journal.records = JOURNAL_RECORDS_UNPARTITIONED;
+    partitioned = false;
+    srand(3);
+    for (unsigned n = 1; n <= JOURNAL_RECORDS + 200; n++) {
+        EEPROMRequest req = makeRequest(n);
+        save(&req);
+        applyToModel(&model[req.slot], &req);
+    }
+    uint16_t oldHead = journal.head;
+    volatile unsigned moveCuts = 0, moveFailures = readLayout() != 0;
+    memcpy(saved, image, sizeof(saved));
+    for (volatile long cut = 0;; cut++) {
+        memcpy(image, saved, sizeof(image));
+        volatile bool complete = false;
+        writeBytes = 0;
+        powerBudget = cut;
+        if (setjmp(powerLost) == 0) {
+            reboot();
+            complete = true;
+        }
+        powerBudget = -1;
+        moveCuts++;
+        reboot();
+        if (!partitioned || !checkSlots(0, NULL, &model[0])) {
+            if (moveFailures++ < 5) fprintf(stderr, "journalbench: partition, power lost after %ld B: wrong state\n", cut);
+        }
+        if (complete) break;
+    }
+    uint32_t moveBytes = writeBytes;
+    EEPROMRequest after = makeRequest(1);
+    save(&after);
+    applyToModel(&model[after.slot], &after);
+    reboot();
+    if (!checkSlots(0, NULL, &model[0])) moveFailures++;
+    printf("partition: journal head %u of %u records -> %u records, %lu B carried, %u cut points, %u failures\n",
+           oldHead, JOURNAL_RECORDS_UNPARTITIONED, JOURNAL_RECORDS, (unsigned long)moveBytes, moveCuts, moveFailures);
+
+    // История: продаж больше, чем записей в кольце; каждая запись прерывается отключением
+    // питания. После перезапуска последней должна быть прежняя продажа (тогда запись
+    // повторяется) или новая: запись, оборванная на копии номера, совпадающей с прежней, цела
+    memset(image, 0xFF, sizeof(image));
+    reboot();
+    srand(4);
+    unsigned sales = HISTORY_RECORDS + 100;
+    volatile unsigned historyFailures = 0, historyTorn = 0;
+    for (volatile unsigned n = 1; n <= sales; n++) {
+        EEPROMRequest req = {
+            .isWrite = true,
+            .item = EEPROM_ITEM_HISTORY,
+            .data.history = { .timeMs = n * 1000, .preset = n, .liters = n * 3, .amount = n * 30,
+                              .price = (uint16_t)n, .slot = (uint8_t)(n % FSM_CONTEXT_COUNT), .mode = (uint8_t)(n % 3) }
+        };
+        powerBudget = rand() % JOURNAL_RECORD_SIZE;
+        if (setjmp(powerLost) == 0) {
+            handleEEPROMRequest(&req);
+        }
+        powerBudget = -1;
+        reboot();
+        if (history.headSeq == n - 1) {
+            historyTorn++;
+            handleEEPROMRequest(&req);
+            reboot();
+        }
+        if (history.headSeq != n) {
+            if (historyFailures++ < 5) fprintf(stderr, "journalbench: sale %u, last after restart %lu\n", n, (unsigned long)history.headSeq);
+        }
+    }
+    // Последние продажи по отступу, затем по номеру: каждая - одно чтение
+    uint32_t before = reads;
+    for (unsigned back = 0; back < HISTORY_RECORDS; back++) {
+        HistoryRecord sale = {0};
+        uint32_t n = sales - back;
+        EEPROMRequest req = { .item = EEPROM_ITEM_HISTORY_RECENT, .data.historySeq = back, .historyOut = &sale };
+        handleEEPROMRequest(&req);
+        if (sale.seq != n || sale.liters != n * 3 || sale.amount != n * 30 || sale.preset != n || sale.mode != n % 3) {
+            if (historyFailures++ < 5) fprintf(stderr, "journalbench: sale %lu back %u: wrong record\n", (unsigned long)n, back);
+        }
+        req.item = EEPROM_ITEM_HISTORY;
+        req.data.historySeq = n;
+        sale.seq = 0;
+        handleEEPROMRequest(&req);
+        if (sale.seq != n && historyFailures++ < 5) fprintf(stderr, "journalbench: sale %lu not found\n", (unsigned long)n);
+    }
+    double lookupReads = (double)(reads - before) / (2 * HISTORY_RECORDS);
+    HistoryRecord gone;
+    if (readHistoryRecord(sales - HISTORY_RECORDS, &gone) == HAL_OK || readHistoryRecord(sales + 1, &gone) == HAL_OK) {
+        historyFailures++;
+    }
+    printf("history: %u sales in %u records, power lost in each (%u torn), %u failures; %.1f reads per lookup\n",
+           sales, HISTORY_RECORDS, historyTorn, historyFailures, lookupReads);
+
+    // Настройки: каждое сохранение прерывается после каждого байта записи. После перезапуска
+    // действуют прежние настройки или новые, и следующее сохранение пишется в другую копию
+    enum { SETTINGS_SAVES = 40 };
+    volatile unsigned settingsCuts = 0, settingsFailures = 0;
+    initSettings();
+    Settings current = *settings;
+    for (volatile unsigned n = 1; n <= SETTINGS_SAVES; n++) {
+        Settings next = current;
+        next.responseTimeout = (uint16_t)(1000 + n * 10);
+        next.delayAfterResponse = (uint8_t)(n % 10);
+        next.maxErrorCount = (uint8_t)(1 + n % 9);
+        next.keyScanMs = (uint8_t)(10 + n % 20);
+        for (volatile long budget = 0; ; budget++) {
+            volatile bool complete = false;
+            powerBudget = budget;
+            if (setjmp(powerLost) == 0) {
+                complete = saveSettings(&next);
+            }
+            powerBudget = -1;
+            reboot();
+            initSettings();
+            settingsCuts++;
+            bool isOld = memcmp(settings, &current, sizeof(Settings)) == 0;
+            bool isNew = memcmp(settings, &next, sizeof(Settings)) == 0;
+            if (complete ? !isNew : !(isOld || isNew)) {
+                if (settingsFailures++ < 5) fprintf(stderr, "journalbench: settings %u, cut at %ld: wrong settings\n", n, budget);
+            }
+            if (complete || isNew) break;
+        }
+        current = next;
+    }
+    Settings invalid = current;
+    invalid.postAddress = 0;
+    if (saveSettings(&invalid)) settingsFailures++;
+    printf("settings: %u saves, %u cut points, %u failures\n", SETTINGS_SAVES, settingsCuts, settingsFailures);
+    return (failures || !imported || moveFailures || historyFailures || settingsFailures) ? 1 : 0;
+}
@@ -0,0 +1,161 @@
+/* oledbench.c - Хостовый замер вывода символов в буфер SSD1306 (oled.c)
+ *
+ * oled.c включается целиком, чтобы замерять его статические функции без изменений; задачи,
+ * очереди и шина I2C не нужны, поэтому функции FreeRTOS и HAL заменены заглушками.
+ * Прежний вывод по одному пикселю (35 операций чтения-изменения-записи на символ)
+ * оставлен здесь как эталон: сначала сравнивается содержимое буфера после обоих способов
+ * для всех символов и всех y, затем время.
+ *
+ *   make oledbench && ./build/oledbench [итераций]
+ */
+
+#include "../../Core/Src/oled.c"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Заглушки окружения oled.c
+TaskHandle_t oledTaskHandle;
+uint32_t SystemCoreClock = 168000000;
+QueueHandle_t oledStateMailbox;
+QueueHandle_t oledAlertQueue;
+QueueHandle_t i2cLowQueue;
+
+uint32_t getCycleCount(void) { return 0; }
+TickType_t xTaskGetTickCount(void) { return 0; }
+void vTaskDelay(const TickType_t ticks) { (void)ticks; }
+BaseType_t xQueueGenericSend(QueueHandle_t queue, const void* item, TickType_t ticks, const BaseType_t position) {
+    (void)queue; (void)item; (void)ticks; (void)position;
+    return pdTRUE;
+}
+UBaseType_t uxQueueMessagesWaiting(const QueueHandle_t queue) { (void)queue; return 0; }
+UBaseType_t uxQueueSpacesAvailable(const QueueHandle_t queue) { (void)queue; return I2C_BUS_LOW_QUEUE_LENGTH; }
+// С V10.4 уведомления задач - массив, и у xTaskGenericNotify появился индекс
+#if tskKERNEL_VERSION_MAJOR > 10 || (tskKERNEL_VERSION_MAJOR == 10 && tskKERNEL_VERSION_MINOR >= 4)
+BaseType_t xTaskGenericNotify(TaskHandle_t task, UBaseType_t index, uint32_t value, eNotifyAction action, uint32_t* previous) {
+    (void)index;
+#else
+BaseType_t xTaskGenericNotify(TaskHandle_t task, uint32_t value, eNotifyAction action, uint32_t* previous) {
+#endif
+    (void)task; (void)value; (void)action; (void)previous;
+    return pdTRUE;
+}
+void vPortYield(void) {}
+// Задача шины: участки кадра сразу считаются переданными
+bool i2cBusSubmit(const I2CTransaction* t, I2CBusPriority priority) {
+    (void)priority;
+    if (t->done != NULL) t->done(t, HAL_OK);
+    return true;
+}
+
+// Прежний ssd1306_WriteChar: каждый из 7 пикселей 6 столбцов отдельно, с делением и остатком
+static void oldWriteChar(char ch) {
+    if (CurrentX + 6 > SSD1306_WIDTH || CurrentY + 7 > SSD1306_HEIGHT) return;
+    if (ch < 32 || ch > 126) ch = '?';
+    const uint8_t* glyph = &Font5x7[(ch - 32) * 5];
+
+    for (uint8_t col = 0; col < 6; col++) {
+        uint8_t line = (col < 5) ? glyph[col] : 0x00;
+        for (uint8_t row = 0; row < 7; row++) {
+            uint8_t page = (CurrentY + row) / 8;
+            uint8_t bit = 1 << ((CurrentY + row) % 8);
+            uint8_t value = Buffer[SSD1306_WIDTH * page + CurrentX];
+
+            if (line & 0x01)
+                value |= bit;
+            else
+                value &= ~bit;
+            putByte(page, CurrentX, value);
+            line >>= 1;
+        }
+        CurrentX++;
+    }
+}
+
+static void newWriteChar(char ch) {
+    ssd1306_WriteChar(ch, SSD1306_COLOR_WHITE);
+}
+
+static void newWriteBigChar(char ch) {
+    ssd1306_WriteBigChar(ch, SSD1306_COLOR_WHITE);
+}
+
+// Случайный фон: биты вокруг глифа должны сохраниться
+static void fillNoise(unsigned seed) {
+    srand(seed);
+    for (size_t i = 0; i < sizeof(Buffer); i++) {
+        Buffer[i] = (uint8_t)rand();
+    }
+}
+
+static int checkSame(void) {
+    static uint8_t expected[SSD1306_WIDTH * SSD1306_HEIGHT / 8];
+    int mismatches = 0;
+    for (int ch = 31; ch <= 127; ch++) {
+        for (uint8_t y = 0; y + 7 <= SSD1306_HEIGHT; y++) {
+            fillNoise(ch * 64 + y);
+            ssd1306_SetCursor(3, y);
+            oldWriteChar((char)ch);
+            memcpy(expected, Buffer, sizeof(expected));
+            fillNoise(ch * 64 + y);
+            ssd1306_SetCursor(3, y);
+            newWriteChar((char)ch);
+            if (memcmp(expected, Buffer, sizeof(expected)) != 0) {
+                if (mismatches++ < 5) fprintf(stderr, "oledbench: char %d at y %u differs\n", ch, y);
+            }
+        }
+    }
+    return mismatches;
+}
+
+static double nowNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Строки чередуются, чтобы байты буфера действительно менялись (putByte пропускает равные)
+static double timeLine(void (*writeChar)(char), uint8_t y, uint8_t width, long iterations) {
+    static const char* lines[2] = { "Dispensing... 0123456", "Paused  L: 9876.54 P:" };
+    long chars = 0;
+    double start = nowNs();
+    for (long i = 0; i < iterations; i++) {
+        const char* text = lines[i & 1];
+        ssd1306_SetCursor(0, y);
+        for (uint8_t n = 0; text[n] != '\0' && (n + 1) * width <= SSD1306_WIDTH; n++) {
+            writeChar(text[n]);
+            chars++;
+        }
+        dirtyPages = 0;
+    }
+    return (nowNs() - start) / chars;
+}
+
+int main(int argc, char** argv) {
+    long iterations = argc > 1 ? atol(argv[1]) : 200000;
+
+    int mismatches = checkSame();
+    printf("identical output: %s (%d mismatches, chars 31..127 at y 0..57)\n", mismatches ? "NO" : "yes", mismatches);
+
+    double oldAligned = timeLine(oldWriteChar, 8, 6, iterations);
+    double newAligned = timeLine(newWriteChar, 8, 6, iterations);
+    double oldShifted = timeLine(oldWriteChar, 11, 6, iterations);
+    double newShifted = timeLine(newWriteChar, 11, 6, iterations);
+    double big = timeLine(newWriteBigChar, 16, OLED_BIG_CHAR_WIDTH, iterations);
+    printf("page-aligned y:  old %6.1f ns/char, new %6.1f ns/char (%.1fx)\n", oldAligned, newAligned, oldAligned / newAligned);
+    printf("unaligned y:     old %6.1f ns/char, new %6.1f ns/char (%.1fx)\n", oldShifted, newShifted, oldShifted / newShifted);
+    printf("2x digits:       new %6.1f ns/char (12x16 cell)\n", big);
+
+    // Обновление экрана налива: меняются объём и сумма
+    DisplayState state = { .screen = DISPLAY_SCREEN_TRANSACTION, .status = DISPLAY_STATUS_DISPENSING, .price = 1000 };
+    renderState(&state);
+    double start = nowNs();
+    for (long i = 0; i < iterations; i++) {
+        state.liters_dL = (uint32_t)i;
+        state.amount = (uint32_t)i * 10;
+        renderState(&state);
+        dirtyPages = 0;
+    }
+    printf("dispensing update (liters and amount): %.1f ns\n", (nowNs() - start) / iterations);
+    return mismatches ? 1 : 0;
+}
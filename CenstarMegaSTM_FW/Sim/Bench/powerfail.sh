@@ -0,0 +1,116 @@
+#!/bin/sh
+# powerfail.sh - Отказ питания в случайный момент отпуска топлива: эмулятор прошивки и pumpsim
+#
+# В каждом прогоне сценарий клавиатуры начинает отпуск 5 л, в случайный момент питание пропадает
+# (SIM_POWER_FAIL_MS: прерывание PVD сохраняет транзакцию в backup SRAM), и прошивка запускается
+# снова, уже без клавиатуры. pumpsim работает всё время, как ТРК со своим питанием.
+# Если питание пропало во время отпуска, после перезапуска транзакция должна быть восстановлена
+# из backup SRAM (её поколение новее журнала EEPROM) и завершена с итогом ответа T, равным дозе
+# pumpsim. Прогоны, где отпуск ещё не начался или уже завершился, только подсчитываются.
+#
+#   make powerfail FREERTOS_KERNEL=... [POWERFAIL_RUNS=N]
+#   Bench/powerfail.sh [прогонов] [seed] [первый прогон]     (из каталога Sim после make all)
+
+RUNS=${1:-10}
+SEED=${2:-1}
+START=${3:-1}
+BUILD=$(cd "$(dirname "$0")/.." && pwd)/build
+KEYS=$(cd "$(dirname "$0")/.." && pwd)/Pump/transactions.keys
+FAIL_FROM=8000                  # Окно отказа питания (мс): отпуск по сценарию - около 9..12 с
+FAIL_TO=14000
+RESTART_MS=15000                # Работа после перезапуска: хватает на окончание отпуска и ответ T
+
+WORK=$(mktemp -d /tmp/powerfail.XXXXXX)
+trap 'rm -rf "$WORK"' EXIT
+
+inflight=0
+passed=0
+before=0
+after=0
+failed=0
+
+# Момент отказа питания для прогона $1
+cutTime() {
+    awk -v seed="$SEED" -v run="$1" -v from=$FAIL_FROM -v to=$FAIL_TO \
+        'BEGIN { srand(seed * 1000 + run); print int(from + rand() * (to - from)) }'
+}
+
+# Запуск эмулятора прошивки: $1 - имя для лога, дальше команда
+runSim() {
+    name=$1
+    shift
+    SIM_RS422_LINK="$WORK/pty" SIM_EEPROM="$WORK/eeprom.bin" SIM_BKPSRAM="$WORK/bkpsram.bin" \
+        SIM_OLED="$WORK/oled.pbm" SIM_LOG="$WORK/$name.log" "$@" 2> "$WORK/$name.err"
+}
+
+run=$START
+while [ $run -le $((START + RUNS - 1)) ]; do
+    cut=$(cutTime $run)
+    rm -f "$WORK"/*
+    limit=$(( (cut + 1000) / 1000 + 10 ))
+    runSim fw1 env SIM_KEYS="$KEYS" SIM_POWER_FAIL_MS=$cut SIM_RUN_MS=$((cut + 1000)) \
+        timeout $limit "$BUILD/censtar-sim" &
+    fw1=$!
+    sleep 0.5
+    timeout $(( (cut + RESTART_MS) / 1000 + 10 )) "$BUILD/pumpsim" -f 120 -t $(( (cut + RESTART_MS) / 1000 + 5 )) \
+        "$WORK/pty" 2> "$WORK/pump.err" &
+    pump=$!
+
+    # Отказ питания в первом запуске ждём не дольше его ограничения по времени и пока он жив:
+    # первый запуск, который завершился или завис без отказа питания, - неудачный прогон
+    polls=$((limit * 5))
+    while ! grep -q "power fail\|keys pressed" "$WORK/fw1.err" 2> /dev/null &&
+          [ $polls -gt 0 ] && kill -0 $fw1 2> /dev/null; do
+        polls=$((polls - 1))
+        sleep 0.2
+    done
+    if ! grep -q "power fail\|keys pressed" "$WORK/fw1.err" 2> /dev/null; then
+        kill $fw1 $pump 2> /dev/null
+        wait $fw1 $pump 2> /dev/null
+        failed=$((failed + 1))
+        cp "$WORK/fw1.err" "/tmp/powerfail-$run-fw1err.txt" 2> /dev/null
+        echo "run $run: power fail at $cut ms, FAILED: first start exited or hung without power fail"
+        run=$((run + 1))
+        continue
+    fi
+    wait $fw1 2> /dev/null
+    sleep 0.3
+    runSim fw2 env SIM_RUN_MS=$RESTART_MS timeout $((RESTART_MS / 1000 + 10)) "$BUILD/censtar-sim"
+    kill $pump 2> /dev/null
+    wait $pump 2> /dev/null
+
+    "$BUILD/logdecode" < "$WORK/fw1.log" > "$WORK/fw1.txt" 2> /dev/null
+    "$BUILD/logdecode" < "$WORK/fw2.log" > "$WORK/fw2.txt" 2> /dev/null
+    dose=$(sed -n 's/.*done: \([0-9]*\) cl, amount \([0-9]*\).*/\1 \2/p' "$WORK/pump.err" | head -1)
+    restore=$(sed -n 's/.*Slot 0 restore: backup SRAM gen \([0-9]*\), EEPROM gen \([0-9]*\).*/\1 \2/p' "$WORK/fw2.txt")
+    ended=$(sed -n 's/.*Transaction end: Liters=\([0-9]*\), Price=\([0-9]*\).*/\1 \2/p' "$WORK/fw2.txt" | head -1)
+    reconciled=$(sed -n 's/.*Restored transaction \([0-9]*\) \/ [0-9]*, pump T.*/\1/p' "$WORK/fw2.txt" | head -1)
+
+    if ! grep -q "Transaction started" "$WORK/fw1.txt"; then
+        before=$((before + 1))
+        result="before dispensing"
+    elif grep -q "Transaction end:" "$WORK/fw1.txt"; then
+        after=$((after + 1))
+        result="after transaction end"
+    else
+        inflight=$((inflight + 1))
+        set -- $restore
+        if [ $# -eq 2 ] && [ "$1" -gt "$2" ] && [ -n "$ended" ] && [ "$ended" = "$dose" ] &&
+           [ -n "$reconciled" ] && [ "$reconciled" -le "${dose%% *}" ]; then
+            passed=$((passed + 1))
+            result="restored gen $1 (EEPROM $2), snapshot $reconciled, T $ended"
+        else
+            failed=$((failed + 1))
+            result="FAILED: restore '$restore', end '$ended', pump '$dose', snapshot '$reconciled'"
+            cp "$WORK/fw1.txt" "/tmp/powerfail-$run-fw1.txt"
+            cp "$WORK/fw2.txt" "/tmp/powerfail-$run-fw2.txt"
+            cp "$WORK/pump.err" "/tmp/powerfail-$run-pump.txt"
+            cp "$WORK/fw2.err" "/tmp/powerfail-$run-fw2err.txt"
+        fi
+    fi
+    echo "run $run: power fail at $cut ms, $result"
+    run=$((run + 1))
+done
+
+echo "power fail: $RUNS runs, $inflight during dispensing ($passed restored, $failed failed), $before before, $after after"
+[ $failed -eq 0 ]
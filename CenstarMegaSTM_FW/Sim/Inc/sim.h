@@ -0,0 +1,65 @@
+/* sim.h - Эмулятор периферии для хостовой сборки прошивки (Sim/)
+ *
+ * Прошивка (main.c, fsm.c, rs422.c, eeprom.c, oled.c, keypad.c ...) собирается без изменений
+ * и работает на порте FreeRTOS POSIX. Прерывания UART/DMA эмулирует задача с наивысшим
+ * приоритетом: она раз в тик опрашивает устройства и вызывает те же callback-функции HAL.
+ *
+ * Настройка через переменные окружения:
+ *   SIM_RS422         устройство UART2 (например, /dev/ttyUSB0 с преобразователем RS-422).
+ *                     Если не задано, создаётся pty, имя подчинённой стороны выводится в stderr
+ *   SIM_RS422_LINK    символьная ссылка на подчинённую сторону pty (по умолчанию /tmp/censtar-rs422)
+ *   SIM_LOG           файл для лога UART3 (по умолчанию stdout)
+ *   SIM_UART_INSTANT  1 - не эмулировать время передачи байтов на заданной скорости UART
+ *   SIM_UART_TX_FAULT N - каждая N-я передача UART2 через DMA не проходит: поочерёдно
+ *                     HAL_UART_Transmit_DMA возвращает HAL_ERROR или передача обрывается ошибкой DMA
+ *   SIM_EEPROM        файл образа EEPROM 24C256 (по умолчанию eeprom.bin, новый заполняется 0xFF)
+ *   SIM_EEPROM_WRITE_MS  время цикла записи EEPROM, в течение которого микросхема не отвечает (5)
+ *   SIM_BKPSRAM       файл backup SRAM (по умолчанию bkpsram.bin), сохраняется между запусками
+ *   SIM_VBAT          0 - батарея VBAT снята: backup SRAM при запуске заполнена случайными байтами
+ *   SIM_POWER_FAIL_MS отказ питания через заданное время (мс): прерывание PVD, затем эмуляция
+ *                     завершается без остановки задач, как при сбросе по снижению напряжения
+ *   SIM_OLED          PBM-файл с изображением SSD1306 (по умолчанию oled.pbm)
+ *   SIM_KEYS          файл сценария клавиатуры, строки "<пауза мс> <клавиши>", '#' - комментарий
+ *   SIM_KEYS_GAP      пауза между клавишами одной строки сценария (мс, по умолчанию 150)
+ *   SIM_KEYS_LOOP     1 - повторять сценарий по кругу (нагрузочный прогон)
+ *   SIM_RUN_MS        завершить эмуляцию через заданное время (мс), 0 - без ограничения
+ */
+
+#ifndef SIM_H
+#define SIM_H
+
+#include "stm32f4xx_hal.h"
+#include <stdbool.h>
+
+// Значение переменной окружения или def
+const char* simEnv(const char* name, const char* def);
+uint32_t simEnvU32(const char* name, uint32_t def);
+
+// Ожидание с занятым процессором: так блокирующие функции HAL тратят время передачи по шине
+void simBusyWaitUs(uint32_t us);
+
+// Вызовы libc с внутренними блокировками (stdio, файлы) выполняются между simIoBegin и simIoEnd:
+// сигнал тика порта POSIX не должен переключить задачу, пока она держит блокировку libc
+void simIoBegin(void);
+void simIoEnd(void);
+
+// UART: открытие устройств и опрос из задачи прерываний
+void simUartInit(void);
+void simUartPoll(uint32_t now);
+void simUartReport(void);
+
+// I2C: EEPROM в файле и SSD1306 с выводом в PBM
+void simI2CInit(void);
+void simI2CPoll(uint32_t now);
+void simI2CReport(void);
+
+// Питание: backup SRAM и отказ питания (PVD)
+void simPowerInit(void);
+void simPowerPoll(uint32_t now);
+
+// Клавиатура по сценарию
+void simKeypadInit(void);
+GPIO_PinState simKeypadRead(GPIO_TypeDef* port, uint16_t pin);
+uint32_t simKeypadPressed(void);
+
+#endif /* SIM_H */
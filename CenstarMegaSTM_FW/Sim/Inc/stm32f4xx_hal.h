@@ -0,0 +1,424 @@
+/* stm32f4xx_hal.h - Замена HAL STM32F4 для хостовой сборки (Sim/)
+ * Объявляет только то, что использует прошивка. Реализация - Sim/Src/sim_*.c
+ */
+
+#ifndef STM32F4XX_HAL_SIM_H
+#define STM32F4XX_HAL_SIM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define SIM_HOST 1
+
+typedef enum {
+    HAL_OK = 0x00,
+    HAL_ERROR = 0x01,
+    HAL_BUSY = 0x02,
+    HAL_TIMEOUT = 0x03
+} HAL_StatusTypeDef;
+
+#define HAL_MAX_DELAY 0xFFFFFFFFU
+
+extern uint32_t SystemCoreClock;
+
+// Ядро: прерывания эмулируются задачей FreeRTOS, глобального запрета нет
+#define __disable_irq() ((void)0)
+#define __enable_irq() ((void)0)
+#define __get_PRIMASK() 0U
+#define __set_PRIMASK(primask) ((void)(primask))
+#define __NOP() ((void)0)
+
+typedef enum {
+    DMA1_Stream0_IRQn = 11,
+    DMA1_Stream1_IRQn = 12,
+    DMA1_Stream3_IRQn = 14,
+    DMA1_Stream5_IRQn = 16,
+    DMA1_Stream6_IRQn = 17,
+    I2C1_EV_IRQn = 31,
+    I2C1_ER_IRQn = 32,
+    TIM2_IRQn = 28,
+    USART2_IRQn = 38,
+    USART3_IRQn = 39,
+    DMA1_Stream7_IRQn = 47,
+    PVD_IRQn = 1
+} IRQn_Type;
+
+// Счётчик тактов DWT: CYCCNT пересчитывается из монотонного времени хоста
+// с частотой SystemCoreClock при каждом обращении к DWT
+typedef struct {
+    volatile uint32_t CTRL;
+    volatile uint32_t CYCCNT;
+} DWT_Type;
+
+typedef struct {
+    volatile uint32_t DEMCR;
+} CoreDebug_Type;
+
+DWT_Type* simDWT(void);
+extern CoreDebug_Type simCoreDebug;
+#define DWT (simDWT())
+#define CoreDebug (&simCoreDebug)
+#define CoreDebug_DEMCR_TRCENA_Msk (1UL << 24)
+#define DWT_CTRL_CYCCNTENA_Msk (1UL << 0)
+
+// Экземпляры периферии: адреса как у STM32F407, эмулятор их не разыменовывает
+typedef struct { uint32_t reserved; } USART_TypeDef;
+typedef struct { uint32_t reserved; } I2C_TypeDef;
+typedef struct { uint32_t reserved; } TIM_TypeDef;
+typedef struct { uint32_t reserved; } IWDG_TypeDef;
+typedef struct { uint32_t reserved; } DMA_Stream_TypeDef;
+
+#define USART2 ((USART_TypeDef*)0x40004400UL)
+#define USART3 ((USART_TypeDef*)0x40004800UL)
+#define I2C1 ((I2C_TypeDef*)0x40005400UL)
+#define TIM2 ((TIM_TypeDef*)0x40000000UL)
+#define TIM3 ((TIM_TypeDef*)0x40000400UL)
+#define IWDG ((IWDG_TypeDef*)0x40003000UL)
+#define DMA1_Stream1 ((DMA_Stream_TypeDef*)0x40026028UL)
+#define DMA1_Stream3 ((DMA_Stream_TypeDef*)0x40026058UL)
+#define DMA1_Stream5 ((DMA_Stream_TypeDef*)0x40026088UL)
+#define DMA1_Stream6 ((DMA_Stream_TypeDef*)0x400260A0UL)
+#define DMA1_Stream7 ((DMA_Stream_TypeDef*)0x400260B8UL)
+
+// RCC, PWR, FLASH: настройка тактирования на хосте ничего не делает
+typedef struct {
+    uint32_t PLLState;
+    uint32_t PLLSource;
+    uint32_t PLLM;
+    uint32_t PLLN;
+    uint32_t PLLP;
+    uint32_t PLLQ;
+} RCC_PLLInitTypeDef;
+
+typedef struct {
+    uint32_t OscillatorType;
+    uint32_t HSEState;
+    uint32_t LSEState;
+    uint32_t HSIState;
+    uint32_t HSICalibrationValue;
+    uint32_t LSIState;
+    RCC_PLLInitTypeDef PLL;
+} RCC_OscInitTypeDef;
+
+typedef struct {
+    uint32_t ClockType;
+    uint32_t SYSCLKSource;
+    uint32_t AHBCLKDivider;
+    uint32_t APB1CLKDivider;
+    uint32_t APB2CLKDivider;
+} RCC_ClkInitTypeDef;
+
+#define RCC_OSCILLATORTYPE_HSE 0x01U
+#define RCC_OSCILLATORTYPE_LSI 0x08U
+#define RCC_HSE_ON 0x01U
+#define RCC_LSI_ON 0x01U
+#define RCC_PLL_ON 0x02U
+#define RCC_PLLSOURCE_HSE 0x01U
+#define RCC_PLLP_DIV2 0x02U
+#define RCC_CLOCKTYPE_SYSCLK 0x01U
+#define RCC_CLOCKTYPE_HCLK 0x02U
+#define RCC_CLOCKTYPE_PCLK1 0x04U
+#define RCC_CLOCKTYPE_PCLK2 0x08U
+#define RCC_SYSCLKSOURCE_PLLCLK 0x02U
+#define RCC_SYSCLK_DIV1 0x00U
+#define RCC_HCLK_DIV2 0x04U
+#define RCC_HCLK_DIV4 0x05U
+#define FLASH_LATENCY_5 0x05U
+#define PWR_REGULATOR_VOLTAGE_SCALE1 0x01U
+
+#define __HAL_RCC_PWR_CLK_ENABLE() ((void)0)
+#define __HAL_RCC_SYSCFG_CLK_ENABLE() ((void)0)
+#define __HAL_RCC_GPIOA_CLK_ENABLE() ((void)0)
+#define __HAL_RCC_GPIOB_CLK_ENABLE() ((void)0)
+#define __HAL_RCC_GPIOC_CLK_ENABLE() ((void)0)
+#define __HAL_RCC_GPIOD_CLK_ENABLE() ((void)0)
+#define __HAL_RCC_GPIOE_CLK_ENABLE() ((void)0)
+#define __HAL_RCC_GPIOH_CLK_ENABLE() ((void)0)
+#define __HAL_RCC_DMA1_CLK_ENABLE() ((void)0)
+#define __HAL_RCC_I2C1_CLK_ENABLE() ((void)0)
+#define __HAL_RCC_USART2_CLK_ENABLE() ((void)0)
+#define __HAL_RCC_USART3_CLK_ENABLE() ((void)0)
+#define __HAL_RCC_TIM2_CLK_ENABLE() ((void)0)
+#define __HAL_RCC_I2C1_CLK_DISABLE() ((void)0)
+#define __HAL_RCC_USART2_CLK_DISABLE() ((void)0)
+#define __HAL_RCC_USART3_CLK_DISABLE() ((void)0)
+#define __HAL_PWR_VOLTAGESCALING_CONFIG(x) ((void)(x))
+#define __HAL_RCC_BKPSRAM_CLK_ENABLE() ((void)0)
+
+// Backup SRAM: память эмулятора вместо адреса 0x40024000 (Sim/Src/sim_pwr.c)
+void* simBackupSram(void);
+#define BKPSRAM_BASE ((uintptr_t)simBackupSram())
+
+// PVD: отказ питания задаёт SIM_POWER_FAIL_MS (Sim/Src/sim_pwr.c)
+typedef struct {
+    uint32_t PVDLevel;
+    uint32_t Mode;
+} PWR_PVDTypeDef;
+
+#define PWR_PVDLEVEL_7 0xE0U
+#define PWR_PVD_MODE_IT_RISING 0x10001U
+
+// GPIO
+typedef struct {
+    uint16_t ODR;               // Состояние выходов
+    uint16_t IDR;               // Состояние входов (без учёта клавиатуры)
+} GPIO_TypeDef;
+
+typedef struct {
+    uint32_t Pin;
+    uint32_t Mode;
+    uint32_t Pull;
+    uint32_t Speed;
+    uint32_t Alternate;
+} GPIO_InitTypeDef;
+
+typedef enum {
+    GPIO_PIN_RESET = 0,
+    GPIO_PIN_SET
+} GPIO_PinState;
+
+extern GPIO_TypeDef simGpio[8];
+#define GPIOA (&simGpio[0])
+#define GPIOB (&simGpio[1])
+#define GPIOC (&simGpio[2])
+#define GPIOD (&simGpio[3])
+#define GPIOE (&simGpio[4])
+#define GPIOH (&simGpio[7])
+
+#define GPIO_PIN_0 ((uint16_t)0x0001)
+#define GPIO_PIN_1 ((uint16_t)0x0002)
+#define GPIO_PIN_2 ((uint16_t)0x0004)
+#define GPIO_PIN_3 ((uint16_t)0x0008)
+#define GPIO_PIN_4 ((uint16_t)0x0010)
+#define GPIO_PIN_5 ((uint16_t)0x0020)
+#define GPIO_PIN_6 ((uint16_t)0x0040)
+#define GPIO_PIN_7 ((uint16_t)0x0080)
+#define GPIO_PIN_8 ((uint16_t)0x0100)
+#define GPIO_PIN_9 ((uint16_t)0x0200)
+#define GPIO_PIN_10 ((uint16_t)0x0400)
+#define GPIO_PIN_11 ((uint16_t)0x0800)
+#define GPIO_PIN_12 ((uint16_t)0x1000)
+#define GPIO_PIN_13 ((uint16_t)0x2000)
+#define GPIO_PIN_14 ((uint16_t)0x4000)
+#define GPIO_PIN_15 ((uint16_t)0x8000)
+
+#define GPIO_MODE_INPUT 0x00U
+#define GPIO_MODE_OUTPUT_PP 0x01U
+#define GPIO_MODE_AF_PP 0x02U
+#define GPIO_MODE_AF_OD 0x12U
+#define GPIO_NOPULL 0x00U
+#define GPIO_PULLUP 0x01U
+#define GPIO_SPEED_FREQ_LOW 0x00U
+#define GPIO_SPEED_FREQ_HIGH 0x02U
+#define GPIO_SPEED_FREQ_VERY_HIGH 0x03U
+#define GPIO_AF4_I2C1 0x04U
+#define GPIO_AF7_USART2 0x07U
+#define GPIO_AF7_USART3 0x07U
+
+// DMA
+typedef struct {
+    uint32_t Channel;
+    uint32_t Direction;
+    uint32_t PeriphInc;
+    uint32_t MemInc;
+    uint32_t PeriphDataAlignment;
+    uint32_t MemDataAlignment;
+    uint32_t Mode;
+    uint32_t Priority;
+    uint32_t FIFOMode;
+} DMA_InitTypeDef;
+
+typedef struct {
+    DMA_Stream_TypeDef* Instance;
+    DMA_InitTypeDef Init;
+    void* Parent;
+    uint32_t ITMask;            // Разрешённые прерывания DMA_IT_*
+} DMA_HandleTypeDef;
+
+#define DMA_CHANNEL_1 0x02000000U
+#define DMA_CHANNEL_4 0x08000000U
+#define DMA_PERIPH_TO_MEMORY 0x00U
+#define DMA_MEMORY_TO_PERIPH 0x40U
+#define DMA_PINC_DISABLE 0x00U
+#define DMA_MINC_ENABLE 0x400U
+#define DMA_PDATAALIGN_BYTE 0x00U
+#define DMA_MDATAALIGN_BYTE 0x00U
+#define DMA_NORMAL 0x00U
+#define DMA_CIRCULAR 0x100U
+#define DMA_PRIORITY_LOW 0x00U
+#define DMA_FIFOMODE_DISABLE 0x00U
+#define DMA_IT_TC 0x10U
+#define DMA_IT_HT 0x08U
+
+#define __HAL_DMA_DISABLE_IT(h, it) ((h)->ITMask &= ~(uint32_t)(it))
+#define __HAL_DMA_ENABLE_IT(h, it) ((h)->ITMask |= (uint32_t)(it))
+#define __HAL_LINKDMA(h, field, dma) do { (h)->field = &(dma); (dma).Parent = (h); } while (0)
+
+// UART
+typedef struct {
+    uint32_t BaudRate;
+    uint32_t WordLength;
+    uint32_t StopBits;
+    uint32_t Parity;
+    uint32_t Mode;
+    uint32_t HwFlowCtl;
+    uint32_t OverSampling;
+} UART_InitTypeDef;
+
+typedef struct {
+    USART_TypeDef* Instance;
+    UART_InitTypeDef Init;
+    DMA_HandleTypeDef* hdmatx;
+    DMA_HandleTypeDef* hdmarx;
+    volatile uint32_t RxEventType;
+    volatile uint32_t gState;   // HAL_UART_STATE_*: занят ли передатчик
+    void* sim;                  // Состояние эмулятора (Sim/Src/sim_uart.c)
+} UART_HandleTypeDef;
+
+#define UART_WORDLENGTH_8B 0x00U
+#define UART_STOPBITS_1 0x00U
+#define UART_PARITY_NONE 0x00U
+#define UART_MODE_TX_RX 0x0CU
+#define UART_HWCONTROL_NONE 0x00U
+#define UART_OVERSAMPLING_16 0x00U
+#define HAL_UART_STATE_READY 0x20U
+#define HAL_UART_STATE_BUSY_TX 0x21U
+#define HAL_UART_RXEVENT_TC 0x00U
+#define HAL_UART_RXEVENT_HT 0x01U
+#define HAL_UART_RXEVENT_IDLE 0x02U
+
+// I2C
+typedef struct {
+    uint32_t ClockSpeed;
+    uint32_t DutyCycle;
+    uint32_t OwnAddress1;
+    uint32_t AddressingMode;
+    uint32_t DualAddressMode;
+    uint32_t OwnAddress2;
+    uint32_t GeneralCallMode;
+    uint32_t NoStretchMode;
+} I2C_InitTypeDef;
+
+typedef struct {
+    I2C_TypeDef* Instance;
+    I2C_InitTypeDef Init;
+    DMA_HandleTypeDef* hdmatx;
+    DMA_HandleTypeDef* hdmarx;
+} I2C_HandleTypeDef;
+
+#define I2C_DUTYCYCLE_2 0x00U
+#define I2C_ADDRESSINGMODE_7BIT 0x4000U
+#define I2C_DUALADDRESS_DISABLE 0x00U
+#define I2C_GENERALCALL_DISABLE 0x00U
+#define I2C_NOSTRETCH_DISABLE 0x00U
+#define I2C_MEMADD_SIZE_8BIT 0x01U
+#define I2C_MEMADD_SIZE_16BIT 0x10U
+
+// IWDG
+typedef struct {
+    uint32_t Prescaler;
+    uint32_t Reload;
+} IWDG_InitTypeDef;
+
+typedef struct {
+    IWDG_TypeDef* Instance;
+    IWDG_InitTypeDef Init;
+} IWDG_HandleTypeDef;
+
+#define IWDG_PRESCALER_32 0x03U
+
+// TIM
+typedef struct {
+    uint32_t Prescaler;
+    uint32_t CounterMode;
+    uint32_t Period;
+    uint32_t ClockDivision;
+    uint32_t RepetitionCounter;
+    uint32_t AutoReloadPreload;
+} TIM_Base_InitTypeDef;
+
+typedef struct {
+    TIM_TypeDef* Instance;
+    TIM_Base_InitTypeDef Init;
+} TIM_HandleTypeDef;
+
+typedef struct {
+    uint32_t ClockSource;
+    uint32_t ClockPolarity;
+    uint32_t ClockPrescaler;
+    uint32_t ClockFilter;
+} TIM_ClockConfigTypeDef;
+
+typedef struct {
+    uint32_t MasterOutputTrigger;
+    uint32_t MasterSlaveMode;
+} TIM_MasterConfigTypeDef;
+
+#define TIM_COUNTERMODE_UP 0x00U
+#define TIM_CLOCKDIVISION_DIV1 0x00U
+#define TIM_AUTORELOAD_PRELOAD_ENABLE 0x80U
+#define TIM_CLOCKSOURCE_INTERNAL 0x1000U
+#define TIM_TRGO_RESET 0x00U
+#define TIM_MASTERSLAVEMODE_DISABLE 0x00U
+
+// Общие функции
+HAL_StatusTypeDef HAL_Init(void);
+uint32_t HAL_GetTick(void);
+void HAL_Delay(uint32_t Delay);
+HAL_StatusTypeDef HAL_RCC_OscConfig(RCC_OscInitTypeDef* RCC_OscInitStruct);
+HAL_StatusTypeDef HAL_RCC_ClockConfig(RCC_ClkInitTypeDef* RCC_ClkInitStruct, uint32_t FLatency);
+void HAL_NVIC_SetPriority(IRQn_Type IRQn, uint32_t PreemptPriority, uint32_t SubPriority);
+void HAL_NVIC_EnableIRQ(IRQn_Type IRQn);
+void HAL_NVIC_DisableIRQ(IRQn_Type IRQn);
+void HAL_MspInit(void);
+
+HAL_StatusTypeDef HAL_DMA_Init(DMA_HandleTypeDef* hdma);
+HAL_StatusTypeDef HAL_DMA_DeInit(DMA_HandleTypeDef* hdma);
+
+void HAL_GPIO_Init(GPIO_TypeDef* GPIOx, GPIO_InitTypeDef* GPIO_Init);
+void HAL_GPIO_WritePin(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState);
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin);
+void HAL_GPIO_TogglePin(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin);
+void HAL_GPIO_DeInit(GPIO_TypeDef* GPIOx, uint32_t GPIO_Pin);
+
+HAL_StatusTypeDef HAL_UART_Init(UART_HandleTypeDef* huart);
+void HAL_UART_MspInit(UART_HandleTypeDef* huart);
+void HAL_UART_MspDeInit(UART_HandleTypeDef* huart);
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef* huart, const uint8_t* pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef* huart, const uint8_t* pData, uint16_t Size);
+HAL_StatusTypeDef HAL_UARTEx_ReceiveToIdle_DMA(UART_HandleTypeDef* huart, uint8_t* pData, uint16_t Size);
+uint32_t HAL_UARTEx_GetRxEventType(UART_HandleTypeDef* huart);
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef* huart);
+void HAL_UART_ErrorCallback(UART_HandleTypeDef* huart);
+void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef* huart, uint16_t Size);
+
+HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef* hi2c);
+HAL_StatusTypeDef HAL_I2C_DeInit(I2C_HandleTypeDef* hi2c);
+void HAL_I2C_MspInit(I2C_HandleTypeDef* hi2c);
+void HAL_I2C_MspDeInit(I2C_HandleTypeDef* hi2c);
+HAL_StatusTypeDef HAL_I2C_IsDeviceReady(I2C_HandleTypeDef* hi2c, uint16_t DevAddress, uint32_t Trials, uint32_t Timeout);
+HAL_StatusTypeDef HAL_I2C_Master_Transmit(I2C_HandleTypeDef* hi2c, uint16_t DevAddress, uint8_t* pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_I2C_Mem_Write(I2C_HandleTypeDef* hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t* pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_I2C_Mem_Read(I2C_HandleTypeDef* hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t* pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_I2C_Mem_Write_DMA(I2C_HandleTypeDef* hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t* pData, uint16_t Size);
+HAL_StatusTypeDef HAL_I2C_Mem_Read_IT(I2C_HandleTypeDef* hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t* pData, uint16_t Size);
+void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef* hi2c);
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef* hi2c);
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef* hi2c);
+
+void HAL_PWR_EnableBkUpAccess(void);
+HAL_StatusTypeDef HAL_PWREx_EnableBkUpReg(void);
+HAL_StatusTypeDef HAL_PWR_ConfigPVD(PWR_PVDTypeDef* sConfigPVD);
+void HAL_PWR_EnablePVD(void);
+void HAL_PWR_PVDCallback(void);
+
+HAL_StatusTypeDef HAL_IWDG_Init(IWDG_HandleTypeDef* hiwdg);
+HAL_StatusTypeDef HAL_IWDG_Refresh(IWDG_HandleTypeDef* hiwdg);
+
+HAL_StatusTypeDef HAL_TIM_Base_Init(TIM_HandleTypeDef* htim);
+HAL_StatusTypeDef HAL_TIM_Base_Start_IT(TIM_HandleTypeDef* htim);
+HAL_StatusTypeDef HAL_TIM_ConfigClockSource(TIM_HandleTypeDef* htim, TIM_ClockConfigTypeDef* sClockSourceConfig);
+HAL_StatusTypeDef HAL_TIMEx_MasterConfigSynchronization(TIM_HandleTypeDef* htim, TIM_MasterConfigTypeDef* sMasterConfig);
+void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef* htim);
+
+#endif /* STM32F4XX_HAL_SIM_H */
@@ -0,0 +1,147 @@
+/* logdecode.c - Расшифровка бинарного лога UART3 (LOG_BINARY) в текст
+ *
+ * Каталог сообщений берётся из Core/Inc/logmsg.h при сборке декодера, поэтому декодер
+ * должен быть собран из того же дерева, что и прошивка: запись LOG_MSG_CATALOG после сброса
+ * несёт контрольное число каталога прошивки, расхождение выводится предупреждением.
+ * Текст вне записей (вывод прошивки с LOG_BINARY 0) передаётся без изменений.
+ *
+ *   ./build/logdecode fw.log                лог хостовой сборки (SIM_LOG)
+ *   ./build/logdecode /dev/ttyUSB0          UART3 платы, порт должен быть настроен на 9600 8N1
+ */
+
+#include "logmsg.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+typedef enum {
+    RECORD_DONE,
+    RECORD_PARTIAL,
+    RECORD_BAD
+} RecordStatus;
+
+static uint8_t pending[LOG_RECORD_MAX];
+static size_t pendingLength = 0;
+static bool warnCounts = true;
+
+// Статистика
+static unsigned long inputBytes = 0;
+static unsigned long textBytes = 0;        // Байты текста вне записей
+static unsigned long records = 0;
+static unsigned long skippedBytes = 0;     // Байты повреждённых записей
+static unsigned long expandedBytes = 0;    // Тот же лог в текстовом режиме прошивки
+
+static RecordStatus getVarint(const uint8_t* data, size_t length, size_t* pos, uint32_t* value) {
+    uint32_t result = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (*pos >= length) return RECORD_PARTIAL;
+        uint8_t byte = data[(*pos)++];
+        result |= (uint32_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            *value = result;
+            return RECORD_DONE;
+        }
+    }
+    return RECORD_BAD;
+}
+
+static RecordStatus parseRecord(const uint8_t* data, size_t length) {
+    if (length < 3) return RECORD_PARTIAL;
+    uint8_t id = data[1];
+    uint8_t count = data[2];
+    if (id >= LOG_MSG_COUNT || count > LOG_MAX_ARGS) return RECORD_BAD;
+
+    size_t pos = 3;
+    uint32_t timestamp;
+    uint32_t args[LOG_MAX_ARGS] = {0};
+    RecordStatus status = getVarint(data, length, &pos, &timestamp);
+    for (uint8_t i = 0; status == RECORD_DONE && i < count; i++) {
+        status = getVarint(data, length, &pos, &args[i]);
+    }
+    if (status != RECORD_DONE) return status;
+    if (pos >= length) return RECORD_PARTIAL;
+
+    uint8_t check = 0;
+    for (size_t i = 1; i < pos; i++) {
+        check ^= data[i];
+    }
+    if (check != data[pos]) return RECORD_BAD;
+
+    char text[256];
+    logFormat(text, sizeof(text), logFormats[id], args);
+    int lineLength = printf("[%lu] %s\n", (unsigned long)timestamp, text);
+    expandedBytes += (unsigned long)lineLength + 1;
+    records++;
+
+    if (warnCounts && count != logFormatArgs(logFormats[id])) {
+        fprintf(stderr, "logdecode: message %u has %u arguments, format expects %u\n",
+                id, count, logFormatArgs(logFormats[id]));
+        warnCounts = false;
+    }
+    if (id == LOG_MSG_CATALOG && (args[0] != logCatalogHash() || args[1] != LOG_MSG_COUNT)) {
+        fprintf(stderr, "logdecode: firmware catalog %08lx (%lu messages) differs from decoder %08lx (%u): "
+                "rebuild the decoder from the firmware tree\n",
+                (unsigned long)args[0], (unsigned long)args[1], (unsigned long)logCatalogHash(), LOG_MSG_COUNT);
+    }
+    return RECORD_DONE;
+}
+
+static void feed(uint8_t byte) {
+    if (pendingLength == 0) {
+        if (byte == LOG_RECORD_SYNC) {
+            pending[pendingLength++] = byte;
+        } else {
+            putchar(byte);
+            textBytes++;
+            expandedBytes++;
+        }
+        return;
+    }
+
+    pending[pendingLength++] = byte;
+    RecordStatus status = parseRecord(pending, pendingLength);
+    if (status == RECORD_PARTIAL && pendingLength < sizeof(pending)) return;
+    if (status == RECORD_DONE) {
+        pendingLength = 0;
+        return;
+    }
+
+    // Не запись: байт синхронизации отбрасывается, поиск продолжается со следующего байта
+    uint8_t rest[LOG_RECORD_MAX];
+    size_t restLength = pendingLength - 1;
+    memcpy(rest, pending + 1, restLength);
+    pendingLength = 0;
+    skippedBytes++;
+    for (size_t i = 0; i < restLength; i++) {
+        feed(rest[i]);
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc > 2 || (argc == 2 && (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0))) {
+        fprintf(stderr, "usage: logdecode [file]   (stdin if omitted)\n");
+        return 2;
+    }
+    FILE* input = stdin;
+    if (argc == 2 && strcmp(argv[1], "-") != 0) {
+        input = fopen(argv[1], "rb");
+        if (input == NULL) {
+            perror(argv[1]);
+            return 1;
+        }
+    }
+    // Живой порт: каждая запись выводится сразу
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    int c;
+    while ((c = getc(input)) != EOF) {
+        inputBytes++;
+        feed((uint8_t)c);
+    }
+    skippedBytes += pendingLength;
+
+    fprintf(stderr, "logdecode: %lu B in, %lu records, %lu B text, %lu B skipped; as text %lu B (%.1fx)\n",
+            inputBytes, records, textBytes, skippedBytes, expandedBytes,
+            inputBytes ? (double)expandedBytes / inputBytes : 0.0);
+    return 0;
+}
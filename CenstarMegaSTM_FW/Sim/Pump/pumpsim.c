@@ -0,0 +1,733 @@
+/* pumpsim.c - Симулятор ТРК Censtar (GasKitLink v1.2) с внесением неисправностей
+ *
+ * Отвечает на запросы контроллера по последовательному порту: pty хостовой сборки прошивки
+ * (/tmp/censtar-rs422) или USB-RS-422 преобразователь, подключённый к плате.
+ * CRC и длины кадров - те же, что в прошивке (crc.c, frame.h, config.h).
+ *
+ * Ответы (STX 0x00 адрес команда ... CRC), в разборе которых участвует fsm.c:
+ *   S  7 байт  [4] код состояния, [5] рукав (0 - все рукава повешены)
+ *   L 15 байт  [4] рукав ';' режим ';' [8..13] отпущено, 0.01 л
+ *   R 15 байт  [4] рукав ';' режим ';' [8..13] сумма
+ *   T 27 байт  [4] рукав ';' режим ';' [8..13] сумма ';' [15..20] объём ';' [22..25] цена
+ *   C 16 байт  [4] рукав ';' [6..14] суммарный счётчик, 0.001 л
+ * На V/M/N/B/G ТРК отвечает кадром S.
+ *
+ * Покупатель моделируется так: через --lift мс после освобождения поста снимает пистолет,
+ * ждёт разрешения (V/M) не дольше --give-up мс, по окончании отпуска вешает пистолет через --hang мс.
+ * Команда N при снятом пистолете без разрешения - это "Nozzle up! Hang up" на дисплее контроллера:
+ * покупатель вешает пистолет и снимает его снова через --lift мс
+ *
+ * Прогон с хостовой сборкой прошивки:
+ *   SIM_KEYS=Pump/transactions.keys SIM_KEYS_LOOP=1 SIM_LOG=fw.log ./build/censtar-sim &
+ *   ./build/pumpsim -f 120 --drop 3 --crc 3 --outage 30000:8000 -t 600
+ * Транзакций в час и восстановление после молчания выводит pumpsim, время обнаружения
+ * отказа - строки "RS422 ... failed" и статистика постов в логе прошивки
+ */
+
+#include "frame.h"
+#include "crc.h"
+#include "config.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#define PUMP_MAX_PENDING 8      // Ответы, ожидающие отправки (задержка реакции ТРК)
+#define PUMP_LINE_IDLE_MS 20    // Пауза на линии, после которой неполный запрос отбрасывается
+
+// Состояния ТРК: первая цифра кода в ответе S
+typedef enum {
+    PUMP_IDLE = '1',            // Пистолет повешен
+    PUMP_NOZZLE_UP = '2',       // Пистолет снят, разрешения нет
+    PUMP_AUTHORIZED = '3',      // Доза принята, насос запускается
+    PUMP_STARTED = '4',         // Насос запущен
+    PUMP_DISPENSING = '6',      // Идёт отпуск
+    PUMP_PAUSED = '7',          // Отпуск приостановлен командой B
+    PUMP_FINISHED = '8',        // Отпуск окончен, пистолет ещё снят
+    PUMP_CLOSED = '9'           // Пистолет повешен, итог не подтверждён командой N
+} PumpState;
+
+typedef struct {
+    uint8_t address;
+    PumpState state;
+    uint8_t nozzle;             // Рукав текущей или последней транзакции
+    uint8_t nextNozzle;         // Рукав, который покупатель снимет следующим
+    char mode;                  // 'V' или 'M' текущей транзакции
+    uint16_t price;
+    uint32_t presetCl;          // Доза в 0.01 л
+    uint64_t dispensedUcl;      // Отпущено, 0.000001 л (накопление без потери точности)
+    uint32_t totalMl[NOZZLE_COUNT]; // Суммарные счётчики рукавов, 0.001 л
+    uint64_t stateTime;         // Момент входа в текущее состояние (мс)
+    uint64_t lastFlow;          // Момент последнего пересчёта отпущенного объёма (мс)
+    bool nozzleUp;
+    bool transactionOpen;       // Итог транзакции ещё не подтверждён командой N
+    // Статистика
+    uint32_t requests[26];      // Запросы по кодам команд 'A'..'Z'
+    uint32_t transactions;
+    uint32_t givenUp;           // Покупатель повесил пистолет, не дождавшись разрешения
+    uint32_t toldToHangUp;      // Покупатель повесил пистолет по команде N
+    uint64_t lastRequest;
+    uint32_t maxRequestGap;
+} Pump;
+
+typedef struct {
+    uint64_t due;               // Момент отправки (мс)
+    uint8_t data[MAX_FRAME_LENGTH];
+    int length;
+} PendingReply;
+
+// Параметры симуляции и неисправностей (вероятности в процентах на один ответ)
+static struct {
+    const char* device;
+    uint8_t firstAddress;
+    uint8_t postCount;
+    uint8_t nozzles;
+    uint32_t flowLpm;           // Скорость отпуска (л/мин)
+    uint32_t liftDelay;
+    uint32_t hangDelay;
+    uint32_t giveUp;
+    uint32_t delay;             // Время реакции ТРК (мс)
+    uint32_t jitter;            // Случайная добавка к времени реакции (мс)
+    uint32_t slowPercent;       // Доля ответов с увеличенной задержкой
+    uint32_t slowDelay;
+    uint32_t crcPercent;
+    uint32_t truncPercent;
+    uint32_t dropPercent;
+    uint32_t flapPercent;
+    uint32_t outageStart;       // Пост молчит с outageStart по outageStart + outageLength (мс от запуска)
+    uint32_t outageLength;
+    uint32_t outagePeriod;      // Повтор окна молчания, 0 - однократно
+    uint32_t runSeconds;
+    uint32_t reportSeconds;
+    bool verbose;
+} cfg = {
+    .device = "/tmp/censtar-rs422",
+    .firstAddress = POST_ADDRESS,
+    .postCount = BUS_POST_COUNT,
+    .nozzles = NOZZLES_PER_POST,
+    .flowLpm = 40,
+    .liftDelay = 3000,
+    .hangDelay = 1500,
+    .giveUp = 20000,
+    .delay = 15,
+    .slowDelay = 500,
+};
+
+// Счётчики внесённых неисправностей и восстановления после молчания
+static struct {
+    uint32_t rxBytes;
+    uint32_t rxFrames;
+    uint32_t rxCrcErrors;
+    uint32_t rxDropped;
+    uint32_t foreign;           // Запросы к адресам, которых нет в симуляции
+    uint32_t replies;
+    uint32_t slow;
+    uint32_t crc;
+    uint32_t truncated;
+    uint32_t dropped;
+    uint32_t flapped;
+    uint32_t outageRequests;    // Запросы, оставшиеся без ответа из-за молчания
+    uint32_t outages;
+    uint32_t recoveries;
+    uint64_t recoverySum;
+    uint32_t recoveryMax;
+} stats;
+
+static Pump pumps[BUS_MAX_POSTS];
+static PendingReply pending[PUMP_MAX_PENDING];
+static uint64_t startTime;
+static bool inOutage = false;
+static uint64_t outageEnd = 0;  // Конец последнего окна молчания, 0 - ждём первого запроса после него
+static volatile sig_atomic_t stopRequested = 0;
+
+static uint64_t nowMs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000 - startTime;
+}
+
+static bool chance(uint32_t percent) {
+    return percent > 0 && (uint32_t)(rand() % 100) < percent;
+}
+
+static void logEvent(const Pump* pump, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+
+static void logEvent(const Pump* pump, const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    if (pump != NULL) {
+        fprintf(stderr, "[%8.3f] post %u: ", nowMs() / 1000.0, pump->address);
+    } else {
+        fprintf(stderr, "[%8.3f] ", nowMs() / 1000.0);
+    }
+    vfprintf(stderr, fmt, args);
+    fputc('\n', stderr);
+    va_end(args);
+}
+
+static Pump* findPump(uint8_t address) {
+    if (address < cfg.firstAddress || address >= cfg.firstAddress + cfg.postCount) return NULL;
+    return &pumps[address - cfg.firstAddress];
+}
+
+static void setState(Pump* pump, PumpState state) {
+    if (pump->state != state && cfg.verbose) {
+        logEvent(pump, "state %c -> %c", pump->state, state);
+    }
+    pump->state = state;
+    pump->stateTime = nowMs();
+}
+
+static uint32_t dispensedCl(const Pump* pump) {
+    return (uint32_t)(pump->dispensedUcl / 10000);
+}
+
+static uint32_t amountOf(const Pump* pump) {
+    return (uint32_t)((uint64_t)dispensedCl(pump) * pump->price / 100);
+}
+
+// Отпуск топлива: объём растёт со скоростью flowLpm до дозы
+static void updateFlow(Pump* pump, uint64_t now) {
+    if (pump->state == PUMP_DISPENSING) {
+        uint64_t elapsed = now - pump->lastFlow;
+        uint64_t presetUcl = (uint64_t)pump->presetCl * 10000;
+        pump->dispensedUcl += elapsed * cfg.flowLpm * 1000000 / 60000;
+        if (pump->dispensedUcl >= presetUcl) {
+            pump->dispensedUcl = presetUcl;
+            pump->totalMl[pump->nozzle - 1] += pump->presetCl * 10;
+            pump->transactions++;
+            setState(pump, PUMP_FINISHED);
+            logEvent(pump, "transaction %lu done: %lu cl, amount %lu",
+                     (unsigned long)pump->transactions, (unsigned long)pump->presetCl,
+                     (unsigned long)amountOf(pump));
+        }
+    }
+    pump->lastFlow = now;
+}
+
+// Покупатель: снимает пистолет, ждёт разрешения, вешает пистолет после отпуска
+static void updateCustomer(Pump* pump, uint64_t now) {
+    uint64_t inState = now - pump->stateTime;
+    switch (pump->state) {
+        case PUMP_IDLE:
+            if (inState >= cfg.liftDelay) {
+                pump->nozzle = pump->nextNozzle;
+                pump->nextNozzle = pump->nextNozzle % cfg.nozzles + 1;
+                pump->nozzleUp = true;
+                setState(pump, PUMP_NOZZLE_UP);
+            }
+            break;
+        case PUMP_NOZZLE_UP:
+            if (inState >= cfg.giveUp) {
+                pump->nozzleUp = false;
+                pump->givenUp++;
+                logEvent(pump, "customer gave up waiting for authorization");
+                setState(pump, PUMP_IDLE);
+            }
+            break;
+        case PUMP_AUTHORIZED:
+            if (inState >= 200) setState(pump, PUMP_STARTED);
+            break;
+        case PUMP_STARTED:
+            if (inState >= 300) {
+                pump->lastFlow = now;
+                setState(pump, PUMP_DISPENSING);
+            }
+            break;
+        case PUMP_FINISHED:
+            if (inState >= cfg.hangDelay) {
+                pump->nozzleUp = false;
+                setState(pump, pump->transactionOpen ? PUMP_CLOSED : PUMP_IDLE);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+// Разбор "n;vvvvvv;pppp" из V/M
+static bool authorize(Pump* pump, char mode, const uint8_t* payload, int length) {
+    char text[MAX_FRAME_PAYLOAD + 1];
+    unsigned nozzle, price;
+    unsigned long value;
+    if (length > MAX_FRAME_PAYLOAD) return false;
+    memcpy(text, payload, length);
+    text[length] = '\0';
+    if (sscanf(text, "%u;%lu;%u", &nozzle, &value, &price) != 3 || price == 0) return false;
+    if (pump->state != PUMP_NOZZLE_UP || nozzle != pump->nozzle) return false;
+
+    pump->mode = mode;
+    pump->price = (uint16_t)price;
+    if (value == 999999) {
+        // Полный бак: доза ограничена объёмом бака покупателя
+        pump->presetCl = (20 + rand() % 41) * 100;
+    } else if (mode == 'V') {
+        pump->presetCl = value;
+    } else {
+        pump->presetCl = (uint32_t)((uint64_t)value * 100 / price);
+    }
+    pump->dispensedUcl = 0;
+    pump->transactionOpen = true;
+    setState(pump, PUMP_AUTHORIZED);
+    logEvent(pump, "authorized %c nozzle %u: preset %lu cl, price %u",
+             mode, nozzle, (unsigned long)pump->presetCl, price);
+    return true;
+}
+
+// Выполнение команды и формирование ответа
+static int handleRequest(Pump* pump, char command, const uint8_t* payload, int payloadLength, uint8_t* reply) {
+    uint8_t data[MAX_FRAME_PAYLOAD + 8];
+    int length = 0;
+    char replyCommand = command;
+    switch (command) {
+        case 'V':
+        case 'M':
+            if (!authorize(pump, command, payload, payloadLength)) {
+                logEvent(pump, "%c rejected in state %c", command, pump->state);
+            }
+            replyCommand = 'S';
+            break;
+        case 'N':
+            // Подтверждение итога: транзакция закрывается, пост готов к следующей
+            pump->transactionOpen = false;
+            if (pump->state == PUMP_NOZZLE_UP) {
+                pump->nozzleUp = false;
+                pump->toldToHangUp++;
+                setState(pump, PUMP_IDLE);
+            } else if (pump->state == PUMP_CLOSED || (pump->state == PUMP_FINISHED && !pump->nozzleUp)) {
+                setState(pump, PUMP_IDLE);
+            }
+            replyCommand = 'S';
+            break;
+        case 'B':
+            if (pump->state == PUMP_DISPENSING) setState(pump, PUMP_PAUSED);
+            replyCommand = 'S';
+            break;
+        case 'G':
+            if (pump->state == PUMP_PAUSED) {
+                pump->lastFlow = nowMs();
+                setState(pump, PUMP_DISPENSING);
+            }
+            replyCommand = 'S';
+            break;
+        case 'S':
+            break;
+        case 'L':
+            length = snprintf((char*)data, sizeof(data), "%u;%c;%06lu", pump->nozzle, pump->mode ? pump->mode : 'V',
+                              (unsigned long)dispensedCl(pump));
+            break;
+        case 'R':
+            length = snprintf((char*)data, sizeof(data), "%u;%c;%06lu", pump->nozzle, pump->mode ? pump->mode : 'V',
+                              (unsigned long)amountOf(pump));
+            break;
+        case 'T':
+            length = snprintf((char*)data, sizeof(data), "%u;%c;%06lu;%06lu;%04u", pump->nozzle,
+                              pump->mode ? pump->mode : 'V', (unsigned long)amountOf(pump),
+                              (unsigned long)dispensedCl(pump), pump->price);
+            break;
+        case 'C': {
+            unsigned nozzle = (payloadLength > 0) ? (unsigned)(payload[0] - '0') : 1;
+            if (nozzle < 1 || nozzle > NOZZLE_COUNT) nozzle = 1;
+            length = snprintf((char*)data, sizeof(data), "%u;%09lu", nozzle,
+                              (unsigned long)(pump->totalMl[nozzle - 1] % 1000000000));
+            break;
+        }
+        default:
+            logEvent(pump, "unknown command 0x%02X", (uint8_t)command);
+            return 0;
+    }
+
+    if (replyCommand == 'S') {
+        PumpState state = pump->state;
+        if (chance(cfg.flapPercent)) {
+            // Дребезг состояния: один ответ с кодом другого состояния
+            static const PumpState states[] = {PUMP_IDLE, PUMP_NOZZLE_UP, PUMP_DISPENSING, PUMP_PAUSED, PUMP_FINISHED};
+            state = states[rand() % (sizeof(states) / sizeof(states[0]))];
+            stats.flapped++;
+        }
+        data[0] = (uint8_t)state;
+        data[1] = (state == PUMP_IDLE || state == PUMP_CLOSED) ? '0' : (uint8_t)('0' + pump->nozzle);
+        length = 2;
+    }
+
+    // assembleFrame ограничен нагрузкой запроса (MAX_FRAME_PAYLOAD), ответ T длиннее
+    int index = 0;
+    reply[index++] = FRAME_STX;
+    reply[index++] = 0x00;
+    reply[index++] = pump->address;
+    reply[index++] = (uint8_t)replyCommand;
+    memcpy(reply + index, data, length);
+    index += length;
+    reply[index] = calculateCRC(reply, index);
+    return index + 1;
+}
+
+// Окно молчания поста: с outageStart, длиной outageLength, с повтором через outagePeriod
+static bool outageActive(uint64_t now) {
+    if (cfg.outageLength == 0 || now < cfg.outageStart) return false;
+    uint64_t offset = now - cfg.outageStart;
+    if (cfg.outagePeriod != 0) {
+        offset %= cfg.outagePeriod;
+    }
+    return offset < cfg.outageLength;
+}
+
+static void updateOutage(uint64_t now) {
+    bool active = outageActive(now);
+    if (active && !inOutage) {
+        stats.outages++;
+        logEvent(NULL, "outage %lu started", (unsigned long)stats.outages);
+    } else if (!active && inOutage) {
+        outageEnd = now;
+        logEvent(NULL, "outage %lu ended", (unsigned long)stats.outages);
+    }
+    inOutage = active;
+}
+
+static void queueReply(const uint8_t* frame, int length, uint64_t now) {
+    uint32_t delay = cfg.delay + (cfg.jitter ? (uint32_t)rand() % (cfg.jitter + 1) : 0);
+    if (chance(cfg.slowPercent)) {
+        delay += cfg.slowDelay;
+        stats.slow++;
+    }
+    for (int i = 0; i < PUMP_MAX_PENDING; i++) {
+        if (pending[i].length == 0) {
+            memcpy(pending[i].data, frame, length);
+            pending[i].length = length;
+            pending[i].due = now + delay;
+            return;
+        }
+    }
+}
+
+static void processFrame(const uint8_t* frame, int length, uint64_t now) {
+    stats.rxFrames++;
+    Pump* pump = findPump(frame[2]);
+    if (pump == NULL) {
+        stats.foreign++;
+        return;
+    }
+    char command = (char)frame[3];
+    if (command >= 'A' && command <= 'Z') pump->requests[command - 'A']++;
+    if (pump->lastRequest != 0 && now - pump->lastRequest > pump->maxRequestGap) {
+        pump->maxRequestGap = (uint32_t)(now - pump->lastRequest);
+    }
+    pump->lastRequest = now;
+    if (cfg.verbose) {
+        logEvent(pump, "<- %c (%d B)", command, length);
+    }
+
+    if (inOutage) {
+        stats.outageRequests++;
+        return;
+    }
+    if (outageEnd != 0) {
+        // Первый запрос после молчания: контроллер снова опрашивает пост
+        uint32_t recovery = (uint32_t)(now - outageEnd);
+        stats.recoveries++;
+        stats.recoverySum += recovery;
+        if (recovery > stats.recoveryMax) stats.recoveryMax = recovery;
+        logEvent(pump, "first request %lu ms after outage", (unsigned long)recovery);
+        outageEnd = 0;
+    }
+
+    uint8_t reply[MAX_FRAME_LENGTH];
+    int replyLength = handleRequest(pump, command, frame + 4, length - FRAME_MIN_LENGTH, reply);
+    if (replyLength == 0) return;
+
+    if (chance(cfg.dropPercent)) {
+        stats.dropped++;
+        return;
+    }
+    if (chance(cfg.crcPercent)) {
+        reply[replyLength - 1] ^= 0x5A;
+        stats.crc++;
+    } else if (chance(cfg.truncPercent)) {
+        replyLength = 1 + rand() % (replyLength - 1);
+        stats.truncated++;
+    }
+    queueReply(reply, replyLength, now);
+}
+
+// Длина запроса по коду команды: V/M несут "n;vvvvvv;pppp", C - номер рукава
+static int requestLength(char command) {
+    switch (command) {
+        case 'V':
+        case 'M': return FRAME_MIN_LENGTH + 13;
+        case 'C': return FRAME_MIN_LENGTH + 1;
+        default:  return FRAME_MIN_LENGTH;
+    }
+}
+
+// Сборка запросов из потока байтов с поиском STX после ошибки
+static uint8_t rxBuffer[MAX_FRAME_LENGTH];
+static int rxLength = 0;
+
+static void dropRxBytes(int count) {
+    stats.rxDropped += count;
+    rxLength -= count;
+    memmove(rxBuffer, rxBuffer + count, rxLength);
+}
+
+static void pushRxByte(uint8_t byte, uint64_t now) {
+    stats.rxBytes++;
+    if (rxLength == 0 && byte != FRAME_STX) {
+        stats.rxDropped++;
+        return;
+    }
+    rxBuffer[rxLength++] = byte;
+    while (rxLength >= 4) {
+        int expected = requestLength((char)rxBuffer[3]);
+        if (rxLength < expected) return;
+        if (calculateCRC(rxBuffer, expected - 1) == rxBuffer[expected - 1]) {
+            processFrame(rxBuffer, expected, now);
+            rxLength -= expected;
+            memmove(rxBuffer, rxBuffer + expected, rxLength);
+        } else {
+            stats.rxCrcErrors++;
+            int skip = 1;
+            while (skip < rxLength && rxBuffer[skip] != FRAME_STX) skip++;
+            dropRxBytes(skip);
+        }
+    }
+}
+
+static void setRaw(int fd) {
+    struct termios tio;
+    if (tcgetattr(fd, &tio) == 0) {
+        cfmakeraw(&tio);
+        cfsetispeed(&tio, B9600);
+        cfsetospeed(&tio, B9600);
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+}
+
+static int openDevice(const char* path) {
+    int fd = open(path, O_RDWR | O_NOCTTY);
+    if (fd < 0) {
+        fprintf(stderr, "pumpsim: cannot open %s: %s\n", path, strerror(errno));
+        exit(1);
+    }
+    setRaw(fd);
+    return fd;
+}
+
+// Контроллер перезапущен (эмулятор создаёт pty заново и переставляет ссылку): посты
+// продолжают работу с прежним состоянием на новом pty. Пока нового нет, остаётся прежний
+static int reopenDevice(const char* path, int fd) {
+    int reopened = open(path, O_RDWR | O_NOCTTY);
+    if (reopened < 0) return fd;
+    close(fd);
+    setRaw(reopened);
+    if (stats.rxBytes > 0) {
+        logEvent(NULL, "reopened %s", path);
+    }
+    return reopened;
+}
+
+static void report(void) {
+    uint64_t now = nowMs();
+    double hours = now / 3600000.0;
+    fprintf(stderr, "---- %.1f s: rx %lu B, %lu frames, %lu CRC errors, %lu dropped B, %lu foreign\n",
+            now / 1000.0, (unsigned long)stats.rxBytes, (unsigned long)stats.rxFrames,
+            (unsigned long)stats.rxCrcErrors, (unsigned long)stats.rxDropped, (unsigned long)stats.foreign);
+    fprintf(stderr, "     replies %lu; injected: slow %lu, crc %lu, truncated %lu, dropped %lu, flapped %lu\n",
+            (unsigned long)stats.replies, (unsigned long)stats.slow, (unsigned long)stats.crc,
+            (unsigned long)stats.truncated, (unsigned long)stats.dropped, (unsigned long)stats.flapped);
+    if (stats.outages > 0) {
+        fprintf(stderr, "     outages %lu, unanswered %lu, recovery avg %lu max %lu ms (%lu)\n",
+                (unsigned long)stats.outages, (unsigned long)stats.outageRequests,
+                (unsigned long)(stats.recoveries ? stats.recoverySum / stats.recoveries : 0),
+                (unsigned long)stats.recoveryMax, (unsigned long)stats.recoveries);
+    }
+    for (int i = 0; i < cfg.postCount; i++) {
+        const Pump* pump = &pumps[i];
+        fprintf(stderr, "     post %u: %lu transactions (%.1f/h), gave up %lu, hung up on N %lu, max poll gap %lu ms, requests",
+                pump->address, (unsigned long)pump->transactions, hours > 0 ? pump->transactions / hours : 0.0,
+                (unsigned long)pump->givenUp, (unsigned long)pump->toldToHangUp,
+                (unsigned long)pump->maxRequestGap);
+        for (int c = 0; c < 26; c++) {
+            if (pump->requests[c] != 0) {
+                fprintf(stderr, " %c:%lu", 'A' + c, (unsigned long)pump->requests[c]);
+            }
+        }
+        fputc('\n', stderr);
+    }
+}
+
+static void onSignal(int sig) {
+    (void)sig;
+    stopRequested = 1;
+}
+
+static void usage(void) {
+    fprintf(stderr,
+        "usage: pumpsim [options] [device]\n"
+        "  device             serial port or pty (default /tmp/censtar-rs422)\n"
+        "  -a, --address A[-B]  simulated post addresses (default %u)\n"
+        "  -n, --nozzles N    nozzles per post, used in turn (default %u)\n"
+        "  -f, --flow LPM     flow rate, l/min (default 40)\n"
+        "      --lift MS      customer lifts the nozzle MS after the post is free (default 3000)\n"
+        "      --hang MS      customer hangs up MS after dispensing ends (default 1500)\n"
+        "      --give-up MS   customer hangs up without authorization after MS (default 20000)\n"
+        "  -d, --delay MS[:J] reply delay plus random jitter up to J ms (default 15)\n"
+        "      --slow P:MS    P%% of replies delayed by MS more\n"
+        "      --crc P        P%% of replies with a bad CRC\n"
+        "      --trunc P      P%% of replies truncated\n"
+        "      --drop P       P%% of replies not sent\n"
+        "      --flap P       P%% of status replies carry a random state\n"
+        "      --outage S:L[:P] silent from S ms for L ms, repeated every P ms\n"
+        "      --seed N       random seed (default 1)\n"
+        "  -t, --time S       stop after S seconds\n"
+        "  -s, --stats S      print statistics every S seconds\n"
+        "  -v, --verbose      log every request and state change\n",
+        POST_ADDRESS, NOZZLES_PER_POST);
+    exit(2);
+}
+
+static void parseOptions(int argc, char** argv) {
+    enum { OPT_LIFT = 256, OPT_HANG, OPT_GIVE_UP, OPT_SLOW, OPT_CRC, OPT_TRUNC, OPT_DROP, OPT_FLAP, OPT_OUTAGE, OPT_SEED };
+    static const struct option options[] = {
+        {"address", required_argument, NULL, 'a'},
+        {"nozzles", required_argument, NULL, 'n'},
+        {"flow", required_argument, NULL, 'f'},
+        {"lift", required_argument, NULL, OPT_LIFT},
+        {"hang", required_argument, NULL, OPT_HANG},
+        {"give-up", required_argument, NULL, OPT_GIVE_UP},
+        {"delay", required_argument, NULL, 'd'},
+        {"slow", required_argument, NULL, OPT_SLOW},
+        {"crc", required_argument, NULL, OPT_CRC},
+        {"trunc", required_argument, NULL, OPT_TRUNC},
+        {"drop", required_argument, NULL, OPT_DROP},
+        {"flap", required_argument, NULL, OPT_FLAP},
+        {"outage", required_argument, NULL, OPT_OUTAGE},
+        {"seed", required_argument, NULL, OPT_SEED},
+        {"time", required_argument, NULL, 't'},
+        {"stats", required_argument, NULL, 's'},
+        {"verbose", no_argument, NULL, 'v'},
+        {NULL, 0, NULL, 0}
+    };
+    unsigned seed = 1;
+    int opt;
+    while ((opt = getopt_long(argc, argv, "a:n:f:d:t:s:vh", options, NULL)) != -1) {
+        unsigned a, b;
+        switch (opt) {
+            case 'a':
+                switch (sscanf(optarg, "%u-%u", &a, &b)) {
+                    case 1: b = a; break;
+                    case 2: break;
+                    default: usage();
+                }
+                if (a < 1 || b > BUS_MAX_POSTS || b < a) usage();
+                cfg.firstAddress = (uint8_t)a;
+                cfg.postCount = (uint8_t)(b - a + 1);
+                break;
+            case 'n':
+                cfg.nozzles = (uint8_t)atoi(optarg);
+                if (cfg.nozzles < 1 || cfg.nozzles > NOZZLE_COUNT) usage();
+                break;
+            case 'f': cfg.flowLpm = (uint32_t)atoi(optarg); break;
+            case OPT_LIFT: cfg.liftDelay = (uint32_t)atoi(optarg); break;
+            case OPT_HANG: cfg.hangDelay = (uint32_t)atoi(optarg); break;
+            case OPT_GIVE_UP: cfg.giveUp = (uint32_t)atoi(optarg); break;
+            case 'd':
+                if (sscanf(optarg, "%u:%u", &cfg.delay, &cfg.jitter) < 1) usage();
+                break;
+            case OPT_SLOW:
+                if (sscanf(optarg, "%u:%u", &cfg.slowPercent, &cfg.slowDelay) != 2) usage();
+                break;
+            case OPT_CRC: cfg.crcPercent = (uint32_t)atoi(optarg); break;
+            case OPT_TRUNC: cfg.truncPercent = (uint32_t)atoi(optarg); break;
+            case OPT_DROP: cfg.dropPercent = (uint32_t)atoi(optarg); break;
+            case OPT_FLAP: cfg.flapPercent = (uint32_t)atoi(optarg); break;
+            case OPT_OUTAGE:
+                if (sscanf(optarg, "%u:%u:%u", &cfg.outageStart, &cfg.outageLength, &cfg.outagePeriod) < 2) usage();
+                if (cfg.outagePeriod != 0 && cfg.outagePeriod <= cfg.outageLength) usage();
+                break;
+            case OPT_SEED: seed = (unsigned)strtoul(optarg, NULL, 0); break;
+            case 't': cfg.runSeconds = (uint32_t)atoi(optarg); break;
+            case 's': cfg.reportSeconds = (uint32_t)atoi(optarg); break;
+            case 'v': cfg.verbose = true; break;
+            default: usage();
+        }
+    }
+    if (optind < argc) cfg.device = argv[optind];
+    srand(seed);
+}
+
+int main(int argc, char** argv) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    startTime = (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+
+    parseOptions(argc, argv);
+    int fd = openDevice(cfg.device);
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+
+    for (int i = 0; i < cfg.postCount; i++) {
+        pumps[i].address = (uint8_t)(cfg.firstAddress + i);
+        pumps[i].state = PUMP_IDLE;
+        pumps[i].nozzle = 1;
+        pumps[i].nextNozzle = 1;
+    }
+    logEvent(NULL, "pumps %u..%u on %s", cfg.firstAddress, cfg.firstAddress + cfg.postCount - 1, cfg.device);
+
+    uint64_t lastByte = 0;
+    uint64_t nextReport = cfg.reportSeconds * 1000ULL;
+    while (!stopRequested) {
+        struct pollfd pfd = {.fd = fd, .events = POLLIN};
+        int ready = poll(&pfd, 1, 1);
+        uint64_t now = nowMs();
+
+        ssize_t n = 0;
+        if (ready > 0 && (pfd.revents & POLLIN)) {
+            uint8_t bytes[64];
+            n = read(fd, bytes, sizeof(bytes));
+            for (ssize_t i = 0; i < n; i++) {
+                pushRxByte(bytes[i], now);
+            }
+            if (n > 0) lastByte = now;
+        }
+        // Закрытый pty сообщает POLLHUP, а чтение из него - EIO
+        if (ready > 0 && n <= 0 && (pfd.revents & (POLLHUP | POLLERR | POLLIN))) {
+            usleep(10000);      // Контроллер ещё не открыл pty или перезапускается
+            fd = reopenDevice(cfg.device, fd);
+        }
+        if (rxLength > 0 && now - lastByte > PUMP_LINE_IDLE_MS) {
+            dropRxBytes(rxLength);
+        }
+
+        updateOutage(now);
+        for (int i = 0; i < cfg.postCount; i++) {
+            updateFlow(&pumps[i], now);
+            updateCustomer(&pumps[i], now);
+        }
+        for (int i = 0; i < PUMP_MAX_PENDING; i++) {
+            if (pending[i].length != 0 && now >= pending[i].due) {
+                if (write(fd, pending[i].data, pending[i].length) == pending[i].length) {
+                    stats.replies++;
+                }
+                pending[i].length = 0;
+            }
+        }
+
+        if (cfg.reportSeconds != 0 && now >= nextReport) {
+            report();
+            nextReport += cfg.reportSeconds * 1000ULL;
+        }
+        if (cfg.runSeconds != 0 && now >= cfg.runSeconds * 1000ULL) break;
+    }
+    report();
+    close(fd);
+    return 0;
+}
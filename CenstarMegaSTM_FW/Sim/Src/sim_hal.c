@@ -0,0 +1,226 @@
+/* sim_hal.c - Ядро эмулятора: время, DWT, GPIO, задача прерываний, заглушки RCC/TIM/IWDG */
+
+#include "sim.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+uint32_t SystemCoreClock = 168000000;
+GPIO_TypeDef simGpio[8];
+CoreDebug_Type simCoreDebug;
+
+static DWT_Type simDwt;
+static struct timespec startTime;
+static uint32_t runLimit = 0;
+
+// Сторожевой таймер: без сброса дольше периода IWDG эмуляция завершается, как при сбросе MCU
+static bool iwdgStarted = false;
+static uint32_t iwdgPeriod = 0;
+static volatile uint32_t iwdgLastRefresh = 0;
+
+const char* simEnv(const char* name, const char* def) {
+    const char* value = getenv(name);
+    return (value != NULL && value[0] != '\0') ? value : def;
+}
+
+uint32_t simEnvU32(const char* name, uint32_t def) {
+    const char* value = getenv(name);
+    return (value != NULL && value[0] != '\0') ? (uint32_t)strtoul(value, NULL, 0) : def;
+}
+
+// Наносекунды от запуска эмулятора
+static uint64_t elapsedNs(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)(now.tv_sec - startTime.tv_sec) * 1000000000ULL
+         + (uint64_t)now.tv_nsec - (uint64_t)startTime.tv_nsec;
+}
+
+void simBusyWaitUs(uint32_t us) {
+    uint64_t end = elapsedNs() + (uint64_t)us * 1000;
+    while (elapsedNs() < end) {}
+}
+
+void simIoBegin(void) {
+    if (xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED) {
+        taskENTER_CRITICAL();
+    }
+}
+
+void simIoEnd(void) {
+    if (xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED) {
+        taskEXIT_CRITICAL();
+    }
+}
+
+// CYCCNT - время от запуска в тактах SystemCoreClock, пока счётчик включён
+DWT_Type* simDWT(void) {
+    if ((simDwt.CTRL & DWT_CTRL_CYCCNTENA_Msk) && (simCoreDebug.DEMCR & CoreDebug_DEMCR_TRCENA_Msk)) {
+        simDwt.CYCCNT = (uint32_t)(elapsedNs() * (SystemCoreClock / 1000000) / 1000);
+    }
+    return &simDwt;
+}
+
+static void simReport(void) {
+    fprintf(stderr, "sim: %lu ms, keys pressed %lu\n", (unsigned long)HAL_GetTick(), (unsigned long)simKeypadPressed());
+    simUartReport();
+    simI2CReport();
+}
+
+// Задача прерываний: раз в тик обслуживает UART/DMA и сторожевой таймер.
+// Callback-функции HAL вызываются из неё, как из обработчиков прерываний на MCU
+static void simIrqTask(void* argument) {
+    (void)argument;
+    for (;;) {
+        uint32_t now = xTaskGetTickCount();
+        simUartPoll(now);
+        simI2CPoll(now);
+        simPowerPoll(now);
+        if (iwdgStarted && now - iwdgLastRefresh > iwdgPeriod) {
+            fprintf(stderr, "sim: IWDG reset (no refresh for %lu ms)\n", (unsigned long)(now - iwdgLastRefresh));
+            exit(2);
+        }
+        if (runLimit != 0 && now >= runLimit) {
+            exit(0);
+        }
+        vTaskDelay(1);
+    }
+}
+
+HAL_StatusTypeDef HAL_Init(void) {
+    clock_gettime(CLOCK_MONOTONIC, &startTime);
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    runLimit = simEnvU32("SIM_RUN_MS", 0);
+
+    simUartInit();
+    simI2CInit();
+    simKeypadInit();
+    simPowerInit();
+    atexit(simReport);
+
+    xTaskCreate(simIrqTask, "SimIRQ", configMINIMAL_STACK_SIZE * 4, NULL, SIM_IRQ_TASK_PRIORITY, NULL);
+    HAL_MspInit();
+    return HAL_OK;
+}
+
+uint32_t HAL_GetTick(void) {
+    return xTaskGetTickCount();
+}
+
+void HAL_Delay(uint32_t Delay) {
+    vTaskDelay(pdMS_TO_TICKS(Delay));
+}
+
+HAL_StatusTypeDef HAL_RCC_OscConfig(RCC_OscInitTypeDef* RCC_OscInitStruct) {
+    (void)RCC_OscInitStruct;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_RCC_ClockConfig(RCC_ClkInitTypeDef* RCC_ClkInitStruct, uint32_t FLatency) {
+    (void)RCC_ClkInitStruct;
+    (void)FLatency;
+    return HAL_OK;
+}
+
+void HAL_NVIC_SetPriority(IRQn_Type IRQn, uint32_t PreemptPriority, uint32_t SubPriority) {
+    (void)IRQn;
+    (void)PreemptPriority;
+    (void)SubPriority;
+}
+
+void HAL_NVIC_EnableIRQ(IRQn_Type IRQn) {
+    (void)IRQn;
+}
+
+void HAL_NVIC_DisableIRQ(IRQn_Type IRQn) {
+    (void)IRQn;
+}
+
+// DMA: потоки не эмулируются, передачи выполняют драйверы UART/I2C эмулятора
+HAL_StatusTypeDef HAL_DMA_Init(DMA_HandleTypeDef* hdma) {
+    hdma->ITMask = 0;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DMA_DeInit(DMA_HandleTypeDef* hdma) {
+    (void)hdma;
+    return HAL_OK;
+}
+
+// GPIO: выходы запоминаются в ODR, входы столбцов клавиатуры формирует сценарий
+void HAL_GPIO_Init(GPIO_TypeDef* GPIOx, GPIO_InitTypeDef* GPIO_Init) {
+    if (GPIO_Init->Pull == GPIO_PULLUP) {
+        GPIOx->IDR |= (uint16_t)GPIO_Init->Pin;
+    }
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState) {
+    if (PinState == GPIO_PIN_SET) {
+        GPIOx->ODR |= GPIO_Pin;
+    } else {
+        GPIOx->ODR &= (uint16_t)~GPIO_Pin;
+    }
+}
+
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin) {
+    if (simKeypadRead(GPIOx, GPIO_Pin) == GPIO_PIN_RESET) {
+        return GPIO_PIN_RESET;
+    }
+    return (GPIOx->IDR & GPIO_Pin) ? GPIO_PIN_SET : GPIO_PIN_RESET;
+}
+
+void HAL_GPIO_TogglePin(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin) {
+    GPIOx->ODR ^= GPIO_Pin;
+}
+
+void HAL_GPIO_DeInit(GPIO_TypeDef* GPIOx, uint32_t GPIO_Pin) {
+    GPIOx->IDR &= (uint16_t)~GPIO_Pin;
+}
+
+// IWDG: LSI 32 кГц, период = 4 * 2^Prescaler * (Reload + 1) / 32 мс
+HAL_StatusTypeDef HAL_IWDG_Init(IWDG_HandleTypeDef* hiwdg) {
+    iwdgPeriod = ((4U << hiwdg->Init.Prescaler) * (hiwdg->Init.Reload + 1)) / 32U;
+    iwdgLastRefresh = HAL_GetTick();
+    iwdgStarted = true;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_IWDG_Refresh(IWDG_HandleTypeDef* hiwdg) {
+    (void)hiwdg;
+    iwdgLastRefresh = HAL_GetTick();
+    return HAL_OK;
+}
+
+// TIM2 на хосте не тактируется: время прошивки идёт от тика FreeRTOS
+HAL_StatusTypeDef HAL_TIM_Base_Init(TIM_HandleTypeDef* htim) {
+    (void)htim;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_Base_Start_IT(TIM_HandleTypeDef* htim) {
+    (void)htim;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_ConfigClockSource(TIM_HandleTypeDef* htim, TIM_ClockConfigTypeDef* sClockSourceConfig) {
+    (void)htim;
+    (void)sClockSourceConfig;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIMEx_MasterConfigSynchronization(TIM_HandleTypeDef* htim, TIM_MasterConfigTypeDef* sMasterConfig) {
+    (void)htim;
+    (void)sMasterConfig;
+    return HAL_OK;
+}
+
+// Слабые callback-функции, как в HAL: прошивка переопределяет нужные
+__attribute__((weak)) void HAL_UART_TxCpltCallback(UART_HandleTypeDef* huart) { (void)huart; }
+__attribute__((weak)) void HAL_UART_ErrorCallback(UART_HandleTypeDef* huart) { (void)huart; }
+__attribute__((weak)) void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef* huart, uint16_t Size) { (void)huart; (void)Size; }
+__attribute__((weak)) void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef* htim) { (void)htim; }
+__attribute__((weak)) void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef* hi2c) { (void)hi2c; }
+__attribute__((weak)) void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef* hi2c) { (void)hi2c; }
+__attribute__((weak)) void HAL_I2C_ErrorCallback(I2C_HandleTypeDef* hi2c) { (void)hi2c; }
@@ -0,0 +1,426 @@
+/* sim_i2c.c - Эмуляция шины I2C1: EEPROM 24C256 в файле и SSD1306 с выводом кадра в PBM */
+
+#include "sim.h"
+#include "config.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// EEPROM: образ в памяти, каждая запись сразу сохраняется в файл.
+// После записи страницы микросхема не отвечает SIM_EEPROM_WRITE_MS, как во время цикла записи
+typedef struct {
+    uint8_t mem[EEPROM_SIZE];
+    int fd;
+    uint32_t busyUntil;         // Конец цикла записи (мс)
+    uint32_t writeMs;
+    uint32_t reads;
+    uint32_t readBytes;
+    uint32_t writes;            // Циклы записи страниц
+    uint32_t writeBytes;
+    uint32_t nacks;             // Обращения во время цикла записи
+} SimEeprom;
+
+// SSD1306: GDDRAM 8 страниц по 128 столбцов, указатель записи и окно горизонтальной адресации
+typedef struct {
+    uint8_t ram[8][SCREEN_WIDTH];
+    uint8_t addrMode;           // 0 - горизонтальная, 1 - вертикальная, 2 - страничная
+    uint8_t col, page;
+    uint8_t colStart, colEnd, pageStart, pageEnd;
+    uint8_t cmd[3];             // Команда с аргументами, ещё не принятая полностью
+    uint8_t cmdLength, cmdNeed;
+    bool on, inverted, segRemap, comRemap;
+    bool dirty;
+    const char* path;
+    uint32_t lastRender;
+    uint32_t cmdBytes;
+    uint32_t dataBytes;
+    uint32_t transfers;
+    uint32_t frames;            // Сохранённые в PBM кадры
+} SimOled;
+
+// Передача через DMA или чтение по прерываниям: данные уходят на устройство (или читаются
+// из него) по окончании, затем вызывается HAL_I2C_MemTxCpltCallback (HAL_I2C_MemRxCpltCallback).
+// Пока она идёт, блокирующие функции получают HAL_BUSY, как в HAL
+typedef struct {
+    bool active;
+    bool read;
+    I2C_HandleTypeDef* hi2c;
+    uint16_t devAddress;
+    uint16_t memAddress;
+    uint8_t* data;
+    uint16_t size;
+    uint64_t doneUs;            // Окончание передачи по шкале тиков (мкс)
+    uint32_t transfers;
+    uint32_t busy;              // Отказы блокирующих функций из-за идущей передачи
+} SimI2CDma;
+
+static SimEeprom eeprom;
+static SimOled oled;
+static SimI2CDma dma;
+
+// Статистика занятости шины
+static uint32_t busBusyUs = 0;
+
+static void openEeprom(void) {
+    const char* path = simEnv("SIM_EEPROM", "eeprom.bin");
+    memset(eeprom.mem, 0xFF, sizeof(eeprom.mem));
+    eeprom.writeMs = simEnvU32("SIM_EEPROM_WRITE_MS", 5);
+    eeprom.fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (eeprom.fd < 0) {
+        fprintf(stderr, "sim: cannot open %s: %s\n", path, strerror(errno));
+        exit(1);
+    }
+    ssize_t n = pread(eeprom.fd, eeprom.mem, sizeof(eeprom.mem), 0);
+    if (n < (ssize_t)sizeof(eeprom.mem)) {
+        // Новый образ: недостающая часть - стёртые ячейки
+        pwrite(eeprom.fd, eeprom.mem, sizeof(eeprom.mem), 0);
+    }
+}
+
+void simI2CInit(void) {
+    openEeprom();
+    memset(&oled, 0, sizeof(oled));
+    oled.addrMode = 2;
+    oled.colEnd = SCREEN_WIDTH - 1;
+    oled.pageEnd = 7;
+    oled.path = simEnv("SIM_OLED", "oled.pbm");
+}
+
+HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef* hi2c) {
+    HAL_I2C_MspInit(hi2c);
+    return HAL_OK;
+}
+
+// Сброс периферии прерывает идущую передачу без callback
+HAL_StatusTypeDef HAL_I2C_DeInit(I2C_HandleTypeDef* hi2c) {
+    dma.active = false;
+    HAL_I2C_MspDeInit(hi2c);
+    return HAL_OK;
+}
+
+// Время транзакции: старт, адрес и bytes байт по 9 тактов SCL
+static void busTransfer(I2C_HandleTypeDef* hi2c, uint32_t bytes) {
+    uint32_t clock = hi2c->Init.ClockSpeed ? hi2c->Init.ClockSpeed : 100000;
+    uint32_t us = (uint32_t)((uint64_t)(bytes + 1) * 9 * 1000000 / clock) + 1;
+    busBusyUs += us;
+    simBusyWaitUs(us);
+}
+
+static bool eepromBusy(void) {
+    if ((int32_t)(HAL_GetTick() - eeprom.busyUntil) < 0) {
+        eeprom.nacks++;
+        return true;
+    }
+    return false;
+}
+
+// Запись в пределах страницы: адрес, вышедший за конец страницы, заворачивается на её начало
+static void eepromWrite(uint16_t addr, const uint8_t* data, uint16_t size) {
+    uint16_t page = addr & ~(uint16_t)(EEPROM_PAGE_SIZE - 1);
+    for (uint16_t i = 0; i < size; i++) {
+        uint16_t cell = (uint16_t)(page + ((addr + i) & (EEPROM_PAGE_SIZE - 1))) % EEPROM_SIZE;
+        eeprom.mem[cell] = data[i];
+    }
+    simIoBegin();
+    pwrite(eeprom.fd, eeprom.mem + page % EEPROM_SIZE, EEPROM_PAGE_SIZE, page % EEPROM_SIZE);
+    simIoEnd();
+    eeprom.writes++;
+    eeprom.writeBytes += size;
+    eeprom.busyUntil = HAL_GetTick() + eeprom.writeMs;
+}
+
+static void eepromRead(uint16_t addr, uint8_t* data, uint16_t size) {
+    for (uint16_t i = 0; i < size; i++) {
+        data[i] = eeprom.mem[(addr + i) % EEPROM_SIZE];
+    }
+    eeprom.reads++;
+    eeprom.readBytes += size;
+}
+
+// Число байтов аргументов команды SSD1306
+static uint8_t oledArgs(uint8_t c) {
+    switch (c) {
+        case 0x21: case 0x22: return 2;
+        case 0x20: case 0x81: case 0x8D: case 0xA8: case 0xD3:
+        case 0xD5: case 0xD9: case 0xDA: case 0xDB: return 1;
+        default: return 0;
+    }
+}
+
+static void oledCommand(const uint8_t* cmd) {
+    uint8_t c = cmd[0];
+    if (c <= 0x0F) {
+        oled.col = (oled.col & 0xF0) | c;
+    } else if (c >= 0x10 && c <= 0x1F) {
+        oled.col = (uint8_t)((oled.col & 0x0F) | ((c & 0x0F) << 4));
+    } else if (c >= 0xB0 && c <= 0xB7) {
+        oled.page = c & 0x07;
+    } else {
+        switch (c) {
+            case 0x20: oled.addrMode = cmd[1] & 0x03; break;
+            case 0x21: oled.colStart = oled.col = cmd[1] & 0x7F; oled.colEnd = cmd[2] & 0x7F; break;
+            case 0x22: oled.pageStart = oled.page = cmd[1] & 0x07; oled.pageEnd = cmd[2] & 0x07; break;
+            case 0xA0: oled.segRemap = false; break;
+            case 0xA1: oled.segRemap = true; break;
+            case 0xC0: oled.comRemap = false; break;
+            case 0xC8: oled.comRemap = true; break;
+            case 0xA6: oled.inverted = false; break;
+            case 0xA7: oled.inverted = true; break;
+            case 0xAE: oled.on = false; break;
+            case 0xAF: oled.on = true; break;
+            default: break;
+        }
+    }
+    oled.dirty = true;
+}
+
+static void oledCommandByte(uint8_t b) {
+    if (oled.cmdLength == 0) {
+        oled.cmdNeed = oledArgs(b);
+    }
+    oled.cmd[oled.cmdLength++] = b;
+    if (oled.cmdLength > oled.cmdNeed) {
+        oledCommand(oled.cmd);
+        oled.cmdLength = 0;
+    }
+    oled.cmdBytes++;
+}
+
+// Запись в GDDRAM со сдвигом указателя по режиму адресации
+static void oledDataByte(uint8_t b) {
+    oled.ram[oled.page & 7][oled.col & 0x7F] = b;
+    oled.dataBytes++;
+    oled.dirty = true;
+    switch (oled.addrMode) {
+        case 0:
+            if (oled.col >= oled.colEnd) {
+                oled.col = oled.colStart;
+                oled.page = (oled.page >= oled.pageEnd) ? oled.pageStart : oled.page + 1;
+            } else {
+                oled.col++;
+            }
+            break;
+        case 1:
+            if (oled.page >= oled.pageEnd) {
+                oled.page = oled.pageStart;
+                oled.col = (oled.col >= oled.colEnd) ? oled.colStart : oled.col + 1;
+            } else {
+                oled.page++;
+            }
+            break;
+        default:
+            oled.col = (oled.col + 1) & 0x7F;
+            break;
+    }
+}
+
+// Поток после адреса: управляющий байт (Co, D/C) и данные или команды
+static void oledStream(const uint8_t* data, uint16_t size) {
+    oled.transfers++;
+    uint16_t i = 0;
+    while (i < size) {
+        uint8_t control = data[i++];
+        bool single = (control & 0x80) != 0;
+        bool isData = (control & 0x40) != 0;
+        uint16_t end = single ? (uint16_t)(i + 1) : size;
+        if (end > size) end = size;
+        for (; i < end; i++) {
+            if (isData) {
+                oledDataByte(data[i]);
+            } else {
+                oledCommandByte(data[i]);
+            }
+        }
+    }
+}
+
+// Кадр в PBM: SEG0 слева при A1, COM0 сверху при C8 (ориентация модуля на плате)
+static void oledRender(void) {
+    char tmp[512];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", oled.path);
+    simIoBegin();
+    FILE* f = fopen(tmp, "wb");
+    if (f != NULL) {
+        fprintf(f, "P4\n%d %d\n", SCREEN_WIDTH, SCREEN_HEIGHT);
+        for (int y = 0; y < SCREEN_HEIGHT; y++) {
+            uint8_t row[SCREEN_WIDTH / 8] = {0};
+            int line = oled.comRemap ? y : SCREEN_HEIGHT - 1 - y;
+            for (int x = 0; x < SCREEN_WIDTH; x++) {
+                int col = oled.segRemap ? x : SCREEN_WIDTH - 1 - x;
+                bool pixel = (oled.ram[line / 8][col] >> (line % 8)) & 1;
+                if (oled.inverted) pixel = !pixel;
+                if (!oled.on) pixel = false;
+                if (pixel) row[x / 8] |= (uint8_t)(0x80 >> (x % 8));
+            }
+            fwrite(row, 1, sizeof(row), f);
+        }
+        fclose(f);
+        rename(tmp, oled.path);
+    }
+    simIoEnd();
+    oled.frames++;
+}
+
+// Кадр сохраняется не чаще раза в 50 мс, когда поток данных дисплея затих
+static void simOledPoll(uint32_t now) {
+    if (oled.dirty && now - oled.lastRender >= 50) {
+        oled.dirty = false;
+        oled.lastRender = now;
+        oledRender();
+    }
+}
+
+static bool dmaBusy(void) {
+    if (dma.active) {
+        dma.busy++;
+        return true;
+    }
+    return false;
+}
+
+HAL_StatusTypeDef HAL_I2C_IsDeviceReady(I2C_HandleTypeDef* hi2c, uint16_t DevAddress, uint32_t Trials, uint32_t Timeout) {
+    (void)Timeout;
+    if (dmaBusy()) return HAL_BUSY;
+    for (uint32_t i = 0; i < Trials; i++) {
+        busTransfer(hi2c, 0);
+        if (DevAddress == OLED_I2C_ADDR) return HAL_OK;
+        if (DevAddress == EEPROM_I2C_ADDR && !eepromBusy()) return HAL_OK;
+    }
+    return HAL_ERROR;
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Transmit(I2C_HandleTypeDef* hi2c, uint16_t DevAddress, uint8_t* pData, uint16_t Size, uint32_t Timeout) {
+    (void)Timeout;
+    if (dmaBusy()) return HAL_BUSY;
+    busTransfer(hi2c, Size);
+    if (DevAddress == OLED_I2C_ADDR) {
+        oledStream(pData, Size);
+        return HAL_OK;
+    }
+    if (DevAddress == EEPROM_I2C_ADDR && Size >= 2 && !eepromBusy()) {
+        uint16_t addr = (uint16_t)((pData[0] << 8) | pData[1]);
+        if (Size > 2) {
+            eepromWrite(addr, pData + 2, Size - 2);
+        }
+        return HAL_OK;
+    }
+    return HAL_ERROR;
+}
+
+// Запись после адреса ячейки: для SSD1306 адрес ячейки - управляющий байт
+static HAL_StatusTypeDef memWrite(uint16_t DevAddress, uint16_t MemAddress, const uint8_t* pData, uint16_t Size) {
+    if (DevAddress == OLED_I2C_ADDR) {
+        oled.transfers++;
+        for (uint16_t i = 0; i < Size; i++) {
+            if (MemAddress & 0x40) {
+                oledDataByte(pData[i]);
+            } else {
+                oledCommandByte(pData[i]);
+            }
+        }
+        return HAL_OK;
+    }
+    if (DevAddress == EEPROM_I2C_ADDR && !eepromBusy()) {
+        eepromWrite(MemAddress, pData, Size);
+        return HAL_OK;
+    }
+    return HAL_ERROR;
+}
+
+static HAL_StatusTypeDef memRead(uint16_t DevAddress, uint16_t MemAddress, uint8_t* pData, uint16_t Size) {
+    if (DevAddress == EEPROM_I2C_ADDR && !eepromBusy()) {
+        eepromRead(MemAddress, pData, Size);
+        return HAL_OK;
+    }
+    return HAL_ERROR;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Write(I2C_HandleTypeDef* hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t* pData, uint16_t Size, uint32_t Timeout) {
+    (void)Timeout;
+    if (dmaBusy()) return HAL_BUSY;
+    uint16_t addrBytes = (MemAddSize == I2C_MEMADD_SIZE_16BIT) ? 2 : 1;
+    busTransfer(hi2c, addrBytes + Size);
+    return memWrite(DevAddress, MemAddress, pData, Size);
+}
+
+// Передача в фоне: окончание по шкале тиков, bytes - байт после адреса устройства
+static HAL_StatusTypeDef startTransfer(I2C_HandleTypeDef* hi2c, bool read, uint16_t DevAddress, uint16_t MemAddress,
+                                       uint8_t* pData, uint16_t Size, uint32_t bytes) {
+    if (dma.active) return HAL_BUSY;
+    uint32_t clock = hi2c->Init.ClockSpeed ? hi2c->Init.ClockSpeed : 100000;
+    uint32_t us = (uint32_t)((uint64_t)(bytes + 1) * 9 * 1000000 / clock) + 1;
+    // Следующий участок цепочки начинается сразу после предыдущего, даже если опрос его запоздал
+    uint64_t now = (uint64_t)HAL_GetTick() * 1000;
+    uint64_t start = (dma.doneUs > now) ? dma.doneUs : now;
+    dma.active = true;
+    dma.read = read;
+    dma.hi2c = hi2c;
+    dma.devAddress = DevAddress;
+    dma.memAddress = MemAddress;
+    dma.data = pData;
+    dma.size = Size;
+    dma.doneUs = start + us;
+    dma.transfers++;
+    busBusyUs += us;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Write_DMA(I2C_HandleTypeDef* hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t* pData, uint16_t Size) {
+    uint16_t addrBytes = (MemAddSize == I2C_MEMADD_SIZE_16BIT) ? 2 : 1;
+    return startTransfer(hi2c, false, DevAddress, MemAddress, pData, Size, addrBytes + Size);
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read_IT(I2C_HandleTypeDef* hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t* pData, uint16_t Size) {
+    uint16_t addrBytes = (MemAddSize == I2C_MEMADD_SIZE_16BIT) ? 2 : 1;
+    return startTransfer(hi2c, true, DevAddress, MemAddress, pData, Size, addrBytes + 1 + Size);
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read(I2C_HandleTypeDef* hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t* pData, uint16_t Size, uint32_t Timeout) {
+    (void)Timeout;
+    if (dmaBusy()) return HAL_BUSY;
+    uint16_t addrBytes = (MemAddSize == I2C_MEMADD_SIZE_16BIT) ? 2 : 1;
+    busTransfer(hi2c, addrBytes + 1 + Size);
+    return memRead(DevAddress, MemAddress, pData, Size);
+}
+
+// Завершение фоновых передач, время которых истекло; callback может запустить следующую
+static void pollDma(uint32_t now) {
+    while (dma.active && dma.doneUs <= (uint64_t)now * 1000) {
+        dma.active = false;
+        if (dma.read) {
+            if (memRead(dma.devAddress, dma.memAddress, dma.data, dma.size) == HAL_OK) {
+                HAL_I2C_MemRxCpltCallback(dma.hi2c);
+            } else {
+                HAL_I2C_ErrorCallback(dma.hi2c);
+            }
+        } else if (memWrite(dma.devAddress, dma.memAddress, dma.data, dma.size) == HAL_OK) {
+            HAL_I2C_MemTxCpltCallback(dma.hi2c);
+        } else {
+            HAL_I2C_ErrorCallback(dma.hi2c);
+        }
+    }
+}
+
+void simI2CPoll(uint32_t now) {
+    pollDma(now);
+    simOledPoll(now);
+}
+
+void simI2CReport(void) {
+    if (oled.dirty) {
+        oledRender();
+    }
+    fprintf(stderr, "sim: I2C1 busy %lu ms, DMA transfers %lu, blocked while DMA %lu; EEPROM reads %lu (%lu B), page writes %lu (%lu B), NACK %lu; "
+                    "OLED transfers %lu, cmd %lu B, data %lu B, frames %lu\n",
+            (unsigned long)(busBusyUs / 1000), (unsigned long)dma.transfers, (unsigned long)dma.busy,
+            (unsigned long)eeprom.reads, (unsigned long)eeprom.readBytes,
+            (unsigned long)eeprom.writes, (unsigned long)eeprom.writeBytes, (unsigned long)eeprom.nacks,
+            (unsigned long)oled.transfers, (unsigned long)oled.cmdBytes, (unsigned long)oled.dataBytes,
+            (unsigned long)oled.frames);
+}
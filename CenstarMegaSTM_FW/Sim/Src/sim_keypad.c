@@ -0,0 +1,133 @@
+/* sim_keypad.c - Клавиатура 5×4 по сценарию из файла SIM_KEYS
+ *
+ * Строка сценария: "<пауза мс> <клавиши>" - после паузы клавиши нажимаются по очереди
+ * с интервалом SIM_KEYS_GAP. Клавиша считается нажатой, пока прошивка не подтвердит её
+ * повторным чтением после антидребезга, затем отпускается: одно нажатие сценария - одно событие
+ */
+
+#include "sim.h"
+#include "config.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SIM_KEYS_MAX 4096
+
+// Та же раскладка, что в keypad.c
+static const char KeyMap[KEYPAD_ROW_COUNT][KEYPAD_COL_COUNT] = {
+    {'A', 'F', 'G', 'H'},
+    {'B', '1', '2', '3'},
+    {'C', '4', '5', '6'},
+    {'D', '7', '8', '9'},
+    {'E', '*', '0', 'K'}
+};
+static const uint16_t RowPin[KEYPAD_ROW_COUNT] = {ROW1_PIN, ROW2_PIN, ROW3_PIN, ROW4_PIN, ROW5_PIN};
+static GPIO_TypeDef* const ColPort[KEYPAD_COL_COUNT] = {COL1_PORT, COL2_PORT, COL3_PORT, COL4_PORT};
+static const uint16_t ColPin[KEYPAD_COL_COUNT] = {COL1_PIN, COL2_PIN, COL3_PIN, COL4_PIN};
+
+typedef struct {
+    uint32_t delay;             // Пауза после предыдущего нажатия (мс)
+    char key;
+} SimKeyStep;
+
+static SimKeyStep steps[SIM_KEYS_MAX];
+static uint32_t stepCount = 0;
+static uint32_t stepIndex = 0;
+static uint32_t stepTime = 0;   // Момент, с которого отсчитывается пауза текущего шага
+static bool keyDown = false;
+static uint8_t keyRow, keyCol;
+static uint8_t keyReads = 0;    // Сколько раз прошивка прочитала нажатую клавишу
+static bool loop = false;
+static uint32_t pressed = 0;
+
+static bool findKey(char key, uint8_t* row, uint8_t* col) {
+    for (uint8_t r = 0; r < KEYPAD_ROW_COUNT; r++) {
+        for (uint8_t c = 0; c < KEYPAD_COL_COUNT; c++) {
+            if (KeyMap[r][c] == key) {
+                *row = r;
+                *col = c;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void simKeypadInit(void) {
+    const char* path = simEnv("SIM_KEYS", NULL);
+    loop = simEnvU32("SIM_KEYS_LOOP", 0) != 0;
+    if (path == NULL) return;
+
+    FILE* f = fopen(path, "r");
+    if (f == NULL) {
+        fprintf(stderr, "sim: cannot open key script %s\n", path);
+        exit(1);
+    }
+    uint32_t gap = simEnvU32("SIM_KEYS_GAP", 150);
+    char line[256];
+    while (fgets(line, sizeof(line), f) != NULL && stepCount < SIM_KEYS_MAX) {
+        char* p = line;
+        while (isspace((unsigned char)*p)) p++;
+        if (*p == '#' || *p == '\0') continue;
+        uint32_t delay = (uint32_t)strtoul(p, &p, 10);
+        bool first = true;
+        for (; *p != '\0' && *p != '#' && stepCount < SIM_KEYS_MAX; p++) {
+            uint8_t row, col;
+            if (isspace((unsigned char)*p)) continue;
+            if (!findKey(*p, &row, &col)) {
+                fprintf(stderr, "sim: unknown key '%c' in %s\n", *p, path);
+                continue;
+            }
+            steps[stepCount].delay = first ? delay : gap;
+            steps[stepCount].key = *p;
+            stepCount++;
+            first = false;
+        }
+        if (first && stepCount < SIM_KEYS_MAX) {
+            // Строка без клавиш - только пауза перед следующей строкой
+            steps[stepCount].delay = delay;
+            steps[stepCount].key = 0;
+            stepCount++;
+        }
+    }
+    fclose(f);
+}
+
+// Переход к следующему шагу, когда истекла его пауза
+static void advance(uint32_t now) {
+    while (!keyDown && stepIndex < stepCount && now - stepTime >= steps[stepIndex].delay) {
+        stepTime += steps[stepIndex].delay;
+        char key = steps[stepIndex].key;
+        stepIndex++;
+        if (key != 0 && findKey(key, &keyRow, &keyCol)) {
+            keyDown = true;
+            keyReads = 0;
+            pressed++;
+        }
+        if (stepIndex >= stepCount && loop) {
+            stepIndex = 0;
+        }
+    }
+}
+
+// Столбец нажатой клавиши замкнут на низкий уровень, пока её строка выбрана (низкий уровень)
+GPIO_PinState simKeypadRead(GPIO_TypeDef* port, uint16_t pin) {
+    uint32_t now = HAL_GetTick();
+    advance(now);
+    if (!keyDown || port != ColPort[keyCol] || pin != ColPin[keyCol]) {
+        return GPIO_PIN_SET;
+    }
+    if (ROW1_PORT->ODR & RowPin[keyRow]) {
+        return GPIO_PIN_SET;
+    }
+    if (++keyReads >= 2) {
+        keyDown = false;
+        stepTime = now;
+    }
+    return GPIO_PIN_RESET;
+}
+
+uint32_t simKeypadPressed(void) {
+    return pressed;
+}
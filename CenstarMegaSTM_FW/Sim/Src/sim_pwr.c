@@ -0,0 +1,75 @@
+/* sim_pwr.c - Эмуляция питания: backup SRAM в файле и отказ питания с прерыванием PVD */
+
+#include "sim.h"
+#include "config.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Содержимое сохраняется между запусками эмулятора, как backup SRAM с батареей VBAT:
+// запись - обычное обращение к памяти, без вызова файловых функций
+static uint8_t* backupSram = NULL;
+
+// Отказ питания: 0 - не задан
+static uint32_t powerFailAt = 0;
+static bool pvdEnabled = false;
+
+void simPowerInit(void) {
+    powerFailAt = simEnvU32("SIM_POWER_FAIL_MS", 0);
+}
+
+// Из задачи прерываний: PVD срабатывает, если прошивка его включила, затем питание пропадает.
+// Время удержания питания не эмулируется: обработчик PVD выполняется целиком
+void simPowerPoll(uint32_t now) {
+    if (powerFailAt == 0 || now < powerFailAt) return;
+    fprintf(stderr, "sim: power fail at %lu ms%s\n", (unsigned long)now, pvdEnabled ? ", PVD" : "");
+    if (pvdEnabled) {
+        HAL_PWR_PVDCallback();
+    }
+    exit(3);
+}
+
+void* simBackupSram(void) {
+    if (backupSram != NULL) return backupSram;
+    if (simEnvU32("SIM_VBAT", 1) == 0) {
+        // Батарея снята: после включения содержимое случайно
+        backupSram = malloc(BACKUP_SRAM_SIZE);
+        for (int i = 0; i < BACKUP_SRAM_SIZE; i++) {
+            backupSram[i] = (uint8_t)rand();
+        }
+        return backupSram;
+    }
+    const char* path = simEnv("SIM_BKPSRAM", "bkpsram.bin");
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0 || ftruncate(fd, BACKUP_SRAM_SIZE) != 0) {
+        fprintf(stderr, "sim: cannot open %s: %s\n", path, strerror(errno));
+        exit(1);
+    }
+    backupSram = mmap(NULL, BACKUP_SRAM_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (backupSram == MAP_FAILED) {
+        fprintf(stderr, "sim: cannot map %s: %s\n", path, strerror(errno));
+        exit(1);
+    }
+    return backupSram;
+}
+
+void HAL_PWR_EnableBkUpAccess(void) {}
+
+HAL_StatusTypeDef HAL_PWREx_EnableBkUpReg(void) {
+    simBackupSram();
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_PWR_ConfigPVD(PWR_PVDTypeDef* sConfigPVD) {
+    (void)sConfigPVD;
+    return HAL_OK;
+}
+
+void HAL_PWR_EnablePVD(void) {
+    pvdEnabled = true;
+}
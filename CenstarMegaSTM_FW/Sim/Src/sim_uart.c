@@ -0,0 +1,287 @@
+/* sim_uart.c - Эмуляция UART2 (RS-422) на pty или устройстве хоста и UART3 (лог) в файле */
+
+#define _GNU_SOURCE
+#include "sim.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+// Состояние одного UART: передача через DMA завершается через время передачи кадра,
+// приём идёт в буфер DMA (циклический или обычный), пауза на линии даёт событие IDLE
+typedef struct {
+    const char* name;
+    int fd;
+    UART_HandleTypeDef* huart;
+    // Передача через DMA
+    const uint8_t* txData;
+    uint16_t txSize;
+    uint32_t txDoneTime;        // Момент завершения передачи (мс)
+    bool txFault;               // Передача оборвётся ошибкой DMA
+    // Приём через DMA
+    uint8_t* rxBuf;
+    uint16_t rxSize;
+    uint16_t rxPos;
+    bool rxActive;
+    bool rxPending;             // Байты приняты после последнего события, ждём паузы на линии
+    uint32_t rxCredit;          // Байты, которые линия успела бы передать с прошлого опроса
+    uint32_t lastPoll;
+    // Статистика
+    uint32_t txBytes;
+    uint32_t rxBytes;
+    uint32_t txBusyUs;          // Время, которое блокирующая передача заняла процессор
+} SimUart;
+
+static SimUart rs422 = {.name = "UART2", .fd = -1};
+static SimUart logUart = {.name = "UART3", .fd = -1};
+static bool instant = false;
+static uint32_t txFaultEvery = 0;   // SIM_UART_TX_FAULT: каждая N-я передача UART2 не проходит
+static uint32_t txStarts = 0;
+
+// Время передачи bytes байт (8N1) на скорости baud, мкс
+static uint32_t byteTimeUs(const SimUart* uart, uint32_t bytes) {
+    uint32_t baud = uart->huart->Init.BaudRate ? uart->huart->Init.BaudRate : 9600;
+    return (uint32_t)((uint64_t)bytes * 10 * 1000000 / baud);
+}
+
+static void setRaw(int fd, uint32_t baud) {
+    struct termios tio;
+    if (tcgetattr(fd, &tio) != 0) return;
+    cfmakeraw(&tio);
+    speed_t speed = B9600;
+    switch (baud) {
+        case 19200: speed = B19200; break;
+        case 38400: speed = B38400; break;
+        case 57600: speed = B57600; break;
+        case 115200: speed = B115200; break;
+        default: break;
+    }
+    cfsetispeed(&tio, speed);
+    cfsetospeed(&tio, speed);
+    tcsetattr(fd, TCSANOW, &tio);
+}
+
+// UART2: устройство из SIM_RS422 или новый pty, подчинённую сторону которого открывает симулятор ТРК
+static void openRS422(void) {
+    const char* device = simEnv("SIM_RS422", NULL);
+    if (device != NULL) {
+        rs422.fd = open(device, O_RDWR | O_NOCTTY | O_NONBLOCK);
+        if (rs422.fd < 0) {
+            fprintf(stderr, "sim: cannot open %s: %s\n", device, strerror(errno));
+            exit(1);
+        }
+        return;
+    }
+
+    rs422.fd = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (rs422.fd < 0 || grantpt(rs422.fd) != 0 || unlockpt(rs422.fd) != 0) {
+        fprintf(stderr, "sim: cannot create pty: %s\n", strerror(errno));
+        exit(1);
+    }
+    const char* slave = ptsname(rs422.fd);
+    // Подчинённая сторона остаётся открытой: иначе чтение мастера даёт EIO, пока симулятор ТРК не подключён
+    int slaveFd = open(slave, O_RDWR | O_NOCTTY);
+    if (slaveFd >= 0) {
+        setRaw(slaveFd, 9600);
+    }
+    const char* link = simEnv("SIM_RS422_LINK", "/tmp/censtar-rs422");
+    unlink(link);
+    if (symlink(slave, link) != 0) {
+        link = slave;
+    }
+    fprintf(stderr, "sim: RS-422 on %s (%s)\n", link, slave);
+}
+
+static void openLog(void) {
+    const char* path = simEnv("SIM_LOG", NULL);
+    if (path == NULL) {
+        logUart.fd = STDOUT_FILENO;
+        return;
+    }
+    logUart.fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (logUart.fd < 0) {
+        fprintf(stderr, "sim: cannot open %s: %s\n", path, strerror(errno));
+        exit(1);
+    }
+}
+
+void simUartInit(void) {
+    instant = simEnvU32("SIM_UART_INSTANT", 0) != 0;
+    txFaultEvery = simEnvU32("SIM_UART_TX_FAULT", 0);
+    openRS422();
+    openLog();
+}
+
+static SimUart* uartOf(UART_HandleTypeDef* huart) {
+    return (SimUart*)huart->sim;
+}
+
+HAL_StatusTypeDef HAL_UART_Init(UART_HandleTypeDef* huart) {
+    SimUart* uart = (huart->Instance == USART2) ? &rs422 : &logUart;
+    uart->huart = huart;
+    huart->sim = uart;
+    huart->gState = HAL_UART_STATE_READY;
+    if (uart->fd >= 0 && isatty(uart->fd)) {
+        setRaw(uart->fd, huart->Init.BaudRate);
+    }
+    HAL_UART_MspInit(huart);
+    return HAL_OK;
+}
+
+static void writeAll(SimUart* uart, const uint8_t* data, uint16_t size) {
+    simIoBegin();
+    while (size > 0) {
+        ssize_t n = write(uart->fd, data, size);
+        if (n > 0) {
+            data += n;
+            size -= (uint16_t)n;
+        } else if (n < 0 && errno != EAGAIN && errno != EINTR) {
+            break;              // Нет читателя на другой стороне pty: байты теряются, как на линии
+        }
+    }
+    simIoEnd();
+}
+
+// Блокирующая передача: процессор занят всё время передачи, как при опросе флага TXE
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef* huart, const uint8_t* pData, uint16_t Size, uint32_t Timeout) {
+    (void)Timeout;
+    SimUart* uart = uartOf(huart);
+    writeAll(uart, pData, Size);
+    uart->txBytes += Size;
+    if (!instant) {
+        uint32_t us = byteTimeUs(uart, Size);
+        uart->txBusyUs += us;
+        simBusyWaitUs(us);
+    }
+    return HAL_OK;
+}
+
+// Передача через DMA: байты уходят на линию по завершении, затем вызывается HAL_UART_TxCpltCallback
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef* huart, const uint8_t* pData, uint16_t Size) {
+    SimUart* uart = uartOf(huart);
+    if (huart->gState == HAL_UART_STATE_BUSY_TX) {
+        return HAL_BUSY;
+    }
+    uart->txFault = false;
+    if (uart == &rs422 && txFaultEvery != 0 && ++txStarts % txFaultEvery == 0) {
+        // Нечётный отказ - DMA не запускается, чётный - передача обрывается по завершении
+        if ((txStarts / txFaultEvery) % 2 != 0) {
+            return HAL_ERROR;
+        }
+        uart->txFault = true;
+    }
+    huart->gState = HAL_UART_STATE_BUSY_TX;
+    uart->txData = pData;
+    uart->txSize = Size;
+    uart->txDoneTime = HAL_GetTick() + (instant ? 0 : (byteTimeUs(uart, Size) + 999) / 1000);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UARTEx_ReceiveToIdle_DMA(UART_HandleTypeDef* huart, uint8_t* pData, uint16_t Size) {
+    SimUart* uart = uartOf(huart);
+    uart->rxBuf = pData;
+    uart->rxSize = Size;
+    uart->rxPos = 0;
+    uart->rxPending = false;
+    uart->rxActive = true;
+    if (huart->hdmarx != NULL) {
+        __HAL_DMA_ENABLE_IT(huart->hdmarx, DMA_IT_HT | DMA_IT_TC);
+    }
+    return HAL_OK;
+}
+
+uint32_t HAL_UARTEx_GetRxEventType(UART_HandleTypeDef* huart) {
+    return huart->RxEventType;
+}
+
+static void rxEvent(SimUart* uart, uint32_t type, uint16_t size) {
+    uart->huart->RxEventType = type;
+    HAL_UARTEx_RxEventCallback(uart->huart, size);
+}
+
+// Приём: байты из fd укладываются в буфер DMA не быстрее скорости линии.
+// Конец буфера - событие TC, половина - HT (если разрешено), опрос без новых байтов - IDLE
+static void pollRx(SimUart* uart, uint32_t now) {
+    if (!uart->rxActive || uart->fd < 0) return;
+
+    uint32_t maxBytes = uart->rxSize;
+    if (!instant) {
+        uint32_t perMs = (uart->huart->Init.BaudRate ? uart->huart->Init.BaudRate : 9600) / 10000 + 1;
+        uart->rxCredit += (now - uart->lastPoll) * perMs;
+        if (uart->rxCredit > uart->rxSize) uart->rxCredit = uart->rxSize;
+        maxBytes = uart->rxCredit;
+    }
+    uart->lastPoll = now;
+
+    bool received = false;
+    while (maxBytes > 0 && uart->rxActive) {
+        uint16_t room = uart->rxSize - uart->rxPos;
+        uint16_t chunk = (maxBytes < room) ? (uint16_t)maxBytes : room;
+        simIoBegin();
+        ssize_t n = read(uart->fd, uart->rxBuf + uart->rxPos, chunk);
+        simIoEnd();
+        if (n <= 0) break;
+
+        uint16_t half = uart->rxSize / 2;
+        bool crossedHalf = uart->rxPos < half && uart->rxPos + n >= half;
+        uart->rxPos += (uint16_t)n;
+        uart->rxBytes += (uint32_t)n;
+        maxBytes -= (uint32_t)n;
+        if (!instant) uart->rxCredit -= (uint32_t)n;
+        received = true;
+
+        DMA_HandleTypeDef* dma = uart->huart->hdmarx;
+        if (crossedHalf && uart->rxPos < uart->rxSize && dma != NULL && (dma->ITMask & DMA_IT_HT)) {
+            rxEvent(uart, HAL_UART_RXEVENT_HT, half);
+        }
+        if (uart->rxPos >= uart->rxSize) {
+            bool circular = dma != NULL && dma->Init.Mode == DMA_CIRCULAR;
+            uart->rxPending = false;
+            uart->rxActive = circular;
+            rxEvent(uart, HAL_UART_RXEVENT_TC, uart->rxSize);
+            if (circular) {
+                uart->rxPos = 0;
+            }
+        } else {
+            uart->rxPending = true;
+        }
+    }
+
+    if (!received && uart->rxPending) {
+        uart->rxPending = false;
+        rxEvent(uart, HAL_UART_RXEVENT_IDLE, uart->rxPos);
+    }
+}
+
+static void pollTx(SimUart* uart, uint32_t now) {
+    if (uart->huart == NULL || uart->huart->gState != HAL_UART_STATE_BUSY_TX) return;
+    if ((int32_t)(now - uart->txDoneTime) < 0) return;
+    if (uart->txFault) {
+        // Как UART_DMAError в HAL: передача прекращена, затем HAL_UART_ErrorCallback
+        uart->huart->gState = HAL_UART_STATE_READY;
+        HAL_UART_ErrorCallback(uart->huart);
+        return;
+    }
+    writeAll(uart, uart->txData, uart->txSize);
+    uart->txBytes += uart->txSize;
+    uart->huart->gState = HAL_UART_STATE_READY;
+    HAL_UART_TxCpltCallback(uart->huart);
+}
+
+void simUartPoll(uint32_t now) {
+    pollTx(&rs422, now);
+    pollTx(&logUart, now);
+    pollRx(&rs422, now);
+}
+
+void simUartReport(void) {
+    fprintf(stderr, "sim: %s tx %lu B, rx %lu B; %s tx %lu B, blocking tx %lu ms\n",
+            rs422.name, (unsigned long)rs422.txBytes, (unsigned long)rs422.rxBytes,
+            logUart.name, (unsigned long)logUart.txBytes, (unsigned long)(logUart.txBusyUs / 1000));
+}